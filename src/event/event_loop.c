@@ -0,0 +1,117 @@
+#include "event_loop.h"
+#include "iputils_common.h"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
+
+int event_loop_create(void)
+{
+	int epfd = epoll_create1(EPOLL_CLOEXEC);
+
+	if (epfd < 0)
+		error(2, errno, "epoll_create1");
+	return epfd;
+}
+
+void event_add(int epfd, event_source *source, uint32_t events)
+{
+	struct epoll_event ev;
+
+	memset(&ev, 0, sizeof(ev));
+	ev.events = events;
+	ev.data.ptr = source;
+	if (epoll_ctl(epfd, EPOLL_CTL_ADD, source->fd, &ev) < 0)
+		error(2, errno, "epoll_ctl");
+}
+
+void event_del(int epfd, event_source *source)
+{
+	epoll_ctl(epfd, EPOLL_CTL_DEL, source->fd, NULL);
+}
+
+/*
+ * event_wait --
+ *	Wait up to "timeout" msec (-1 for ever) for at most "max" sources to
+ * become ready.  Returns how many did, or -1 with errno set.
+ */
+int event_wait(int epfd, struct epoll_event *events, int max, int timeout)
+{
+	return epoll_wait(epfd, events, max, timeout);
+}
+
+/* Run the handlers of the "n" sources event_wait() returned. */
+void event_run(struct epoll_event *events, int n)
+{
+	int i;
+
+	for (i = 0; i < n; i++) {
+		event_source *source = events[i].data.ptr;
+
+		source->handler(source, events[i].events);
+	}
+}
+
+/*
+ * event_dispatch --
+ *	Wait up to "timeout" msec (-1 for ever) and run the handlers of all
+ * sources that became ready.  Returns the number of handled events, or -1
+ * with errno set, EINTR included, so callers can react to signals.
+ */
+int event_dispatch(int epfd, int timeout)
+{
+	struct epoll_event events[EVENT_BATCH];
+	int n;
+
+	n = event_wait(epfd, events, EVENT_BATCH, timeout);
+	if (n > 0)
+		event_run(events, n);
+	return n;
+}
+
+void event_timer_init(event_source *source,
+		      void (*handler)(event_source *source, uint32_t events), void *data)
+{
+	source->fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	if (source->fd < 0)
+		error(2, errno, "timerfd_create");
+	source->handler = handler;
+	source->data = data;
+}
+
+/* Fire after "msec" (0 means as soon as possible), then every "interval" msec if non-zero. */
+void event_timer_arm(event_source *source, long msec, long interval)
+{
+	struct itimerspec its;
+
+	its.it_value.tv_sec = msec / 1000;
+	its.it_value.tv_nsec = (msec % 1000) * 1000000;
+	/* An all zero it_value would disarm the timer. */
+	if (msec <= 0) {
+		its.it_value.tv_sec = 0;
+		its.it_value.tv_nsec = 1;
+	}
+	its.it_interval.tv_sec = interval / 1000;
+	its.it_interval.tv_nsec = (interval % 1000) * 1000000;
+	if (timerfd_settime(source->fd, 0, &its, NULL) < 0)
+		error(2, errno, "timerfd_settime");
+}
+
+void event_timer_disarm(event_source *source)
+{
+	struct itimerspec its;
+
+	memset(&its, 0, sizeof(its));
+	timerfd_settime(source->fd, 0, &its, NULL);
+}
+
+/* Acknowledge expirations, returns how many happened since the last read. */
+uint64_t event_timer_read(event_source *source)
+{
+	uint64_t expirations = 0;
+
+	if (read(source->fd, &expirations, sizeof(expirations)) != sizeof(expirations))
+		return 0;
+	return expirations;
+}
@@ -0,0 +1,33 @@
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+#include <stdint.h>
+#include <sys/epoll.h>
+
+/*
+ * A file descriptor watched by the event loop.  The handler is called with
+ * the epoll events that fired; "data" is free for the owner of the source.
+ */
+typedef struct event_source {
+	int fd;
+	void (*handler)(struct event_source *source, uint32_t events);
+	void *data;
+} event_source;
+
+int event_loop_create(void);
+void event_add(int epfd, event_source *source, uint32_t events);
+void event_del(int epfd, event_source *source);
+int event_dispatch(int epfd, int timeout);
+/* event_dispatch() in two steps, for callers that serialize the handlers */
+#define EVENT_BATCH 16
+int event_wait(int epfd, struct epoll_event *events, int max, int timeout);
+void event_run(struct epoll_event *events, int n);
+
+/* timerfd backed sources, times are in msec */
+void event_timer_init(event_source *source,
+		      void (*handler)(event_source *source, uint32_t events), void *data);
+void event_timer_arm(event_source *source, long msec, long interval);
+void event_timer_disarm(event_source *source);
+uint64_t event_timer_read(event_source *source);
+
+#endif
@@ -0,0 +1,216 @@
+#include "timer_wheel.h"
+
+#include <string.h>
+#include <time.h>
+
+#define SLOT_MASK	(TIMER_WHEEL_SLOTS - 1)
+#define LEVEL_SHIFT(level)	((level) * TIMER_WHEEL_BITS)
+#define MAX_DELTA	(((uint64_t)1 << LEVEL_SHIFT(TIMER_WHEEL_LEVELS)) - 1)
+
+/* The clock all wheel times are given in: CLOCK_MONOTONIC in msec. */
+uint64_t timer_wheel_clock(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+void timer_wheel_init(struct timer_wheel *wheel, uint64_t now)
+{
+	memset(wheel, 0, sizeof(*wheel));
+	wheel->clk = now;
+	wheel->now = now;
+}
+
+void timer_init(struct timer_entry *timer, void (*handler)(struct timer_entry *timer), void *data)
+{
+	memset(timer, 0, sizeof(*timer));
+	timer->handler = handler;
+	timer->data = data;
+}
+
+static void enqueue(struct timer_wheel *wheel, struct timer_entry *timer)
+{
+	uint64_t expires = timer->expires;
+	uint64_t delta;
+	struct timer_entry **head;
+	int level = 0;
+
+	/* Overdue timers run with the next tick, far ones are clamped to
+	 * what the top level can hold. */
+	if (expires < wheel->clk)
+		expires = wheel->clk;
+	delta = expires - wheel->clk;
+	if (delta > MAX_DELTA) {
+		delta = MAX_DELTA;
+		expires = wheel->clk + delta;
+	}
+	while (level < TIMER_WHEEL_LEVELS - 1 &&
+	       delta >= (uint64_t)1 << LEVEL_SHIFT(level + 1))
+		level++;
+
+	timer->level = level;
+	timer->slot = (expires >> LEVEL_SHIFT(level)) & SLOT_MASK;
+	head = &wheel->slots[level][timer->slot];
+	timer->next = *head;
+	if (timer->next)
+		timer->next->pprev = &timer->next;
+	timer->pprev = head;
+	*head = timer;
+	wheel->occupied[level] |= (uint64_t)1 << timer->slot;
+}
+
+/*
+ * timer_add --
+ *	(Re)schedule "timer" to run once the wheel reaches "expires".
+ */
+void timer_add(struct timer_wheel *wheel, struct timer_entry *timer, uint64_t expires)
+{
+	if (timer_pending(timer))
+		timer_del(wheel, timer);
+	timer->expires = expires;
+	enqueue(wheel, timer);
+}
+
+void timer_del(struct timer_wheel *wheel, struct timer_entry *timer)
+{
+	if (!timer_pending(timer))
+		return;
+	*timer->pprev = timer->next;
+	if (timer->next)
+		timer->next->pprev = timer->pprev;
+	timer->next = NULL;
+	timer->pprev = NULL;
+	if (!wheel->slots[timer->level][timer->slot])
+		wheel->occupied[timer->level] &= ~((uint64_t)1 << timer->slot);
+}
+
+/* Move the timers of the current slot of "level" one level down. */
+static unsigned cascade(struct timer_wheel *wheel, int level)
+{
+	unsigned index = (wheel->clk >> LEVEL_SHIFT(level)) & SLOT_MASK;
+	struct timer_entry *list = wheel->slots[level][index];
+
+	wheel->slots[level][index] = NULL;
+	wheel->occupied[level] &= ~((uint64_t)1 << index);
+	while (list) {
+		struct timer_entry *next = list->next;
+
+		enqueue(wheel, list);
+		list = next;
+	}
+	return index;
+}
+
+static int wheel_empty(struct timer_wheel *wheel)
+{
+	int level;
+
+	for (level = 0; level < TIMER_WHEEL_LEVELS; level++)
+		if (wheel->occupied[level])
+			return 0;
+	return 1;
+}
+
+/*
+ * timer_wheel_run --
+ *	Turn the wheel up to "now" and run every timer that expired.  Ticks
+ * without work are skipped over using the slot bitmaps.  Handlers may add
+ * and delete timers, themselves included.
+ */
+void timer_wheel_run(struct timer_wheel *wheel, uint64_t now)
+{
+	wheel->now = now;
+
+	while (wheel->clk <= now) {
+		unsigned index = wheel->clk & SLOT_MASK;
+		struct timer_entry *work;
+		uint64_t pending;
+		uint64_t step;
+
+		if (wheel_empty(wheel)) {
+			wheel->clk = now + 1;
+			break;
+		}
+
+		if (!index) {
+			int level;
+
+			for (level = 1; level < TIMER_WHEEL_LEVELS; level++)
+				if (cascade(wheel, level))
+					break;
+		}
+
+		/* Run the slot from a private list head, so that handlers
+		 * adding timers for this very tick get the next one. */
+		work = wheel->slots[0][index];
+		wheel->slots[0][index] = NULL;
+		wheel->occupied[0] &= ~((uint64_t)1 << index);
+		if (work)
+			work->pprev = &work;
+		wheel->clk++;
+
+		while (work) {
+			struct timer_entry *timer = work;
+
+			*timer->pprev = timer->next;
+			if (timer->next)
+				timer->next->pprev = timer->pprev;
+			timer->next = NULL;
+			timer->pprev = NULL;
+			timer->handler(timer);
+		}
+
+		/* Skip ahead to the next busy slot or level 0 wrap. */
+		index = wheel->clk & SLOT_MASK;
+		if (!index)
+			continue;
+		pending = wheel->occupied[0] >> index;
+		step = pending ? (uint64_t)__builtin_ctzll(pending) : TIMER_WHEEL_SLOTS - index;
+		if (step > now + 1 - wheel->clk)
+			step = now + 1 - wheel->clk;
+		wheel->clk += step;
+	}
+}
+
+static uint64_t rotate_right(uint64_t bits, unsigned n)
+{
+	return n ? (bits >> n) | (bits << (64 - n)) : bits;
+}
+
+/*
+ * timer_wheel_next --
+ *	Wheel time by which timer_wheel_run() has to be called next, or
+ * UINT64_MAX if no timer is pending.  For timers on the upper levels this
+ * is when their slot cascades, which is never later than they expire.
+ */
+uint64_t timer_wheel_next(struct timer_wheel *wheel)
+{
+	uint64_t next = UINT64_MAX;
+	int level;
+
+	for (level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+		uint64_t occupied = wheel->occupied[level];
+		unsigned shift = LEVEL_SHIFT(level);
+		unsigned index = (wheel->clk >> shift) & SLOT_MASK;
+		uint64_t when;
+
+		if (!occupied)
+			continue;
+		if (!level) {
+			when = wheel->clk + __builtin_ctzll(rotate_right(occupied, index));
+		} else if (!(wheel->clk & (((uint64_t)1 << shift) - 1)) &&
+			   (occupied & ((uint64_t)1 << index))) {
+			/* This slot cascades with the very next tick. */
+			when = wheel->clk;
+		} else {
+			unsigned distance = __builtin_ctzll(rotate_right(occupied, (index + 1) & SLOT_MASK)) + 1;
+
+			when = ((wheel->clk >> shift) + distance) << shift;
+		}
+		if (when < next)
+			next = when;
+	}
+	return next;
+}
@@ -0,0 +1,48 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Hierarchical timing wheel with msec ticks.  Level 0 holds the timers due
+ * within the next 64 ticks, one slot per tick; every further level covers
+ * 64 times the span of the one below and is cascaded down as the wheel
+ * turns.  Adding, removing and expiring a timer are O(1), so tens of
+ * thousands of outstanding timers cost nothing while they wait.
+ */
+#define TIMER_WHEEL_BITS	6
+#define TIMER_WHEEL_SLOTS	(1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_LEVELS	5
+
+struct timer_entry {
+	struct timer_entry *next;
+	struct timer_entry **pprev;	/* NULL while not pending */
+	uint64_t expires;		/* wheel clock, msec */
+	unsigned char level;
+	unsigned char slot;
+	void (*handler)(struct timer_entry *timer);
+	void *data;
+};
+
+struct timer_wheel {
+	uint64_t clk;			/* next tick to run */
+	uint64_t now;			/* time of the last timer_wheel_run() */
+	uint64_t occupied[TIMER_WHEEL_LEVELS];
+	struct timer_entry *slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+};
+
+uint64_t timer_wheel_clock(void);
+void timer_wheel_init(struct timer_wheel *wheel, uint64_t now);
+void timer_init(struct timer_entry *timer, void (*handler)(struct timer_entry *timer), void *data);
+void timer_add(struct timer_wheel *wheel, struct timer_entry *timer, uint64_t expires);
+void timer_del(struct timer_wheel *wheel, struct timer_entry *timer);
+void timer_wheel_run(struct timer_wheel *wheel, uint64_t now);
+uint64_t timer_wheel_next(struct timer_wheel *wheel);
+
+static inline int timer_pending(const struct timer_entry *timer)
+{
+	return timer->pprev != NULL;
+}
+
+#endif
@@ -0,0 +1,274 @@
+/*
+ * watchping-log -- read the sample logs written by watchping -g
+ *
+ * Prints a summary of each target over all files given, or with -t the
+ * records themselves as text, optionally only those of a time range and
+ * of one target.  Files still being written are read up to the records
+ * completed so far.
+ */
+#include <errno.h>
+#include <error.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "ping_log.h"
+
+struct target_summary {
+	char *name;
+	unsigned long long replies, dups, cksums, timeouts, errors;
+	long long rtt_min, rtt_max;
+	double rtt_sum;
+	unsigned long long timed;
+	uint64_t first, last;
+};
+
+static struct {
+	int text;
+	uint64_t from, to;		/* CLOCK_REALTIME nsec, inclusive */
+	const char *target;
+	struct target_summary *targets;
+	int ntargets;
+} opts = {
+	.to = UINT64_MAX,
+};
+
+static void __attribute__((__noreturn__)) usage(void)
+{
+	fprintf(stderr,
+		"\nUsage\n"
+		"  watchping-log [options] <file>...\n"
+		"\nOptions:\n"
+		"  -h                 print help and exit\n"
+		"  -r <from>,<to>     only records between these unix times, either may be left out\n"
+		"  -t                 print the records instead of a summary\n"
+		"  -T <target>        only records of <target>\n"
+	);
+	exit(2);
+}
+
+static uint64_t parse_time(const char *s, const char *end)
+{
+	char buf[64], *stop;
+	double t;
+
+	if (end == s)
+		return 0;
+	if ((size_t)(end - s) >= sizeof(buf))
+		error(2, 0, "invalid time: %s", s);
+	memcpy(buf, s, end - s);
+	buf[end - s] = '\0';
+	t = strtod(buf, &stop);
+	if (*stop || t < 0)
+		error(2, 0, "invalid time: %s", buf);
+	return t * 1e9;
+}
+
+static struct target_summary *summary_of(const char *name)
+{
+	struct target_summary *t;
+	int i;
+
+	for (i = 0; i < opts.ntargets; i++)
+		if (!strcmp(opts.targets[i].name, name))
+			return &opts.targets[i];
+	opts.targets = realloc(opts.targets, (opts.ntargets + 1) * sizeof(*opts.targets));
+	if (!opts.targets)
+		error(2, errno, "memory allocation failed");
+	t = &opts.targets[opts.ntargets++];
+	memset(t, 0, sizeof(*t));
+	t->name = strdup(name);
+	if (!t->name)
+		error(2, errno, "memory allocation failed");
+	t->rtt_min = LLONG_MAX;
+	return t;
+}
+
+static const char *status_name(int status)
+{
+	switch (status) {
+	case PING_LOG_REPLY:
+		return "reply";
+	case PING_LOG_DUP:
+		return "dup";
+	case PING_LOG_CKSUM:
+		return "cksum";
+	case PING_LOG_TIMEOUT:
+		return "timeout";
+	case PING_LOG_ERROR:
+		return "error";
+	}
+	return "?";
+}
+
+static void print_record(const struct ping_log_record *rec, const char *name)
+{
+	time_t sec = rec->time_ns / 1000000000;
+	char when[32];
+
+	strftime(when, sizeof(when), "%F %T", localtime(&sec));
+	printf("%s.%06llu %s seq=%u %s", when,
+	       (unsigned long long)(rec->time_ns % 1000000000) / 1000, name, rec->seq,
+	       status_name(rec->status));
+	if (rec->rtt_ns >= 0)
+		printf(" time=%lld.%06lld ms", (long long)rec->rtt_ns / 1000000,
+		       (long long)rec->rtt_ns % 1000000);
+	if (rec->ttl)
+		printf(" ttl=%u", rec->ttl);
+	putchar('\n');
+}
+
+static void add_record(struct target_summary *t, const struct ping_log_record *rec)
+{
+	if (!t->first || rec->time_ns < t->first)
+		t->first = rec->time_ns;
+	if (rec->time_ns > t->last)
+		t->last = rec->time_ns;
+
+	switch (rec->status) {
+	case PING_LOG_REPLY:
+		t->replies++;
+		if (rec->rtt_ns < 0)
+			break;
+		t->timed++;
+		t->rtt_sum += rec->rtt_ns;
+		if (rec->rtt_ns < t->rtt_min)
+			t->rtt_min = rec->rtt_ns;
+		if (rec->rtt_ns > t->rtt_max)
+			t->rtt_max = rec->rtt_ns;
+		break;
+	case PING_LOG_DUP:
+		t->dups++;
+		break;
+	case PING_LOG_CKSUM:
+		t->cksums++;
+		break;
+	case PING_LOG_TIMEOUT:
+		t->timeouts++;
+		break;
+	case PING_LOG_ERROR:
+		t->errors++;
+		break;
+	}
+}
+
+static void read_log(const char *path)
+{
+	const struct ping_log_header *h;
+	const struct ping_log_record *records;
+	static const char *names[UINT16_MAX + 1];
+	uint64_t count, i;
+	struct stat st;
+	size_t off = 0;
+	uint32_t n;
+	int fd;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0 || fstat(fd, &st) < 0)
+		error(2, errno, "%s", path);
+	if ((size_t)st.st_size < sizeof(*h))
+		error(2, 0, "%s: not a watchping log", path);
+	h = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	if (h == MAP_FAILED)
+		error(2, errno, "%s", path);
+	close(fd);
+
+	if (memcmp(h->magic, PING_LOG_MAGIC, sizeof(h->magic)))
+		error(2, 0, "%s: not a watchping log", path);
+	if (h->version != PING_LOG_VERSION || h->record_size != sizeof(*records) ||
+	    h->header_size != sizeof(*h))
+		error(2, 0, "%s: unsupported log version %u", path, h->version);
+
+	for (n = 0; n < h->ntargets && n <= UINT16_MAX; n++) {
+		size_t len = strnlen(h->targets + off, sizeof(h->targets) - off);
+
+		if (off + len >= sizeof(h->targets))
+			break;
+		names[n] = h->targets + off;
+		off += len + 1;
+	}
+
+	count = __atomic_load_n(&h->count, __ATOMIC_ACQUIRE);
+	if (count > (st.st_size - sizeof(*h)) / sizeof(*records))
+		count = (st.st_size - sizeof(*h)) / sizeof(*records);
+	records = (const struct ping_log_record *)((const char *)h + h->header_size);
+
+	for (i = 0; i < count; i++) {
+		const struct ping_log_record *rec = &records[i];
+		const char *name = rec->target < n ? names[rec->target] : "?";
+
+		if (rec->time_ns < opts.from || rec->time_ns > opts.to)
+			continue;
+		if (opts.target && strcmp(opts.target, name))
+			continue;
+		if (opts.text)
+			print_record(rec, name);
+		else
+			add_record(summary_of(name), rec);
+	}
+	munmap((void *)h, st.st_size);
+}
+
+static void print_summary(const struct target_summary *t)
+{
+	unsigned long long answered = t->replies + t->timeouts;
+
+	printf("%s: %llu replies, %llu timeouts, %llu errors, %llu duplicates, %llu bad checksums",
+	       t->name, t->replies, t->timeouts, t->errors, t->dups, t->cksums);
+	if (answered)
+		printf(", %g%% loss", 100.0 * t->timeouts / answered);
+	putchar('\n');
+	if (t->timed)
+		printf("  rtt min/avg/max = %.3f/%.3f/%.3f ms\n", t->rtt_min / 1e6,
+		       t->rtt_sum / t->timed / 1e6, t->rtt_max / 1e6);
+	if (t->first) {
+		time_t first = t->first / 1000000000, last = t->last / 1000000000;
+		char from[32], to[32];
+
+		strftime(from, sizeof(from), "%F %T", localtime(&first));
+		strftime(to, sizeof(to), "%F %T", localtime(&last));
+		printf("  from %s to %s\n", from, to);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	const char *comma;
+	int ch, i;
+
+	while ((ch = getopt(argc, argv, "hr:tT:")) != EOF) {
+		switch (ch) {
+		case 'r':
+			comma = strchr(optarg, ',');
+			if (!comma)
+				usage();
+			opts.from = parse_time(optarg, comma);
+			opts.to = parse_time(comma + 1, comma + 1 + strlen(comma + 1));
+			if (!opts.to)
+				opts.to = UINT64_MAX;
+			break;
+		case 't':
+			opts.text = 1;
+			break;
+		case 'T':
+			opts.target = optarg;
+			break;
+		default:
+			usage();
+		}
+	}
+	if (optind == argc)
+		usage();
+
+	for (i = optind; i < argc; i++)
+		read_log(argv[i]);
+	for (i = 0; i < opts.ntargets; i++)
+		print_summary(&opts.targets[i]);
+	return 0;
+}
@@ -5,6 +5,8 @@
 
 #define VERSION 1.0
 #define DEFAULT_INTERVAL 2
+#define DEFAULT_LOG_MBYTES 64
+#define DEFAULT_LOG_SEC 3600
 
 void setup_structs(struct addrinfo *hints, struct ping_rts *rts) {
     hints->ai_family = AF_UNSPEC;
@@ -16,7 +18,7 @@ void setup_structs(struct addrinfo *hints, struct ping_rts *rts) {
 	rts->preload = 1;
 	rts->lingertime = MAXWAIT * 1000;
 	rts->confirm_flag = MSG_CONFIRM;
-	rts->tmin = LONG_MAX;
+	ping_stats_init(&rts->stats, PING_EWMA_SHIFT);
 	rts->pipesize = -1;
 	rts->datalen = DEFDATALEN;
 	rts->screen_width = INT_MAX;
@@ -32,9 +34,14 @@ void setup_structs(struct addrinfo *hints, struct ping_rts *rts) {
 }
 
 void parse_args(int argc, char *argv[], struct watch_options *watch_args, struct addrinfo *hints, struct ping_rts *rts, 
-        char **outpack_fill, char **target) {
+        char **outpack_fill, char ***targets, int *ntargets) {
 
     int ch;
+    char *log_path = NULL;
+    char *metrics_addr = NULL;
+    char *shm_name = NULL;
+    long log_mbytes = DEFAULT_LOG_MBYTES;
+    long log_sec = DEFAULT_LOG_SEC;
     *outpack_fill = NULL;
 
     int currentIndex = 1;
@@ -49,7 +56,7 @@ void parse_args(int argc, char *argv[], struct watch_options *watch_args, struct
 		hints->ai_family = AF_INET6;
 
 	/* Parse command line options */
-	while ((ch = getopt(argc, argv, "h?" "4bRT:" "6F:N:" "aABdDfHi:I:l:Lm:M:nOp:PqQ:rs:S:t:UvVw:W:")) != EOF) {
+	while ((ch = getopt(argc, argv, "h?" "4bRT:" "6F:N:" "aABdDeE:fg:G:Hi:I:kl:Lm:M:no:Op:PqQ:rs:S:t:uUvVw:W:x:y:z:")) != EOF) {
 		switch(ch) {
 		/* IPv4 specific options */
 		case '4':
@@ -121,6 +128,30 @@ void parse_args(int argc, char *argv[], struct watch_options *watch_args, struct
 			rts->opt_ptimeofday = 1;
 			snprintf(current_arg, COMMAND_BUFFER_SIZE, " -D");
 			break;
+		case 'E':
+			metrics_addr = optarg;
+			snprintf(current_arg, COMMAND_BUFFER_SIZE, " -E %s", optarg);
+			break;
+		case 'g':
+			log_path = optarg;
+			snprintf(current_arg, COMMAND_BUFFER_SIZE, " -g %s", optarg);
+			break;
+		case 'G':
+		{
+			char *end;
+
+			log_mbytes = strtol(optarg, &end, 10);
+			if (*end == ',')
+				log_sec = strtol_or_err(end + 1, _("invalid argument"), 0, INT_MAX);
+			else if (*end)
+				error(2, 0, _("invalid -G argument: %s"), optarg);
+			if (end == optarg)
+				log_mbytes = DEFAULT_LOG_MBYTES;
+			else if (log_mbytes < 1 || log_mbytes > 1024 * 1024)
+				error(2, 0, _("invalid -G argument: %s"), optarg);
+			snprintf(current_arg, COMMAND_BUFFER_SIZE, " -G %s", optarg);
+		}
+			break;
         case 'H':
             watch_args->show_title = 0;
             break;
@@ -186,6 +217,16 @@ void parse_args(int argc, char *argv[], struct watch_options *watch_args, struct
 			rts->opt_numeric = 1;
 			snprintf(current_arg, COMMAND_BUFFER_SIZE, " -n");
 			break;
+		case 'o':
+			if (strcmp(optarg, "json") == 0)
+				rts->output = PING_OUTPUT_JSON;
+			else if (strcmp(optarg, "csv") == 0)
+				rts->output = PING_OUTPUT_CSV;
+			else
+				error(2, 0, _("invalid -o argument: %s"), optarg);
+			/* The records take the place of all text. */
+			rts->opt_quiet = 1;
+			break;
 		case 'O':
 			rts->opt_outstanding = 1;
 			snprintf(current_arg, COMMAND_BUFFER_SIZE, " -O");
@@ -233,6 +274,18 @@ void parse_args(int argc, char *argv[], struct watch_options *watch_args, struct
 			rts->opt_ttl = 1;
 			snprintf(current_arg, COMMAND_BUFFER_SIZE, " -t %s", optarg);
 			break;
+		case 'u':
+			rts->opt_io_uring = 1;
+			snprintf(current_arg, COMMAND_BUFFER_SIZE, " -u");
+			break;
+		case 'e':
+			rts->opt_nsec = 1;
+			snprintf(current_arg, COMMAND_BUFFER_SIZE, " -e");
+			break;
+		case 'k':
+			rts->opt_txstamp = 1;
+			snprintf(current_arg, COMMAND_BUFFER_SIZE, " -k");
+			break;
 		case 'U':
 			rts->opt_latency = 1;
 			snprintf(current_arg, COMMAND_BUFFER_SIZE, " -U");
@@ -260,6 +313,21 @@ void parse_args(int argc, char *argv[], struct watch_options *watch_args, struct
 			snprintf(current_arg, COMMAND_BUFFER_SIZE, " -W %s", optarg);
 		}
 			break;
+		case 'x':
+			watch_args->max_fps = ping_strtod(optarg, _("bad frame rate"));
+			if (!isgreater(watch_args->max_fps, 0) || isgreater(watch_args->max_fps, 1000))
+				error(2, 0, _("bad frame rate: %s"), optarg);
+			snprintf(current_arg, COMMAND_BUFFER_SIZE, " -x %s", optarg);
+			break;
+		case 'y':
+			ping_stats_init(&rts->stats, strtol_or_err(optarg, _("invalid argument"),
+								   1, PING_EWMA_SHIFT_MAX));
+			snprintf(current_arg, COMMAND_BUFFER_SIZE, " -y %s", optarg);
+			break;
+		case 'z':
+			shm_name = optarg;
+			snprintf(current_arg, COMMAND_BUFFER_SIZE, " -z %s", optarg);
+			break;
 		default:
 			print_usage();
 			break;
@@ -271,6 +339,13 @@ void parse_args(int argc, char *argv[], struct watch_options *watch_args, struct
 		}
 	}
 
+	if (log_path)
+		ping_log_config(log_path, (uint64_t)log_mbytes << 20, log_sec);
+	if (metrics_addr)
+		ping_metrics_config(metrics_addr);
+	if (shm_name)
+		ping_shm_config(shm_name);
+
 	argc -= optind;
 	argv += optind;
 
@@ -279,9 +354,12 @@ void parse_args(int argc, char *argv[], struct watch_options *watch_args, struct
 
 	iputils_srand();
 
-	*target = argv[argc - 1];
-	strncat(watch_args->command, " ", 1);
-	strncat(watch_args->command, *target, COMMAND_BUFFER_SIZE - 1);
+	*targets = argv;
+	*ntargets = argc;
+	for (int i = 0; i < argc; i++) {
+		strncat(watch_args->command, " ", 1);
+		strncat(watch_args->command, argv[i], COMMAND_BUFFER_SIZE - strlen(watch_args->command) - 1);
+	}
 
 	rts->outpack = malloc(rts->datalen + 28);
 	if (!rts->outpack)
@@ -299,17 +377,25 @@ int main(int argc, char *argv[]) {
 
     char command[COMMAND_BUFFER_SIZE];
     char *outpack_fill;
-    char *target;
+    char **targets;
+    int ntargets;
     struct watch_options watch_args;
     watch_args.interval = DEFAULT_INTERVAL;
     watch_args.show_title = 1;
     watch_args.precise_timekeeping = 0;
-    parse_args(argc, argv, &watch_args, hints, rts, &outpack_fill, &target);
+    watch_args.max_fps = 0;
+    parse_args(argc, argv, &watch_args, hints, rts, &outpack_fill, &targets, &ntargets);
 
     struct ping_setup_data pingSetupData;
-    ping_initialize(&pingSetupData, hints, rts, target);
+    ping_initialize(&pingSetupData, hints, rts, targets, ntargets);
 
     free(hints);
 
+    if (rts->output) {
+        int status = ping_output_run(&pingSetupData, watch_args.interval);
+
+        cleanup(&pingSetupData);
+        return status;
+    }
     return start_watch(&pingSetupData, &watch_args);
 }
\ No newline at end of file
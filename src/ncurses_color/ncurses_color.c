@@ -5,8 +5,12 @@
 #define BRIGHT_YELLOW 11
 #define BRIGHT_RED 9
 
+/* has_colors(), asked once; set_color() runs for every colored field. */
+static int colors;
+
 void initialize_colors() {
-    if(has_colors()){
+    colors = has_colors();
+    if(colors){
 		start_color();
         init_pair(NORMAL_COLOR_INDEX, BRIGHT_WHITE, COLOR_BLACK);
         init_pair(LOW_COLOR_INDEX, BRIGHT_GREEN, COLOR_BLACK);
@@ -16,7 +20,7 @@ void initialize_colors() {
 }
 
 void set_color(int index) {
-    if(has_colors()) {
+    if(colors && index != current_color) {
         if(index == NORMAL_COLOR_INDEX || index == LOW_COLOR_INDEX || index == MEDIUM_COLOR_INDEX || index == HIGH_COLOR_INDEX) {
             if(current_color) {
                 attroff(COLOR_PAIR(current_color));
@@ -28,32 +32,44 @@ void set_color(int index) {
     }
 }
 
-void set_ping_color(long timeWhole) {
+int ping_color(long timeWhole) {
     if(timeWhole < MEDIUM_PING_MIN) {
-        set_color(LOW_COLOR_INDEX);
+        return LOW_COLOR_INDEX;
     } else if(timeWhole < HIGH_PING_MIN) {
-        set_color(MEDIUM_COLOR_INDEX);
+        return MEDIUM_COLOR_INDEX;
     } else {
-        set_color(HIGH_COLOR_INDEX);
+        return HIGH_COLOR_INDEX;
     }
 }
 
-void set_packet_loss_color(float packet_loss) {
+int packet_loss_color(float packet_loss) {
     if(packet_loss < MEDIUM_PACKET_LOSS_MIN) {
-        set_color(LOW_COLOR_INDEX);
+        return LOW_COLOR_INDEX;
     } else if(packet_loss < HIGH_PACKET_LOSS_MIN) {
-        set_color(MEDIUM_COLOR_INDEX);
+        return MEDIUM_COLOR_INDEX;
     } else {
-        set_color(HIGH_COLOR_INDEX);
+        return HIGH_COLOR_INDEX;
     }
 }
 
-void set_deviation_color(long deviation) {
+int deviation_color(long deviation) {
     if(deviation < MEDIUM_DEVIATION_MIN) {
-        set_color(LOW_COLOR_INDEX);
+        return LOW_COLOR_INDEX;
     } else if(deviation < HIGH_DEVIATION_MIN) {
-        set_color(MEDIUM_COLOR_INDEX);
+        return MEDIUM_COLOR_INDEX;
     } else {
-        set_color(HIGH_COLOR_INDEX);
+        return HIGH_COLOR_INDEX;
     }
+}
+
+void set_ping_color(long timeWhole) {
+    set_color(ping_color(timeWhole));
+}
+
+void set_packet_loss_color(float packet_loss) {
+    set_color(packet_loss_color(packet_loss));
+}
+
+void set_deviation_color(long deviation) {
+    set_color(deviation_color(deviation));
 }
\ No newline at end of file
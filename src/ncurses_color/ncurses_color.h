@@ -17,6 +17,9 @@
 static int current_color;
 
 void initialize_colors();
+int ping_color(long timeWhole);
+int packet_loss_color(float packet_loss);
+int deviation_color(long deviation);
 void set_color(int index);
 void set_ping_color(long timeWhole);
 void set_packet_loss_color(float packet_loss);
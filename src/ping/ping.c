@@ -74,7 +74,7 @@ struct icmp_filter {
 #endif
 
 ping_func_set_st ping4_func_set = {
-	.send_probe = ping4_send_probe,
+	.build_probe = ping4_build_probe,
 	.receive_error_msg = ping4_receive_error_msg,
 	.parse_reply = ping4_parse_reply,
 	.install_filter = ping4_install_filter
@@ -160,8 +160,10 @@ static void create_socket(struct ping_rts *rts, socket_st *sock, int family,
 			error(0, errno, "socket");
 		if (requisite)
 			exit(2);
-	} else
+	} else {
 		sock->socktype = socktype;
+		sock->ident = rand() & 0xFFFF;
+	}
 }
 
 static void set_socket_option(socket_st *sock, int level, int optname,
@@ -256,10 +258,141 @@ int parsetos(char *str)
 	return (tos);
 }
 
-int ping_initialize(ping_setup_data* setup_data, struct addrinfo *hints, 
-		struct ping_rts *rts, char *target) {
+/* Resolve one destination and prepare its runtime state on the shared sockets. */
+static void ping_target_initialize(ping_setup_data *setup_data, struct addrinfo *hints,
+		struct ping_rts *rts, int target_ai_family)
+{
 	struct addrinfo *result, *ai;
+	char *target = rts->target;
 	int ret_val;
+
+	ret_val = getaddrinfo(target, NULL, hints, &result);
+	if (ret_val)
+		error(2, 0, "%s: %s", target, gai_strerror(ret_val));
+
+	for (ai = result; ai; ai = ai->ai_next) {
+		if (target_ai_family != AF_UNSPEC &&
+			target_ai_family != ai->ai_family) {
+			if (!ai->ai_next) {
+				/* An address was found, but not of the family we really want.
+				 * Throw the appropriate gai error.
+				 */
+				error(2, 0, "%s: %s", target, gai_strerror(EAI_ADDRFAMILY));
+			}
+			continue;
+		}
+		switch (ai->ai_family) {
+		case AF_INET:
+			rts->ipv4 = true;
+			rts->fset = &ping4_func_set;
+			rts->sock = setup_data->sock4;
+			ret_val = ping4_run(rts, ai, setup_data->sock4, setup_data, target);
+			break;
+		case AF_INET6:
+			rts->ipv4 = false;
+			rts->fset = &ping6_func_set;
+			rts->sock = setup_data->sock6;
+			ret_val = ping6_run(rts, ai, setup_data->sock6, setup_data, target);
+			break;
+		default:
+			error(2, 0, _("unknown protocol family: %d"), ai->ai_family);
+		}
+
+		if (ret_val >= 0)
+			break;
+		/* ret_val < 0 means to go on to next addrinfo result, there
+		 * better be one. */
+		assert(ai->ai_next);
+	}
+
+	freeaddrinfo(result);
+	rts->sock->ntargets++;
+	ping_targets_add(&setup_data->targets, rts);
+}
+
+/* What ping4_run()/ping6_run() make setup_data->packlen at least */
+static int target_packlen(struct ping_rts *rts, int ipv4)
+{
+	if (ipv4)
+		return rts->datalen + MAXIPLEN + MAXICMPLEN;
+	return rts->datalen + 8 + 4096 + 40 + 8;
+}
+
+/*
+ * ping_target_move --
+ *	Move "rts" to "addr" of the other address family, for when its own is
+ * gone from the DNS.  The socket ping_initialize() opened for that family
+ * is used, and only what ping4_run()/ping6_run() set up per target is done
+ * again.  Returns -1, with "rts" left as it was, if there is no such
+ * socket or no route to "addr", or if -I, -N or -F tie the target to its
+ * family.
+ */
+int ping_target_move(ping_setup_data *setup_data, struct ping_rts *rts,
+		     const struct sockaddr_storage *addr)
+{
+	bool ipv4 = addr->ss_family == AF_INET;
+	socket_st *sock = ipv4 ? setup_data->sock4 : setup_data->sock6;
+	struct addrinfo ai = {
+		.ai_family = addr->ss_family,
+		.ai_socktype = SOCK_RAW,
+		.ai_addrlen = ipv4 ? sizeof(struct sockaddr_in) : sizeof(struct sockaddr_in6),
+	};
+	struct sockaddr_storage to = *addr, dst = *addr;
+	struct timespec start_time = rts->start_time;
+	char *hostname = rts->hostname;
+	sigset_t mask;
+	int fd, ret;
+
+	if (sock->fd == -1 || rts->device || rts->opt_strictsource || rts->opt_flowinfo ||
+	    niquery_is_enabled(&rts->ni) || target_packlen(rts, ipv4) > setup_data->packlen)
+		return -1;
+
+	/* ping4_run()/ping6_run() find the source address by connecting a
+	 * UDP socket, and take failing to as fatal: try it first. */
+	if (ipv4)
+		((struct sockaddr_in *)&dst)->sin_port = htons(1025);
+	else
+		((struct sockaddr_in6 *)&dst)->sin6_port = htons(1025);
+	fd = socket(addr->ss_family, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+	if (fd < 0)
+		return -1;
+	ret = connect(fd, (struct sockaddr *)&dst, ai.ai_addrlen);
+	close(fd);
+	if (ret < 0)
+		return -1;
+
+	ai.ai_addr = (struct sockaddr *)&to;
+	memset(&rts->source, 0, sizeof(rts->source));
+	memset(&rts->source6, 0, sizeof(rts->source6));
+	memset(&rts->firsthop, 0, sizeof(rts->firsthop));
+	rts->sock->ntargets--;
+	rts->ipv4 = ipv4;
+	rts->fset = ipv4 ? &ping4_func_set : &ping6_func_set;
+	rts->sock = sock;
+
+	/* setup() unblocks every signal, which is the main thread's to take. */
+	pthread_sigmask(SIG_SETMASK, NULL, &mask);
+	if (ipv4)
+		ping4_run(rts, &ai, sock, setup_data, rts->target);
+	else
+		ping6_run(rts, &ai, sock, setup_data, rts->target);
+	pthread_sigmask(SIG_SETMASK, &mask, NULL);
+
+	/* The name and the running time stay those of the start. */
+	if (rts->hostname != hostname && rts->hostname != rts->target)
+		free(rts->hostname);
+	rts->hostname = hostname;
+	rts->start_time = start_time;
+
+	sock->ntargets++;
+	ping_socket_register(setup_data, sock);
+	ping_targets_rehash(&setup_data->targets);
+	return 0;
+}
+
+int ping_initialize(ping_setup_data* setup_data, struct addrinfo *hints, 
+		struct ping_rts *rts, char **targets, int ntargets) {
+	int i;
 	socket_st *sock4 = (socket_st *)malloc(sizeof(socket_st));
 	memset(sock4, 0, sizeof(socket_st));
 	sock4->fd = -1;
@@ -267,6 +400,10 @@ int ping_initialize(ping_setup_data* setup_data, struct addrinfo *hints,
 	memset(sock6, 0, sizeof(socket_st));
 	sock6->fd = -1;
 
+	memset(setup_data, 0, sizeof(*setup_data));
+	setup_data->sock4 = sock4;
+	setup_data->sock6 = sock6;
+
 	/* FIXME: global_rts will be removed in future */
 	global_rts = rts;
 
@@ -314,6 +451,11 @@ int ping_initialize(ping_setup_data* setup_data, struct addrinfo *hints,
 	if (rts->tclass)
 		set_socket_option(sock6, IPPROTO_IPV6, IPV6_TCLASS, &rts->tclass, sizeof rts->tclass);
 
+	/* Per-reply lines of several targets would interleave on the screen,
+	 * a summary line per target is shown instead. */
+	if (ntargets > 1)
+		rts->opt_quiet = 1;
+
 	/* getaddrinfo fails to indicate a scopeid when not used in dual-stack mode.
 	 * Work around by always using dual-stack name resolution.
 	 *
@@ -322,46 +464,50 @@ int ping_initialize(ping_setup_data* setup_data, struct addrinfo *hints,
 	int target_ai_family = hints->ai_family;
 	hints->ai_family = AF_UNSPEC;
 
-	ret_val = getaddrinfo(target, NULL, hints, &result);
-	if (ret_val)
-		error(2, 0, "%s: %s", target, gai_strerror(ret_val));
-
-	for (ai = result; ai; ai = ai->ai_next) {
-		if (target_ai_family != AF_UNSPEC &&
-			target_ai_family != ai->ai_family) {
-			if (!ai->ai_next) {
-				/* An address was found, but not of the family we really want.
-				 * Throw the appropriate gai error.
-				 */
-				error(2, 0, "%s: %s", target, gai_strerror(EAI_ADDRFAMILY));
-			}
-			continue;
-		}
-		switch (ai->ai_family) {
-		case AF_INET:
-			setup_data->ipv4 = true;
-			ret_val = ping4_run(rts, ai, sock4, setup_data, target);
-			break;
-		case AF_INET6:
-			setup_data->ipv4 = false;
-			ret_val = ping6_run(rts, ai, sock6, setup_data, target);
-			break;
-		default:
-			error(2, 0, _("unknown protocol family: %d"), ai->ai_family);
+	/* The first target keeps the parsed options, every further target
+	 * starts from an untouched copy of them. */
+	struct ping_rts *template = malloc(sizeof(*template));
+	if (!template)
+		error(2, errno, _("memory allocation failed"));
+	memcpy(template, rts, sizeof(*template));
+	template->targets = &setup_data->targets;
+
+	for (i = 0; i < ntargets; i++) {
+		struct ping_rts *trts = rts;
+
+		if (i > 0) {
+			trts = malloc(sizeof(*trts));
+			if (!trts)
+				error(2, errno, _("memory allocation failed"));
+			memcpy(trts, template, sizeof(*trts));
+			trts->outpack = malloc(trts->datalen + 28);
+			if (!trts->outpack)
+				error(2, errno, _("memory allocation failed"));
+			memcpy(trts->outpack, template->outpack, trts->datalen + 28);
 		}
+		trts->targets = &setup_data->targets;
+		trts->target = targets[i];
+		ping_target_initialize(setup_data, hints, trts, target_ai_family);
+	}
+	free(template);
 
-		if (ret_val >= 0)
-			break;
-		/* ret_val < 0 means to go on to next addrinfo result, there
-		 * better be one. */
-		assert(ai->ai_next);
+	/* A target may move to the other family later, see ping_target_move();
+	 * the receive buffers must then fit its replies too. */
+	if (sock4->fd != -1 && sock6->fd != -1) {
+		int packlen = target_packlen(rts, 0);
+
+		if (packlen > setup_data->packlen)
+			setup_data->packlen = packlen;
 	}
 
-	setup_data->result = result;
-	setup_data->sock4 = sock4;
-	setup_data->sock6 = sock6;
+	drop_capabilities();
+	ping_metrics_start();
 
-	return ret_val;
+	ping_recv_batch_init(setup_data);
+	if (rts->opt_io_uring)
+		ping_uring_init(setup_data);
+
+	return 0;
 }
 
 /* return >= 0: exit with this code, < 0: go on to next addrinfo result */
@@ -373,7 +519,6 @@ int ping4_run(struct ping_rts *rts, struct addrinfo *ai, socket_st *sock,
 		.ai_flags = getaddrinfo_flags
 	};
 	int hold, packlen;
-	unsigned char *packet;
 	char hnamebuf[NI_MAXHOST];
 	unsigned char rspace[3 + 4 * NROUTES + 1];	/* record route space */
 	uint32_t *tmp_rspace;
@@ -391,7 +536,9 @@ int ping4_run(struct ping_rts *rts, struct addrinfo *ai, socket_st *sock,
 		memset(hnamebuf, 0, sizeof hnamebuf);
 		if (result->ai_canonname)
 			strncpy(hnamebuf, result->ai_canonname, sizeof hnamebuf - 1);
-		rts->hostname = hnamebuf;
+		rts->hostname = strdup(hnamebuf);
+		if (!rts->hostname)
+			error(2, errno, _("memory allocation failed"));
 
 	}
 
@@ -554,9 +701,11 @@ int ping4_run(struct ping_rts *rts, struct addrinfo *ai, socket_st *sock,
 			error(2, errno, "IP_MTU_DISCOVER");
 	}
 
-	if (rts->opt_strictsource &&
-	    bind(sock->fd, (struct sockaddr *)&rts->source, sizeof rts->source) == -1)
-		error(2, errno, "bind");
+	if (rts->opt_strictsource && !sock->bound) {
+		if (bind(sock->fd, (struct sockaddr *)&rts->source, sizeof rts->source) == -1)
+			error(2, errno, "bind");
+		sock->bound = 1;
+	}
 
 	if (sock->socktype == SOCK_RAW) {
 		struct icmp_filter filt;
@@ -655,20 +804,14 @@ int ping4_run(struct ping_rts *rts, struct addrinfo *ai, socket_st *sock,
 			error(2, errno, _("cannot set unicast time-to-live"));
 	}
 
-	if (rts->datalen >= (int)sizeof(struct timeval))	/* can we time transfer */
+	if (rts->datalen >= (int)sizeof(struct timespec))	/* can we time transfer */
 		rts->timing = 1;
 	packlen = rts->datalen + MAXIPLEN + MAXICMPLEN;
-	if (!(packet = (unsigned char *)malloc((unsigned int)packlen)))
-		error(2, errno, _("memory allocation failed"));
+	if (packlen > setup_data->packlen)
+		setup_data->packlen = packlen;
 
 	setup(rts, sock);
 
-	//hold = main_loop(rts, &ping4_func_set, sock, packet, packlen);
-	setup_data->rts = rts;
-	setup_data->fset = &ping4_func_set;
-	setup_data->packet = packet;
-	setup_data->packlen = packlen;
-
 	return 0;
 }
 
@@ -695,10 +838,31 @@ void print_ping_header(bool ipv4, struct ping_rts *rts) {
 }
 
 void cleanup(ping_setup_data *setup_data) {
+	int i;
+
+	ping_log_close();
+	ping_shm_close();
 	free(setup_data->packet);
-	freeaddrinfo(setup_data->result);
-	free(setup_data->rts->outpack);
-	free(setup_data->rts);
+	free(setup_data->recv);
+	ping_uring_cleanup(setup_data);
+	for (i = 0; i < setup_data->targets.count; i++) {
+		struct ping_rts *rts = setup_data->targets.list[i];
+
+		if (rts->hostname != rts->target)
+			free(rts->hostname);
+		free(rts->outpack);
+		free(rts->sendpack);
+		free(rts->timeouts);
+		free(rts->text);
+		free(rts->hist);
+		free(rts->jitter.ipdv);
+		free(rts->windows);
+		free(rts);
+	}
+	free(setup_data->targets.list);
+	free(setup_data->targets.hash);
+	free(setup_data->sock4->tx_slots);
+	free(setup_data->sock6->tx_slots);
 	free(setup_data->sock4);
 	free(setup_data->sock6);
 }
@@ -720,7 +884,7 @@ static void pr_options(struct ping_rts *rts, unsigned char *cp, int hlen)
 		if (*optptr == IPOPT_NOP) {
 			totlen--;
 			optptr++;
-			printf(_("\nNOP"));
+			ping_printf(rts, _("\nNOP"));
 			continue;
 		}
 		cp = optptr;
@@ -731,7 +895,7 @@ static void pr_options(struct ping_rts *rts, unsigned char *cp, int hlen)
 		switch (*cp) {
 		case IPOPT_SSRR:
 		case IPOPT_LSRR:
-			printf(_("\n%cSRR: "), *cp == IPOPT_SSRR ? 'S' : 'L');
+			ping_printf(rts, _("\n%cSRR: "), *cp == IPOPT_SSRR ? 'S' : 'L');
 			j = *++cp;
 			cp++;
 			if (j > IPOPT_MINOFF) {
@@ -740,7 +904,7 @@ static void pr_options(struct ping_rts *rts, unsigned char *cp, int hlen)
 					memcpy(&address, cp, 4);
 					cp += 4;
 					if (address == 0)
-						printf("\t0.0.0.0");
+						ping_printf(rts, "\t0.0.0.0");
 					else {
 						struct sockaddr_in sin = {
 							.sin_family = AF_INET,
@@ -749,10 +913,10 @@ static void pr_options(struct ping_rts *rts, unsigned char *cp, int hlen)
 							}
 						};
 
-						printf("\t%s", pr_addr(rts, &sin, sizeof sin));
+						ping_printf(rts, "\t%s", pr_addr(rts, &sin, sizeof sin));
 					}
 					j -= 4;
-					putchar('\n');
+					ping_printf(rts, "\n");
 					if (j <= IPOPT_MINOFF)
 						break;
 				}
@@ -769,19 +933,19 @@ static void pr_options(struct ping_rts *rts, unsigned char *cp, int hlen)
 			if (i == old_rrlen
 			    && !memcmp(cp, old_rr, i)
 			    && !rts->opt_flood) {
-				printf(_("\t(same route)"));
+				ping_printf(rts, _("\t(same route)"));
 				break;
 			}
 			old_rrlen = i;
 			memcpy(old_rr, (char *)cp, i);
-			printf(_("\nRR: "));
+			ping_printf(rts, _("\nRR: "));
 			cp++;
 			for (;;) {
 				uint32_t address;
 				memcpy(&address, cp, 4);
 				cp += 4;
 				if (address == 0)
-					printf("\t0.0.0.0");
+					ping_printf(rts, "\t0.0.0.0");
 				else {
 					struct sockaddr_in sin = {
 						.sin_family = AF_INET,
@@ -790,10 +954,10 @@ static void pr_options(struct ping_rts *rts, unsigned char *cp, int hlen)
 						}
 					};
 
-					printf("\t%s", pr_addr(rts, &sin, sizeof sin));
+					ping_printf(rts, "\t%s", pr_addr(rts, &sin, sizeof sin));
 				}
 				i -= 4;
-				putchar('\n');
+				ping_printf(rts, "\n");
 				if (i <= 0)
 					break;
 			}
@@ -810,7 +974,7 @@ static void pr_options(struct ping_rts *rts, unsigned char *cp, int hlen)
 			if (i <= 0)
 				break;
 			flags = *++cp;
-			printf(_("\nTS: "));
+			ping_printf(rts, _("\nTS: "));
 			cp++;
 			for (;;) {
 				long l;
@@ -820,7 +984,7 @@ static void pr_options(struct ping_rts *rts, unsigned char *cp, int hlen)
 					memcpy(&address, cp, 4);
 					cp += 4;
 					if (address == 0)
-						printf("\t0.0.0.0");
+						ping_printf(rts, "\t0.0.0.0");
 					else {
 						struct sockaddr_in sin = {
 							.sin_family = AF_INET,
@@ -829,7 +993,7 @@ static void pr_options(struct ping_rts *rts, unsigned char *cp, int hlen)
 							}
 						};
 
-						printf("\t%s", pr_addr(rts, &sin, sizeof sin));
+						ping_printf(rts, "\t%s", pr_addr(rts, &sin, sizeof sin));
 					}
 					i -= 4;
 					if (i <= 0)
@@ -842,28 +1006,28 @@ static void pr_options(struct ping_rts *rts, unsigned char *cp, int hlen)
 
 				if (l & 0x80000000) {
 					if (nonstdtime == 0)
-						printf(_("\t%ld absolute not-standard"), l & 0x7fffffff);
+						ping_printf(rts, _("\t%ld absolute not-standard"), l & 0x7fffffff);
 					else
-						printf(_("\t%ld not-standard"), (l & 0x7fffffff) - nonstdtime);
+						ping_printf(rts, _("\t%ld not-standard"), (l & 0x7fffffff) - nonstdtime);
 					nonstdtime = l & 0x7fffffff;
 				} else {
 					if (stdtime == 0)
-						printf(_("\t%ld absolute"), l);
+						ping_printf(rts, _("\t%ld absolute"), l);
 					else
-						printf("\t%ld", l - stdtime);
+						ping_printf(rts, "\t%ld", l - stdtime);
 					stdtime = l;
 				}
 				i -= 4;
-				putchar('\n');
+				ping_printf(rts, "\n");
 				if (i <= 0)
 					break;
 			}
 			if (flags >> 4)
-				printf(_("Unrecorded hops: %d\n"), flags >> 4);
+				ping_printf(rts, _("Unrecorded hops: %d\n"), flags >> 4);
 			break;
 		}
 		default:
-			printf(_("\nunknown option %x"), *cp);
+			ping_printf(rts, _("\nunknown option %x"), *cp);
 			break;
 		}
 		totlen -= olen;
@@ -883,15 +1047,15 @@ static void pr_iph(struct ping_rts *rts, struct iphdr *ip)
 	hlen = ip->ihl << 2;
 	cp = (unsigned char *)ip + 20;		/* point to options */
 
-	printf(_("Vr HL TOS  Len   ID Flg  off TTL Pro  cks      Src      Dst Data\n"));
-	printf(_(" %1x  %1x  %02x %04x %04x"),
+	ping_printf(rts, _("Vr HL TOS  Len   ID Flg  off TTL Pro  cks      Src      Dst Data\n"));
+	ping_printf(rts, _(" %1x  %1x  %02x %04x %04x"),
 	       ip->version, ip->ihl, ip->tos, ip->tot_len, ip->id);
-	printf(_("   %1x %04x"), ((ip->frag_off) & 0xe000) >> 13,
+	ping_printf(rts, _("   %1x %04x"), ((ip->frag_off) & 0xe000) >> 13,
 	       (ip->frag_off) & 0x1fff);
-	printf(_("  %02x  %02x %04x"), ip->ttl, ip->protocol, ip->check);
-	printf(" %s ", inet_ntoa(*(struct in_addr *)&ip->saddr));
-	printf(" %s ", inet_ntoa(*(struct in_addr *)&ip->daddr));
-	printf("\n");
+	ping_printf(rts, _("  %02x  %02x %04x"), ip->ttl, ip->protocol, ip->check);
+	ping_printf(rts, " %s ", inet_ntoa(*(struct in_addr *)&ip->saddr));
+	ping_printf(rts, " %s ", inet_ntoa(*(struct in_addr *)&ip->daddr));
+	ping_printf(rts, "\n");
 	pr_options(rts, cp, hlen);
 }
 
@@ -904,87 +1068,87 @@ static void pr_icmph(struct ping_rts *rts, uint8_t type, uint8_t code,
 {
 	switch (type) {
 	case ICMP_ECHOREPLY:
-		printf(_("Echo Reply\n"));
+		ping_printf(rts, _("Echo Reply\n"));
 		/* XXX ID + Seq + Data */
 		break;
 	case ICMP_DEST_UNREACH:
 		switch (code) {
 		case ICMP_NET_UNREACH:
-			printf(_("Destination Net Unreachable\n"));
+			ping_printf(rts, _("Destination Net Unreachable\n"));
 			break;
 		case ICMP_HOST_UNREACH:
-			printf(_("Destination Host Unreachable\n"));
+			ping_printf(rts, _("Destination Host Unreachable\n"));
 			break;
 		case ICMP_PROT_UNREACH:
-			printf(_("Destination Protocol Unreachable\n"));
+			ping_printf(rts, _("Destination Protocol Unreachable\n"));
 			break;
 		case ICMP_PORT_UNREACH:
-			printf(_("Destination Port Unreachable\n"));
+			ping_printf(rts, _("Destination Port Unreachable\n"));
 			break;
 		case ICMP_FRAG_NEEDED:
-			printf(_("Frag needed and DF set (mtu = %u)\n"), info);
+			ping_printf(rts, _("Frag needed and DF set (mtu = %u)\n"), info);
 			break;
 		case ICMP_SR_FAILED:
-			printf(_("Source Route Failed\n"));
+			ping_printf(rts, _("Source Route Failed\n"));
 			break;
 		case ICMP_NET_UNKNOWN:
-			printf(_("Destination Net Unknown\n"));
+			ping_printf(rts, _("Destination Net Unknown\n"));
 			break;
 		case ICMP_HOST_UNKNOWN:
-			printf(_("Destination Host Unknown\n"));
+			ping_printf(rts, _("Destination Host Unknown\n"));
 			break;
 		case ICMP_HOST_ISOLATED:
-			printf(_("Source Host Isolated\n"));
+			ping_printf(rts, _("Source Host Isolated\n"));
 			break;
 		case ICMP_NET_ANO:
-			printf(_("Destination Net Prohibited\n"));
+			ping_printf(rts, _("Destination Net Prohibited\n"));
 			break;
 		case ICMP_HOST_ANO:
-			printf(_("Destination Host Prohibited\n"));
+			ping_printf(rts, _("Destination Host Prohibited\n"));
 			break;
 		case ICMP_NET_UNR_TOS:
-			printf(_("Destination Net Unreachable for Type of Service\n"));
+			ping_printf(rts, _("Destination Net Unreachable for Type of Service\n"));
 			break;
 		case ICMP_HOST_UNR_TOS:
-			printf(_("Destination Host Unreachable for Type of Service\n"));
+			ping_printf(rts, _("Destination Host Unreachable for Type of Service\n"));
 			break;
 		case ICMP_PKT_FILTERED:
-			printf(_("Packet filtered\n"));
+			ping_printf(rts, _("Packet filtered\n"));
 			break;
 		case ICMP_PREC_VIOLATION:
-			printf(_("Precedence Violation\n"));
+			ping_printf(rts, _("Precedence Violation\n"));
 			break;
 		case ICMP_PREC_CUTOFF:
-			printf(_("Precedence Cutoff\n"));
+			ping_printf(rts, _("Precedence Cutoff\n"));
 			break;
 		default:
-			printf(_("Dest Unreachable, Bad Code: %d\n"), code);
+			ping_printf(rts, _("Dest Unreachable, Bad Code: %d\n"), code);
 			break;
 		}
 		if (icp && rts->opt_verbose)
 			pr_iph(rts, (struct iphdr *)(icp + 1));
 		break;
 	case ICMP_SOURCE_QUENCH:
-		printf(_("Source Quench\n"));
+		ping_printf(rts, _("Source Quench\n"));
 		if (icp && rts->opt_verbose)
 			pr_iph(rts, (struct iphdr *)(icp + 1));
 		break;
 	case ICMP_REDIRECT:
 		switch (code) {
 		case ICMP_REDIR_NET:
-			printf(_("Redirect Network"));
+			ping_printf(rts, _("Redirect Network"));
 			break;
 		case ICMP_REDIR_HOST:
-			printf(_("Redirect Host"));
+			ping_printf(rts, _("Redirect Host"));
 			break;
 		case ICMP_REDIR_NETTOS:
-			printf(_("Redirect Type of Service and Network"));
+			ping_printf(rts, _("Redirect Type of Service and Network"));
 			break;
 		case ICMP_REDIR_HOSTTOS:
-			printf(_("Redirect Type of Service and Host"));
+			ping_printf(rts, _("Redirect Type of Service and Host"));
 			break;
 		default:
-			printf(_("Redirect, Bad Code: %d"), code);
+			ping_printf(rts, _("Redirect, Bad Code: %d"), code);
 			break;
 		}
 		{
@@ -995,197 +1159,193 @@ static void pr_icmph(struct ping_rts *rts, uint8_t type, uint8_t code,
 				}
 			};
 
-			printf(_("(New nexthop: %s)\n"), pr_addr(rts, &sin, sizeof sin));
+			ping_printf(rts, _("(New nexthop: %s)\n"), pr_addr(rts, &sin, sizeof sin));
 		}
 		if (icp && rts->opt_verbose)
 			pr_iph(rts, (struct iphdr *)(icp + 1));
 		break;
 	case ICMP_ECHO:
-		printf(_("Echo Request\n"));
+		ping_printf(rts, _("Echo Request\n"));
 		/* XXX ID + Seq + Data */
 		break;
 	case ICMP_TIME_EXCEEDED:
 		switch(code) {
 		case ICMP_EXC_TTL:
-			printf(_("Time to live exceeded\n"));
+			ping_printf(rts, _("Time to live exceeded\n"));
 			break;
 		case ICMP_EXC_FRAGTIME:
-			printf(_("Frag reassembly time exceeded\n"));
+			ping_printf(rts, _("Frag reassembly time exceeded\n"));
 			break;
 		default:
-			printf(_("Time exceeded, Bad Code: %d\n"), code);
+			ping_printf(rts, _("Time exceeded, Bad Code: %d\n"), code);
 			break;
 		}
 		if (icp && rts->opt_verbose)
 			pr_iph(rts, (struct iphdr *)(icp + 1));
 		break;
 	case ICMP_PARAMETERPROB:
-		printf(_("Parameter problem: pointer = %u\n"),
+		ping_printf(rts, _("Parameter problem: pointer = %u\n"),
 			icp ? (ntohl(icp->un.gateway) >> 24) : info);
 		if (icp && rts->opt_verbose)
 			pr_iph(rts, (struct iphdr *)(icp + 1));
 		break;
 	case ICMP_TIMESTAMP:
-		printf(_("Timestamp\n"));
+		ping_printf(rts, _("Timestamp\n"));
 		/* XXX ID + Seq + 3 timestamps */
 		break;
 	case ICMP_TIMESTAMPREPLY:
-		printf(_("Timestamp Reply\n"));
+		ping_printf(rts, _("Timestamp Reply\n"));
 		/* XXX ID + Seq + 3 timestamps */
 		break;
 	case ICMP_INFO_REQUEST:
-		printf(_("Information Request\n"));
+		ping_printf(rts, _("Information Request\n"));
 		/* XXX ID + Seq */
 		break;
 	case ICMP_INFO_REPLY:
-		printf(_("Information Reply\n"));
+		ping_printf(rts, _("Information Reply\n"));
 		/* XXX ID + Seq */
 		break;
 #ifdef ICMP_MASKREQ
 	case ICMP_MASKREQ:
-		printf(_("Address Mask Request\n"));
+		ping_printf(rts, _("Address Mask Request\n"));
 		break;
 #endif
 #ifdef ICMP_MASKREPLY
 	case ICMP_MASKREPLY:
-		printf(_("Address Mask Reply\n"));
+		ping_printf(rts, _("Address Mask Reply\n"));
 		break;
 #endif
 	default:
-		printf(_("Bad ICMP type: %d\n"), type);
+		ping_printf(rts, _("Bad ICMP type: %d\n"), type);
 	}
 }
 
+/*
+ * ping4_receive_error_msg --
+ *	Drain up to PING_ERR_BATCH entries from the socket error queue with
+ * one recvmmsg() call.  Returns the number of ICMP errors for our probes,
+ * or minus the number of local errors if there were none.
+ */
 int ping4_receive_error_msg(struct ping_rts *rts, socket_st *sock)
 {
-	ssize_t res;
-	char cbuf[512];
-	struct iovec iov;
-	struct msghdr msg;
-	struct cmsghdr *cmsgh;
-	struct sock_extended_err *e;
-	struct icmphdr icmph;
-	struct sockaddr_in target;
+	struct mmsghdr msgs[PING_ERR_BATCH];
+	struct iovec iov[PING_ERR_BATCH];
+	char cbuf[PING_ERR_BATCH][512];
+	struct icmphdr icmphs[PING_ERR_BATCH];
+	struct sockaddr_in targets[PING_ERR_BATCH];
 	int net_errors = 0;
 	int local_errors = 0;
 	int saved_errno = errno;
-
-	iov.iov_base = &icmph;
-	iov.iov_len = sizeof(icmph);
-	msg.msg_name = (void *)&target;
-	msg.msg_namelen = sizeof(target);
-	msg.msg_iov = &iov;
-	msg.msg_iovlen = 1;
-	msg.msg_flags = 0;
-	msg.msg_control = cbuf;
-	msg.msg_controllen = sizeof(cbuf);
-
-	res = recvmsg(sock->fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT);
-	if (res < 0)
-		goto out;
-
-	e = NULL;
-	for (cmsgh = CMSG_FIRSTHDR(&msg); cmsgh; cmsgh = CMSG_NXTHDR(&msg, cmsgh)) {
-		if (cmsgh->cmsg_level == SOL_IP) {
-			if (cmsgh->cmsg_type == IP_RECVERR)
-				e = (struct sock_extended_err *)CMSG_DATA(cmsgh);
-		}
-	}
-	if (e == NULL)
-		abort();
-
-	if (e->ee_origin == SO_EE_ORIGIN_LOCAL) {
-		local_errors++;
-		if (rts->opt_quiet)
-			goto out;
-		if (rts->opt_flood)
-			write_stdout("E", 1);
-		else if (e->ee_errno != EMSGSIZE)
-			error(0, 0, _("local error: %s"), strerror(e->ee_errno));
-		else
-			error(0, 0, _("local error: message too long, mtu=%u"), e->ee_info);
-		rts->nerrors++;
-	} else if (e->ee_origin == SO_EE_ORIGIN_ICMP) {
-		struct sockaddr_in *sin = (struct sockaddr_in *)(e + 1);
-
-		if (res < (ssize_t) sizeof(icmph) ||
-		    target.sin_addr.s_addr != rts->whereto.sin_addr.s_addr ||
-		    icmph.type != ICMP_ECHO ||
-		    !is_ours(rts, sock, icmph.un.echo.id)) {
-			/* Not our error, not an error at all. Clear. */
-			saved_errno = 0;
-			goto out;
+	int n, i;
+
+	/* Drain the queue, it fills quickly with timestamps. */
+	do {
+		memset(msgs, 0, sizeof(msgs));
+		for (i = 0; i < PING_ERR_BATCH; i++) {
+			iov[i].iov_base = &icmphs[i];
+			iov[i].iov_len = sizeof(icmphs[i]);
+			msgs[i].msg_hdr.msg_name = (void *)&targets[i];
+			msgs[i].msg_hdr.msg_namelen = sizeof(targets[i]);
+			msgs[i].msg_hdr.msg_iov = &iov[i];
+			msgs[i].msg_hdr.msg_iovlen = 1;
+			msgs[i].msg_hdr.msg_control = cbuf[i];
+			msgs[i].msg_hdr.msg_controllen = sizeof(cbuf[i]);
 		}
 
-		acknowledge(rts, ntohs(icmph.un.echo.sequence));
+		n = recvmmsg(sock->fd, msgs, PING_ERR_BATCH, MSG_ERRQUEUE | MSG_DONTWAIT, NULL);
 
-		if (sock->socktype == SOCK_RAW) {
-			struct icmp_filter filt;
+		for (i = 0; i < n; i++) {
+			struct msghdr *msg = &msgs[i].msg_hdr;
+			ssize_t res = msgs[i].msg_len;
+			struct icmphdr icmph = icmphs[i];
+			struct sockaddr_in target = targets[i];
+			struct ping_rts *trts = rts;
+			struct cmsghdr *cmsgh;
+			struct sock_extended_err *e;
 
-			filt.data = ~((1 << ICMP_SOURCE_QUENCH) |
-				      (1 << ICMP_REDIRECT) |
-				      (1 << ICMP_ECHOREPLY));
-			if (setsockopt(sock->fd, SOL_RAW, ICMP_FILTER, (const void *)&filt,
-				       sizeof(filt)) == -1)
-				error(2, errno, "setsockopt(ICMP_FILTER)");
-		}
-		net_errors++;
-		rts->nerrors++;
-		if (rts->opt_quiet)
-			goto out;
-		if (rts->opt_flood) {
-			write_stdout("\bE", 2);
-		} else {
-			print_timestamp(rts);
-			printw(_("From %s icmp_seq=%u "), pr_addr(rts, sin, sizeof *sin), ntohs(icmph.un.echo.sequence));
-			pr_icmph(rts, e->ee_type, e->ee_code, e->ee_info, NULL);
-			fflush(stdout);
-		}
-	}
+			/* The error may belong to any target sharing this socket. */
+			if (msg->msg_namelen >= sizeof(target)) {
+				struct ping_rts *owner = ping_target_lookup(rts, AF_INET, &target.sin_addr);
 
-out:
-	errno = saved_errno;
-	return net_errors ? net_errors : -local_errors;
-}
+				if (owner)
+					trts = owner;
+			}
 
-#if BYTE_ORDER == LITTLE_ENDIAN
-# define ODDBYTE(v)	(v)
-#elif BYTE_ORDER == BIG_ENDIAN
-# define ODDBYTE(v)	((unsigned short)(v) << 8)
-#else
-# define ODDBYTE(v)	htons((unsigned short)(v) << 8)
-#endif
+			e = NULL;
+			for (cmsgh = CMSG_FIRSTHDR(msg); cmsgh; cmsgh = CMSG_NXTHDR(msg, cmsgh)) {
+				if (cmsgh->cmsg_level == SOL_IP) {
+					if (cmsgh->cmsg_type == IP_RECVERR)
+						e = (struct sock_extended_err *)CMSG_DATA(cmsgh);
+				}
+			}
+			if (e == NULL)
+				abort();
 
-static unsigned short
-in_cksum(const unsigned short *addr, int len, unsigned short csum)
-{
-	int nleft = len;
-	const unsigned short *w = addr;
-	unsigned short answer;
-	int sum = csum;
-
-	/*
-	 *  Our algorithm is simple, using a 32 bit accumulator (sum),
-	 *  we add sequential 16 bit words to it, and at the end, fold
-	 *  back all the carry bits from the top 16 bits into the lower
-	 *  16 bits.
-	 */
-	while (nleft > 1) {
-		sum += *w++;
-		nleft -= 2;
-	}
+			/* -k: transmit timestamps share the queue with errors. */
+			if (ping_tx_timestamp(sock, msg, e))
+				continue;
 
-	/* mop up an odd byte, if necessary */
-	if (nleft == 1)
-		sum += ODDBYTE(*(unsigned char *)w); /* le16toh() may be unavailable on old systems */
+			if (e->ee_origin == SO_EE_ORIGIN_LOCAL) {
+				local_errors++;
+				if (trts->opt_quiet)
+					continue;
+				if (trts->opt_flood)
+					write_stdout("E", 1);
+				else if (e->ee_errno != EMSGSIZE)
+					error(0, 0, _("local error: %s"), strerror(e->ee_errno));
+				else
+					error(0, 0, _("local error: message too long, mtu=%u"), e->ee_info);
+				trts->nerrors++;
+				trts->changes++;
+			} else if (e->ee_origin == SO_EE_ORIGIN_ICMP) {
+				struct sockaddr_in *sin = (struct sockaddr_in *)(e + 1);
+
+				if (res < (ssize_t) sizeof(icmph) ||
+				    target.sin_addr.s_addr != trts->whereto.sin_addr.s_addr ||
+				    icmph.type != ICMP_ECHO ||
+				    !is_ours(trts, sock, icmph.un.echo.id)) {
+					/* Not our error, not an error at all. Clear. */
+					saved_errno = 0;
+					continue;
+				}
 
-	/*
-	 * add back carry outs from top 16 bits to low 16 bits
-	 */
-	sum = (sum >> 16) + (sum & 0xffff);	/* add hi 16 to low 16 */
-	sum += (sum >> 16);			/* add carry */
-	answer = ~sum;				/* truncate to 16 bits */
-	return (answer);
+				acknowledge(trts, ntohs(icmph.un.echo.sequence));
+
+				if (sock->socktype == SOCK_RAW) {
+					struct icmp_filter filt;
+
+					filt.data = ~((1 << ICMP_SOURCE_QUENCH) |
+						      (1 << ICMP_REDIRECT) |
+						      (1 << ICMP_ECHOREPLY));
+					if (setsockopt(sock->fd, SOL_RAW, ICMP_FILTER, (const void *)&filt,
+						       sizeof(filt)) == -1)
+						error(2, errno, "setsockopt(ICMP_FILTER)");
+				}
+				net_errors++;
+				trts->nerrors++;
+				trts->changes++;
+				ping_log_add(trts, PING_LOG_ERROR, ntohs(icmph.un.echo.sequence),
+					     timer_wheel_clock() * 1000000LL, -1, 0);
+				ping_shm_update(trts, -1);
+				if (trts->output)
+					ping_output_error(trts, ntohs(icmph.un.echo.sequence), sin,
+							  e->ee_type, e->ee_code);
+				if (trts->opt_quiet)
+					continue;
+				if (trts->opt_flood) {
+					write_stdout("\bE", 2);
+				} else {
+					print_timestamp(trts);
+					ping_printf(trts, _("From %s icmp_seq=%u "), pr_addr(trts, sin, sizeof *sin), ntohs(icmph.un.echo.sequence));
+					pr_icmph(trts, e->ee_type, e->ee_code, e->ee_info, NULL);
+					fflush(stdout);
+				}
+			}
+		}
+	} while (n == PING_ERR_BATCH);
+
+	errno = saved_errno;
+	return net_errors ? net_errors : -local_errors;
 }
 
 /*
@@ -1193,50 +1353,52 @@ in_cksum(const unsigned short *addr, int len, unsigned short csum)
  * 	Compose and transmit an ICMP ECHO REQUEST packet.  The IP packet
  * will be added on by the kernel.  The ID field is a random number,
  * and the sequence number is an ascending integer.  The first several bytes
- * of the data portion are used to hold a UNIX "timeval" struct in VAX
+ * of the data portion are used to hold a UNIX "timespec" struct in host
  * byte-order, to compute the round-trip time.
  */
-int ping4_send_probe(struct ping_rts *rts, socket_st *sock, void *packet,
-		     unsigned packet_size __attribute__((__unused__)))
+int ping4_build_probe(struct ping_rts *rts, socket_st *sock __attribute__((__unused__)),
+		      void *packet, long seq, struct msghdr *msg)
 {
 	struct icmphdr *icp;
 	int cc;
-	int i;
 
 	icp = (struct icmphdr *)packet;
 	icp->type = ICMP_ECHO;
 	icp->code = 0;
 	icp->checksum = 0;
-	icp->un.echo.sequence = htons(rts->ntransmitted + 1);
+	icp->un.echo.sequence = htons(seq);
 	icp->un.echo.id = rts->ident;			/* ID */
 
-	rcvd_clear(rts, rts->ntransmitted + 1);
+	rcvd_clear(rts, seq);
 
 	if (rts->timing) {
 		if (rts->opt_latency) {
-			struct timeval tmp_tv;
-			gettimeofday(&tmp_tv, NULL);
-			memcpy(icp + 1, &tmp_tv, sizeof(tmp_tv));
+			struct timespec now;
+			clock_gettime(CLOCK_MONOTONIC, &now);
+			memcpy(icp + 1, &now, sizeof(now));
 		} else {
-			memset(icp + 1, 0, sizeof(struct timeval));
+			memset(icp + 1, 0, sizeof(struct timespec));
 		}
 	}
 
 	cc = rts->datalen + 8;			/* skips ICMP portion */
 
-	/* compute ICMP checksum here */
-	icp->checksum = in_cksum((unsigned short *)icp, cc, 0);
+	/* compute ICMP checksum here: only the header and the timestamp
+	 * need summing, the rest of the payload is in payload_cksum */
+	icp->checksum = in_cksum((unsigned short *)icp, rts->timing ? 8 + sizeof(struct timespec) : 8,
+				 ~rts->payload_cksum);
 
 	if (rts->timing && !rts->opt_latency) {
-		struct timeval tmp_tv;
-		gettimeofday(&tmp_tv, NULL);
-		memcpy(icp + 1, &tmp_tv, sizeof(tmp_tv));
-		icp->checksum = in_cksum((unsigned short *)&tmp_tv, sizeof(tmp_tv), ~icp->checksum);
+		struct timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		memcpy(icp + 1, &now, sizeof(now));
+		icp->checksum = in_cksum((unsigned short *)&now, sizeof(now), ~icp->checksum);
 	}
 
-	i = sendto(sock->fd, icp, cc, 0, (struct sockaddr *)&rts->whereto, sizeof(rts->whereto));
+	msg->msg_name = &rts->whereto;
+	msg->msg_namelen = sizeof(rts->whereto);
 
-	return (cc == i ? 0 : i);
+	return cc;
 }
 
 /*
@@ -1247,16 +1409,16 @@ int ping4_send_probe(struct ping_rts *rts, socket_st *sock, void *packet,
  * program to be run without having intermingled output (or statistics!).
  */
 static
-void pr_echo_reply(uint8_t *_icp, int len __attribute__((__unused__)))
+void pr_echo_reply(struct ping_rts *rts, uint8_t *_icp, int len __attribute__((__unused__)))
 {
 	struct icmphdr *icp = (struct icmphdr *)_icp;
 
-	printw(_(" icmp_seq=%u"), ntohs(icp->un.echo.sequence));
+	ping_printf(rts, _(" icmp_seq=%u"), ntohs(icp->un.echo.sequence));
 }
 
 int ping4_parse_reply(struct ping_rts *rts, struct socket_st *sock,
 		      struct msghdr *msg, int cc, void *addr,
-		      struct timeval *tv)
+		      struct timespec *ts)
 {
 	struct sockaddr_in *from = addr;
 	uint8_t *buf = msg->msg_iov->iov_base;
@@ -1305,9 +1467,13 @@ int ping4_parse_reply(struct ping_rts *rts, struct socket_st *sock,
 	/* Now the ICMP part */
 	cc -= hlen;
 	icp = (struct icmphdr *)(buf + hlen);
-	csfailed = in_cksum((unsigned short *)icp, cc, 0);
+	/* Ping sockets only get what the kernel found a good checksum on. */
+	csfailed = sock->socktype == SOCK_DGRAM ? 0 : in_cksum((unsigned short *)icp, cc, 0);
 
 	if (icp->type == ICMP_ECHOREPLY) {
+		rts = ping_target_lookup(rts, AF_INET, &from->sin_addr);
+		if (!rts)
+			return 1;
 		if (!rts->broadcast_pings && !rts->multicast &&
 		    from->sin_addr.s_addr != rts->whereto.sin_addr.s_addr)
 			return 1;
@@ -1317,7 +1483,7 @@ int ping4_parse_reply(struct ping_rts *rts, struct socket_st *sock,
 			return 1;			/* 'Twas really not our ECHO */
 		if (gather_statistics(rts, (uint8_t *)icp, sizeof(*icp), cc,
 				      ntohs(icp->un.echo.sequence),
-				      reply_ttl, 0, tv, pr_addr(rts, from, sizeof *from),
+				      reply_ttl, 0, ts, pr_addr(rts, from, sizeof *from),
 				      pr_echo_reply, rts->multicast)) {
 			fflush(stdout);
 			return 0;
@@ -1343,6 +1509,7 @@ int ping4_parse_reply(struct ping_rts *rts, struct socket_st *sock,
 				    cc < 8 + iph->ihl * 4 + 8)
 					return 1;
 				if (icp1->type != ICMP_ECHO ||
+				    !(rts = ping_target_lookup(rts, AF_INET, &iph->daddr)) ||
 				    iph->daddr != rts->whereto.sin_addr.s_addr ||
 				    !is_ours(rts, sock, icp1->un.echo.id))
 					return 1;
@@ -1355,10 +1522,10 @@ int ping4_parse_reply(struct ping_rts *rts, struct socket_st *sock,
 				if (rts->opt_quiet || rts->opt_flood)
 					return 1;
 				print_timestamp(rts);
-				printw(_("From %s: icmp_seq=%u "), pr_addr(rts, from, sizeof *from),
+				ping_printf(rts, _("From %s: icmp_seq=%u "), pr_addr(rts, from, sizeof *from),
 				       ntohs(icp1->un.echo.sequence));
 				if (csfailed)
-					printw(_("(BAD CHECKSUM)"));
+					ping_printf(rts, _("(BAD CHECKSUM)"));
 				pr_icmph(rts, icp->type, icp->code, ntohl(icp->un.gateway), icp);
 				return 1;
 			}
@@ -1378,28 +1545,24 @@ int ping4_parse_reply(struct ping_rts *rts, struct socket_st *sock,
 		if (rts->opt_ptimeofday) {
 			struct timeval recv_time;
 			gettimeofday(&recv_time, NULL);
-			printw("%lu.%06lu ", (unsigned long)recv_time.tv_sec, (unsigned long)recv_time.tv_usec);
+			ping_printf(rts, "%lu.%06lu ", (unsigned long)recv_time.tv_sec, (unsigned long)recv_time.tv_usec);
 		}
-		printw(_("From %s: "), pr_addr(rts, from, sizeof *from));
+		ping_printf(rts, _("From %s: "), pr_addr(rts, from, sizeof *from));
 		if (csfailed) {
-			printf(_("(BAD CHECKSUM)\n"));
+			ping_printf(rts, _("(BAD CHECKSUM)\n"));
 			return 0;
 		}
 		pr_icmph(rts, icp->type, icp->code, ntohl(icp->un.gateway), icp);
 		return 0;
 	}
 
-	if (rts->opt_audible) {
-		//putchar('\a');
-		addch('\a');
-		if (rts->opt_flood)
-			fflush(stdout);
-	}
+	/* The screen rings it: curses is not the measurement thread's. */
+	if (rts->opt_audible)
+		rts->bells++;
 	if (!rts->opt_flood) {
 		pr_options(rts, opts, olen + sizeof(struct iphdr));
 
-		//putchar('\n');
-		printw("\n");
+		ping_printf(rts, "\n");
 		fflush(stdout);
 	}
 	return 0;
@@ -1408,35 +1571,25 @@ int ping4_parse_reply(struct ping_rts *rts, struct socket_st *sock,
 /*
  * pr_addr --
  *
- * Return an ascii host address optionally with a hostname.
+ * Return an ascii host address optionally with a hostname.  The name
+ * comes from the cache of ping_rdns.c; until it has been looked up, only
+ * the address is shown.
  */
 char *pr_addr(struct ping_rts *rts, void *sa, socklen_t salen)
 {
 	static char buffer[4096] = "";
-	static struct sockaddr_storage last_sa;
-	static socklen_t last_salen = 0;
 	char name[NI_MAXHOST] = "";
 	char address[NI_MAXHOST] = "";
 
-	memset(&last_sa, 0, sizeof(last_sa));
-	if (salen == last_salen && !memcmp(sa, &last_sa, salen))
-		return buffer;
-
-	memcpy(&last_sa, sa, (last_salen = salen));
-
-	rts->in_pr_addr = !setjmp(rts->pr_addr_jmp);
-
 	getnameinfo(sa, salen, address, sizeof address, NULL, 0, getnameinfo_flags | NI_NUMERICHOST);
 	if (!rts->exiting && !rts->opt_numeric)
-		getnameinfo(sa, salen, name, sizeof name, NULL, 0, getnameinfo_flags);
+		ping_rdns_lookup(sa, salen, name, sizeof name);
 
 	if (*name)
 		snprintf(buffer, sizeof buffer, "%s (%s)", name, address);
 	else
 		snprintf(buffer, sizeof buffer, "%s", address);
 
-	rts->in_pr_addr = 0;
-
 	return (buffer);
 }
 
@@ -2,6 +2,7 @@
 #define IPUTILS_PING_H
 
 /* Includes */
+#include <stdarg.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -9,6 +10,7 @@
 #include <time.h>
 #include <signal.h>
 #include <poll.h>
+#include <pthread.h>
 #include <sys/param.h>
 #include <sys/socket.h>
 #include <linux/types.h>
@@ -22,7 +24,6 @@
 #include <errno.h>
 #include <string.h>
 #include <netdb.h>
-#include <setjmp.h>
 #include <netinet/icmp6.h>
 #include <asm/byteorder.h>
 #include <sched.h>
@@ -45,6 +46,10 @@
 
 #include "iputils_common.h"
 #include "iputils_ni.h"
+#include "event_loop.h"
+#include "timer_wheel.h"
+#include "ping_log.h"
+#include "ping_shm.h"
 
 #ifdef USE_IDN
 # define getaddrinfo_flags (AI_CANONNAME | AI_IDN | AI_CANONIDN)
@@ -59,6 +64,7 @@
 #include <arpa/inet.h>
 #include <linux/types.h>
 #include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
 #include <linux/in6.h>
 /* All includes done. */
 
@@ -108,22 +114,57 @@ struct rcvd_table {
 typedef struct socket_st {
 	int fd;
 	int socktype;
+	int ident;			/* echo id shared by all targets on a raw socket */
+	int ntargets;			/* number of targets probed through this socket */
+	int bound;
+	struct ping_uring *uring;	/* io_uring carrying the I/O, see ping_uring.c */
+	struct ping_tx_slot *tx_slots;	/* -k: probes by timestamp key */
+	uint32_t tx_key;		/* key the kernel gives the next probe */
 } socket_st;
 
 struct ping_rts;
 
-int ping4_send_probe(struct ping_rts *rts, socket_st *, void *packet, unsigned packet_size);
+/*
+ * With -k the kernel numbers every datagram sent on a socket
+ * (SOF_TIMESTAMPING_OPT_ID) and hands back its transmit timestamps under
+ * that number.  The slots remember which probe got which key.
+ */
+#define PING_TX_SLOTS	4096
+
+struct ping_tx_slot {
+	struct ping_rts *rts;
+	long seq;
+	uint32_t key;
+};
+struct ping_uring;
+
+int ping4_build_probe(struct ping_rts *rts, socket_st *, void *packet, long seq, struct msghdr *msg);
 int ping4_receive_error_msg(struct ping_rts *, socket_st *);
-int ping4_parse_reply(struct ping_rts *, socket_st *, struct msghdr *msg, int cc, void *addr, struct timeval *);
+int ping4_parse_reply(struct ping_rts *, socket_st *, struct msghdr *msg, int cc, void *addr, struct timespec *);
 void ping4_install_filter(struct ping_rts *rts, socket_st *);
 
 typedef struct ping_func_set_st {
-	int (*send_probe)(struct ping_rts *rts, socket_st *, void *packet, unsigned packet_size);
+	int (*build_probe)(struct ping_rts *rts, socket_st *, void *packet, long seq, struct msghdr *msg);
 	int (*receive_error_msg)(struct ping_rts *rts, socket_st *sock);
-	int (*parse_reply)(struct ping_rts *rts, socket_st *, struct msghdr *msg, int len, void *addr, struct timeval *);
+	int (*parse_reply)(struct ping_rts *rts, socket_st *, struct msghdr *msg, int len, void *addr, struct timespec *);
 	void (*install_filter)(struct ping_rts *rts, socket_st *);
 } ping_func_set_st;
 
+extern ping_func_set_st ping4_func_set;
+extern ping_func_set_st ping6_func_set;
+
+/*
+ * Every destination has its own ping_rts.  The table below maps the address
+ * a reply or ICMP error refers to back to the target it belongs to, so that
+ * all targets of one address family can share a single socket.
+ */
+struct ping_targets {
+	struct ping_rts **list;
+	int count;
+	struct ping_rts **hash;
+	unsigned int hash_mask;
+};
+
 /* Node Information query */
 struct ping_ni {
 	int query;
@@ -142,15 +183,160 @@ struct ping_ni {
 #endif
 };
 
+/* Text reported for a target, see ping_text.c */
+#define PING_TEXT_LINES	8
+#define PING_TEXT_COLS	256
+
+struct ping_text {
+	char chars[PING_TEXT_LINES][PING_TEXT_COLS];
+	unsigned char colors[PING_TEXT_LINES][PING_TEXT_COLS];
+	unsigned int len[PING_TEXT_LINES];
+	unsigned int head;		/* line being written */
+	unsigned int unread;		/* lines completed since the last redraw */
+	int color;
+};
+
+/* Running round trip time statistics, see ping_stats.c */
+#define PING_EWMA_SHIFT	3		/* the classic rtt/8 */
+#define PING_EWMA_SHIFT_MAX	20		/* nsec << 20 still fits for any rtt */
+
+struct ping_stats {
+	unsigned long long count;
+	long long min, max;		/* nsec */
+	double mean;			/* Welford running mean, nsec */
+	double m2;			/* sum of squared deviations from it */
+	long long ewma;			/* nsec << ewma_shift */
+	int ewma_shift;
+};
+
+static inline long long ping_stats_mean(const struct ping_stats *stats)
+{
+	return llround(stats->mean);
+}
+
+static inline long long ping_stats_ewma(const struct ping_stats *stats)
+{
+	return stats->ewma >> stats->ewma_shift;
+}
+
+/* Round trip times of a target, see ping_hist.c */
+#define PING_HIST_SUB_BITS	7	/* 128 buckets per octave, < 0.8% error */
+#define PING_HIST_MAX_BITS	37	/* up to 137 s */
+#define PING_HIST_BUCKETS	((PING_HIST_MAX_BITS - PING_HIST_SUB_BITS + 1) << PING_HIST_SUB_BITS)
+
+struct ping_hist {
+	unsigned long long count;
+	unsigned long long buckets[PING_HIST_BUCKETS];
+};
+
+/* Jitter, IPDV and reordering, see ping_jitter.c */
+struct ping_jitter {
+	unsigned long long nseq;	/* replies seen */
+	uint16_t highest;		/* highest sequence number seen */
+	unsigned long long reordered;
+	int reorder_max;		/* largest extent, in sequence numbers */
+	int timed;			/* transit is valid */
+	long long transit;		/* round trip time of the last reply */
+	long long jitter;		/* RFC 3550 J, nsec << 4 */
+	long long ipdv_min, ipdv_max;	/* nsec, signed */
+	long long ipdv_sum;		/* of |IPDV|, nsec */
+	struct ping_hist *ipdv;		/* |IPDV| */
+};
+
+static inline long long ping_jitter_value(const struct ping_jitter *jitter)
+{
+	return jitter->jitter >> 4;
+}
+
+/* Runs of lost probes, see ping_loss.c */
+#define PING_LOSS_BUCKETS	17	/* runs of 2^b .. 2^(b+1) - 1 probes */
+
+struct ping_loss {
+	long classified;		/* probes 1 .. classified are done */
+	int lost;			/* the last of them was lost */
+	unsigned long long received, nlost;
+	long run;			/* lost probes in a row up to it */
+	uint64_t run_start;		/* wheel msec the run's first was sent */
+	unsigned long long runs[PING_LOSS_BUCKETS];	/* ended runs */
+	long longest;
+	uint64_t longest_start, longest_end;	/* wheel msec, first and last sent */
+	/* two state Gilbert model: good = received, bad = lost */
+	unsigned long long from_good, good_bad;
+	unsigned long long from_bad, bad_good;
+};
+
+/* Looking the target up again, see ping_resolve.c */
+#define PING_RESOLVE_ADDRS	8
+
+struct ping_resolve {
+	int state;
+	struct ping_rts *next;		/* resolver queue */
+	int error;			/* of getaddrinfo() */
+	int family;			/* of addrs: the other one if the target's is gone */
+	int naddrs;
+	struct sockaddr_storage addrs[PING_RESOLVE_ADDRS];
+	long ttl;			/* msec, 0 if unknown */
+	int problem;			/* the last failure was reported */
+};
+
+/* Statistics over the last 10s, 1m and 5m, see ping_window.c */
+#define PING_WINDOWS		3
+#define PING_WIN_SLOTS		30
+#define PING_WIN_SUB_BITS	3	/* 8 buckets per octave for the p99 */
+#define PING_WIN_BUCKETS	((PING_HIST_MAX_BITS - PING_WIN_SUB_BITS + 1) << PING_WIN_SUB_BITS)
+
+struct ping_win_slot {
+	long long start;		/* first monotonic second covered */
+	unsigned int received;
+	unsigned int lost;
+	unsigned int timed;		/* replies with a round trip time */
+	double sum;
+	long long min, max;
+	unsigned int buckets[PING_WIN_BUCKETS];
+};
+
+struct ping_window {
+	int span;			/* seconds per slot */
+	int nslots;
+	const char *name;
+	int started;
+	int head;			/* slot of the current second */
+	struct ping_win_slot total;	/* sum of all slots, min/max unused */
+	struct ping_win_slot slots[PING_WIN_SLOTS];
+};
+
+struct ping_windows {
+	struct ping_window w[PING_WINDOWS];
+};
+
+struct ping_window_stats {
+	const char *name;
+	unsigned int received;
+	unsigned int lost;
+	double loss;
+	int timed;			/* min..p99 are valid */
+	long long min, avg, max, p99;
+};
+
 /*ping runtime state */
 struct ping_rts {
 	int mark;
 	unsigned char *outpack;
+	unsigned char *sendpack;	/* PING_SEND_BATCH - 1 more probe buffers */
 
 	struct rcvd_table rcvd_tbl;
 
 	size_t datalen;
+	char *target;			/* destination as given on the command line */
 	char *hostname;
+	bool ipv4;
+	ping_func_set_st *fset;
+	socket_st *sock;
+	struct ping_targets *targets;
+	int id;				/* position in targets->list */
+	struct ping_text *text;
+	struct ping_hist *hist;
+	struct ping_windows *windows;
 	uid_t uid;
 	int ident;			/* random id to identify our packets */
 
@@ -163,11 +349,22 @@ struct ping_rts {
 	long ntransmitted;		/* sequence # for outbound packets = #sent */
 	long nchecksum;			/* replies with bad checksum */
 	long nerrors;			/* icmp errors */
+	unsigned long changes;		/* bumped by anything the screen shows */
+	unsigned long bells;		/* -a: replies the screen is to beep for */
 	int interval;			/* interval between packets (msec) */
 	int preload;
+	int oom_count;
 	int deadline;			/* time to die */
 	int lingertime;
-	struct timeval start_time, cur_time;
+	struct timespec start_time, cur_time;	/* CLOCK_MONOTONIC */
+	int64_t send_at;		/* wheel time the next probe is due */
+	struct timer_wheel *wheel;
+	struct timer_entry send_timer;
+	struct timer_entry resolve_timer;
+	struct ping_resolve resolve;
+	struct ping_timeout *timeouts;	/* reply timeouts, by seq & timeout_mask */
+	unsigned int timeout_mask;
+	long npending;			/* probes neither answered nor timed out */
 	volatile int exiting;
 	volatile int status_snapshot;
 	int confirm;
@@ -175,19 +372,20 @@ struct ping_rts {
 	char *device;
 	int pmtudisc;
 
-	volatile int in_pr_addr;	/* pr_addr() is executing */
-	jmp_buf pr_addr_jmp;
-
 	/* timing */
 	int timing;			/* flag to do timing */
-	long tmin;			/* minimum round trip time */
-	long tmax;			/* maximum round trip time */
-	double tsum;			/* sum of all times, for doing average */
-	double tsum2;
-	int rtt;
-	int rtt_addend;
+	struct ping_stats stats;	/* round trip times, nsec */
+	struct ping_jitter jitter;
+	struct ping_loss loss;
+	long long rtt_addend;
+	double sdelay_sum;		/* -k: user space to kernel send delay */
+	long long sdelay_max;
+	long nsdelay;
 	uint16_t acked;
 	int pipesize;
+	int payload_checked;		/* the reply being handled matched outpack */
+	unsigned short payload_cksum;	/* ICMP checksum of the payload past the timestamp */
+	int output;			/* -o: PING_OUTPUT_*, 0 for the screen */
 
 	ping_func_set_st ping4_func_set;
 	ping_func_set_st ping6_func_set;
@@ -217,7 +415,7 @@ struct ping_rts {
 
 	/* Used only in ping6_common.c */
 	struct sockaddr_in6 firsthop;
-	unsigned char cmsgbuf[4096];
+	unsigned char cmsgbuf[CMSG_SPACE(sizeof(struct in6_pktinfo))];
 	size_t cmsglen;
 	struct ping_ni ni;
 
@@ -226,11 +424,12 @@ struct ping_rts {
 		opt_adaptive:1,
 		opt_audible:1,
 		opt_flood:1,
-		opt_flood_poll:1,
 		opt_flowinfo:1,
 		opt_interval:1,
+		opt_io_uring:1,
 		opt_latency:1,
 		opt_mark:1,
+		opt_nsec:1,
 		opt_noloop:1,
 		opt_numeric:1,
 		opt_outstanding:1,
@@ -245,25 +444,68 @@ struct ping_rts {
 		opt_tclass:1,
 		opt_timestamp:1,
 		opt_ttl:1,
+		opt_txstamp:1,
 		opt_verbose:1;
 };
 /* FIXME: global_rts will be removed in future */
 extern struct ping_rts *global_rts;
 
+/*
+ * Replies are drained with recvmmsg() into PING_RECV_BATCH slots of
+ * setup_data->packet; the headers, addresses and control areas below are
+ * set up once and reused for every batch.
+ */
+#define PING_RECV_BATCH	32
+#define PING_CMSG_SPACE	512
+
+/* Probes submitted per sendmmsg() when a burst is due */
+#define PING_SEND_BATCH	32
+
+/* Error queue entries read per recvmmsg() in *_receive_error_msg() */
+#define PING_ERR_BATCH	8
+
+struct ping_recv_batch {
+	struct mmsghdr msgs[PING_RECV_BATCH];
+	struct iovec iov[PING_RECV_BATCH];
+	struct sockaddr_storage addrs[PING_RECV_BATCH];
+	char control[PING_RECV_BATCH][PING_CMSG_SPACE];
+};
+
+/* Waits -W for the reply to probe "seq" before counting it as lost. */
+struct ping_timeout {
+	struct timer_entry timer;
+	long seq;
+	struct timespec tx_time;	/* -k: when the kernel sent it */
+};
+
 typedef struct ping_setup_data {
-	bool ipv4;
-	struct ping_rts *rts;
-	ping_func_set_st *fset;
+	struct ping_targets targets;
 	socket_st *sock4;
 	socket_st *sock6;
-	uint8_t *packet;
+	uint8_t *packet;		/* PING_RECV_BATCH buffers of packlen */
 	int packlen;
-	struct addrinfo *result;
+	struct ping_recv_batch *recv;
+	struct ping_uring *uring;	/* NULL: plain socket syscalls */
+
+	/* event loop sources */
+	int epfd;
+	event_source sock4_event;
+	event_source sock6_event;
+	event_source wheel_timer;
+	uint64_t wheel_armed;		/* what wheel_timer is set to */
+
+	struct timer_wheel wheel;	/* send, reply and -w timers */
+	struct timer_entry deadline_timer;
+
+	pthread_mutex_t lock;		/* held by ping_io.c handling events */
 } ping_setup_data;
 
 void parse_ping_args(int argc, char **argv, struct addrinfo *hints, struct ping_rts *rts, char **outpack_fill, char **target);
-int ping_initialize(ping_setup_data* setup_data, struct addrinfo *hints, struct ping_rts *rts, char *target);
+int ping_initialize(ping_setup_data* setup_data, struct addrinfo *hints, struct ping_rts *rts,
+	char **targets, int ntargets);
 void print_ping_header(bool ipv4, struct ping_rts *rts);
+int ping_target_move(ping_setup_data *setup_data, struct ping_rts *rts,
+	const struct sockaddr_storage *addr);
 void cleanup(ping_setup_data *setup_data);
 int ping4_run(struct ping_rts *rts, struct addrinfo *ai, socket_st *sock, 
 	ping_setup_data *setup_data, char *target);
@@ -306,17 +548,27 @@ static inline void write_stdout(const char *str, size_t len)
 }
 
 /*
- * tvsub --
- *	Subtract 2 timeval structs:  out = out - in.  Out is assumed to
- * be >= in.
+ * tsdiff --
+ *	Nanoseconds from timespec "in" to timespec "out".
  */
-static inline void tvsub(struct timeval *out, struct timeval *in)
+static inline long long tsdiff(const struct timespec *out, const struct timespec *in)
 {
-	if ((out->tv_usec -= in->tv_usec) < 0) {
-		--out->tv_sec;
-		out->tv_usec += 1000000;
+	return (out->tv_sec - in->tv_sec) * 1000000000LL + (out->tv_nsec - in->tv_nsec);
+}
+
+/*
+ * ts_add --
+ *	Add "ns" nanoseconds, which may be negative, to timespec "ts".
+ */
+static inline void ts_add(struct timespec *ts, long long ns)
+{
+	ns += ts->tv_nsec;
+	ts->tv_sec += ns / 1000000000;
+	ts->tv_nsec = ns % 1000000000;
+	if (ts->tv_nsec < 0) {
+		ts->tv_sec--;
+		ts->tv_nsec += 1000000000;
 	}
-	out->tv_sec -= in->tv_sec;
 }
 
 static inline void set_signal(int signo, void (*handler)(int))
@@ -329,11 +581,18 @@ static inline void set_signal(int signo, void (*handler)(int))
 	sigaction(signo, &sa, NULL);
 }
 
-extern int __schedule_exit(int next);
-
-static inline int schedule_exit(struct ping_rts *rts, int next)
+/*
+ * packet_loss --
+ *	Percentage of the settled probes, those answered or timed out, that
+ * got no reply.  Probes still within -W are not counted as lost yet.
+ */
+static inline double packet_loss(struct ping_rts *rts)
 {
-	return next;
+	long settled = rts->ntransmitted - rts->npending;
+
+	if (settled <= 0 || rts->nreceived >= settled)
+		return 0;
+	return (settled - rts->nreceived) * 100.0 / settled;
 }
 
 static inline int in_flight(struct ping_rts *rts)
@@ -389,27 +648,116 @@ extern int pinger(struct ping_rts *rts, ping_func_set_st *fset, socket_st *sock)
 extern void sock_setbufs(struct ping_rts *rts, socket_st *, int alloc);
 extern void setup(struct ping_rts *rts, socket_st *);
 extern int contains_pattern_in_payload(struct ping_rts *rts, uint8_t *ptr);
-extern int main_ping(struct ping_rts *rts, ping_func_set_st *fset, socket_st*,
-		     uint8_t *packet, int packlen);
+extern void ping_recv_batch_init(ping_setup_data *setup_data);
+void ping_receive(ping_setup_data *setup_data, socket_st *sock, int recv_error);
+extern void ping_register_events(ping_setup_data *setup_data, int epfd);
+extern void ping_socket_register(ping_setup_data *setup_data, socket_st *sock);
+extern int ping_thread_start(void *(*fn)(void *), void *arg);
+extern void ping_reschedule(ping_setup_data *setup_data);
+extern long long ping_clock_skew(void);
+extern int ping_recv_timestamp(struct msghdr *msg, long long skew, struct timespec *ts);
+extern int ping_tx_timestamp(socket_st *sock, struct msghdr *msg, struct sock_extended_err *e);
+
+/* ping_uring.c */
+extern int ping_uring_init(ping_setup_data *setup_data);
+extern void ping_uring_register(ping_setup_data *setup_data, int epfd);
+extern int ping_uring_send(struct ping_rts *rts, ping_func_set_st *fset, socket_st *sock, int count);
+extern void ping_uring_submit(struct ping_uring *uring);
+extern void ping_uring_cleanup(ping_setup_data *setup_data);
+extern int ping_exit_status(ping_setup_data *setup_data);
 extern int finish(struct ping_rts *rts);
 extern void status(struct ping_rts *rts);
+extern void summary(struct ping_rts *rts, int name_width);
+extern void ping_targets_add(struct ping_targets *targets, struct ping_rts *rts);
+extern void ping_targets_rehash(struct ping_targets *targets);
+extern struct ping_rts *ping_target_lookup(struct ping_rts *rts, int family, const void *addr);
 extern void common_options(int ch);
 extern int gather_statistics(struct ping_rts *rts, uint8_t *icmph, int icmplen,
 			     int cc, uint16_t seq, int hops,
-			     int csfailed, struct timeval *tv, char *from,
-			     void (*pr_reply)(uint8_t *ptr, int cc), int multicast);
+			     int csfailed, struct timespec *ts, char *from,
+			     void (*pr_reply)(struct ping_rts *rts, uint8_t *ptr, int cc), int multicast);
 extern void print_timestamp(struct ping_rts *rts);
+void ping_printf(struct ping_rts *rts, const char *fmt, ...) iputils_attribute_format(printf, 2, 3);
+void ping_vprintf(struct ping_rts *rts, const char *fmt, va_list ap);
+void ping_set_color(struct ping_rts *rts, int index);
+void ping_text_render(struct ping_rts *rts);
 void fill(struct ping_rts *rts, char *patp, unsigned char *packet, size_t packet_size);
 
+/* ping_shm.c */
+void ping_shm_config(const char *name);
+void ping_shm_start(ping_setup_data *setup_data);
+void ping_shm_update(struct ping_rts *rts, long long rtt);
+void ping_shm_close(void);
+
+/* ping_stats.c */
+void ping_stats_init(struct ping_stats *stats, int ewma_shift);
+void ping_stats_add(struct ping_stats *stats, long long ns);
+long long ping_stats_mdev(const struct ping_stats *stats);
+
+/* ping_cksum.c */
+unsigned short in_cksum(const unsigned short *addr, int len, unsigned short csum);
+
+/* ping_hist.c */
+struct ping_hist *ping_hist_alloc(void);
+void ping_hist_record(struct ping_hist *hist, long long ns);
+long long ping_hist_percentile(const struct ping_hist *hist, double percent);
+unsigned int ping_hist_bucket(long long ns, int sub_bits);
+long long ping_hist_value(unsigned int index, int sub_bits);
+
+/* ping_io.c */
+void ping_io_start(ping_setup_data *setup_data);
+
+/* ping_log.c */
+void ping_log_config(const char *path, uint64_t max_bytes, long max_sec);
+void ping_log_start(ping_setup_data *setup_data, uint64_t now);
+void ping_log_add(struct ping_rts *rts, int status, long seq, long long mono,
+		  long long rtt, int ttl);
+void ping_log_close(void);
+
+/* ping_metrics.c */
+void ping_metrics_config(const char *arg);
+void ping_metrics_start(void);
+void ping_metrics_register(ping_setup_data *setup_data, int epfd);
+
+/* ping_output.c */
+#define PING_OUTPUT_JSON	1
+#define PING_OUTPUT_CSV		2
+int ping_output_run(ping_setup_data *setup_data, double interval);
+void ping_output_reply(struct ping_rts *rts, long seq, int cc, int ttl, long long rtt,
+		       const char *from, int dup);
+void ping_output_timeout(struct ping_rts *rts, long seq);
+void ping_output_error(struct ping_rts *rts, long seq, const void *sa, int type, int code);
+
+/* ping_jitter.c */
+void ping_jitter_reply(struct ping_jitter *jitter, uint16_t seq, long long ns);
+
+/* ping_loss.c */
+void ping_loss_timeout(struct ping_rts *rts, long seq, uint64_t sent);
+void ping_loss_reply(struct ping_rts *rts);
+unsigned int ping_loss_bucket(long run);
+
+/* ping_rdns.c */
+int ping_rdns_lookup(const void *sa, socklen_t salen, char *name, size_t len);
+
+/* ping_resolve.c */
+void ping_resolve_init(ping_setup_data *setup_data, struct ping_rts *rts, uint64_t now);
+
+/* ping_window.c */
+struct ping_windows *ping_windows_alloc(void);
+void ping_windows_reply(struct ping_windows *windows, long long now, long long ns);
+void ping_windows_loss(struct ping_windows *windows, long long now);
+int ping_window_stats(struct ping_windows *windows, int index, long long now,
+		      struct ping_window_stats *stats);
+
 /* IPv6 */
 
 int ping6_run(struct ping_rts *rts, struct addrinfo *ai, socket_st *sock, 
 	ping_setup_data *setup_data, char *target);
 void ping6_usage(unsigned from_ping);
 
-int ping6_send_probe(struct ping_rts *rts, socket_st *sockets, void *packet, unsigned packet_size);
+int ping6_build_probe(struct ping_rts *rts, socket_st *sockets, void *packet, long seq, struct msghdr *msg);
 int ping6_receive_error_msg(struct ping_rts *rts, socket_st *sockets);
-int ping6_parse_reply(struct ping_rts *rts, socket_st *, struct msghdr *msg, int cc, void *addr, struct timeval *);
+int ping6_parse_reply(struct ping_rts *rts, socket_st *, struct msghdr *msg, int cc, void *addr, struct timespec *);
 void ping6_install_filter(struct ping_rts *rts, socket_st *sockets);
 int ntohsp(uint16_t *p);
 
@@ -72,7 +72,7 @@
 #endif
 
 ping_func_set_st ping6_func_set = {
-	.send_probe = ping6_send_probe,
+	.build_probe = ping6_build_probe,
 	.receive_error_msg = ping6_receive_error_msg,
 	.parse_reply = ping6_parse_reply,
 	.install_filter = ping6_install_filter
@@ -101,7 +101,6 @@ unsigned int if_name2index(const char *ifname)
 int ping6_run(struct ping_rts *rts, struct addrinfo *ai, struct socket_st *sock, 
 		ping_setup_data *setup_data, char *target) {
 	int hold, packlen;
-	unsigned char *packet;
 	struct icmp6_filter filter;
 	int err;
 	static uint32_t scope_id = 0;
@@ -242,17 +241,19 @@ int ping6_run(struct ping_rts *rts, struct addrinfo *ai, struct socket_st *sock,
 			error(2, errno, "IPV6_MTU_DISCOVER");
 	}
 
-	if (rts->opt_strictsource &&
-	    bind(sock->fd, (struct sockaddr *)&rts->source6, sizeof rts->source6) == -1)
-		error(2, errno, "bind icmp socket");
+	if (rts->opt_strictsource && !sock->bound) {
+		if (bind(sock->fd, (struct sockaddr *)&rts->source6, sizeof rts->source6) == -1)
+			error(2, errno, "bind icmp socket");
+		sock->bound = 1;
+	}
 
-	if ((ssize_t)rts->datalen >= (ssize_t)sizeof(struct timeval) && (rts->ni.query < 0)) {
+	if ((ssize_t)rts->datalen >= (ssize_t)sizeof(struct timespec) && (rts->ni.query < 0)) {
 		/* can we time transfer */
 		rts->timing = 1;
 	}
 	packlen = rts->datalen + 8 + 4096 + 40 + 8; /* 4096 for rthdr */
-	if (!(packet = (unsigned char *)malloc((unsigned int)packlen)))
-		error(2, errno, _("memory allocation failed"));
+	if (packlen > setup_data->packlen)
+		setup_data->packlen = packlen;
 
 	hold = 1;
 	if (setsockopt(sock->fd, IPPROTO_IPV6, IPV6_RECVERR, (const void *)&hold, sizeof hold))
@@ -352,168 +353,191 @@ int ping6_run(struct ping_rts *rts, struct addrinfo *ai, struct socket_st *sock,
 
 	setup(rts, sock);
 
-	drop_capabilities();
-	//hold = main_ping(rts, &ping6_func_set, sock, packet, packlen);
-
-	setup_data->rts = rts;
-	setup_data->fset = &ping6_func_set;
-	setup_data->packet = packet;
-	setup_data->packlen = packlen;
-
 	return 0;
 }
 
-int print_icmp(uint8_t type, uint8_t code, uint32_t info)
+int print_icmp(struct ping_rts *rts, uint8_t type, uint8_t code, uint32_t info)
 {
 	switch (type) {
 	case ICMP6_DST_UNREACH:
-		printf(_("Destination unreachable: "));
+		ping_printf(rts, _("Destination unreachable: "));
 		switch (code) {
 		case ICMP6_DST_UNREACH_NOROUTE:
-			printf(_("No route"));
+			ping_printf(rts, _("No route"));
 			break;
 		case ICMP6_DST_UNREACH_ADMIN:
-			printf(_("Administratively prohibited"));
+			ping_printf(rts, _("Administratively prohibited"));
 			break;
 		case ICMP6_DST_UNREACH_BEYONDSCOPE:
-			printf(_("Beyond scope of source address"));
+			ping_printf(rts, _("Beyond scope of source address"));
 			break;
 		case ICMP6_DST_UNREACH_ADDR:
-			printf(_("Address unreachable"));
+			ping_printf(rts, _("Address unreachable"));
 			break;
 		case ICMP6_DST_UNREACH_NOPORT:
-			printf(_("Port unreachable"));
+			ping_printf(rts, _("Port unreachable"));
 			break;
 		default:
-			printf(_("Unknown code %d"), code);
+			ping_printf(rts, _("Unknown code %d"), code);
 			break;
 		}
 		break;
 	case ICMP6_PACKET_TOO_BIG:
-		printf(_("Packet too big: mtu=%u"), info);
+		ping_printf(rts, _("Packet too big: mtu=%u"), info);
 		if (code)
-			printf(_(", code=%d"), code);
+			ping_printf(rts, _(", code=%d"), code);
 		break;
 	case ICMP6_TIME_EXCEEDED:
-		printf(_("Time exceeded: "));
+		ping_printf(rts, _("Time exceeded: "));
 		if (code == ICMP6_TIME_EXCEED_TRANSIT)
-			printf(_("Hop limit"));
+			ping_printf(rts, _("Hop limit"));
 		else if (code == ICMP6_TIME_EXCEED_REASSEMBLY)
-			printf(_("Defragmentation failure"));
+			ping_printf(rts, _("Defragmentation failure"));
 		else
-			printf(_("code %d"), code);
+			ping_printf(rts, _("code %d"), code);
 		break;
 	case ICMP6_PARAM_PROB:
-		printf(_("Parameter problem: "));
+		ping_printf(rts, _("Parameter problem: "));
 		if (code == ICMP6_PARAMPROB_HEADER)
-			printf(_("Wrong header field "));
+			ping_printf(rts, _("Wrong header field "));
 		else if (code == ICMP6_PARAMPROB_NEXTHEADER)
-			printf(_("Unknown header "));
+			ping_printf(rts, _("Unknown header "));
 		else if (code == ICMP6_PARAMPROB_OPTION)
-			printf(_("Unknown option "));
+			ping_printf(rts, _("Unknown option "));
 		else
-			printf(_("code %d "), code);
-		printf(_("at %u"), info);
+			ping_printf(rts, _("code %d "), code);
+		ping_printf(rts, _("at %u"), info);
 		break;
 	case ICMP6_ECHO_REQUEST:
-		printf(_("Echo request"));
+		ping_printf(rts, _("Echo request"));
 		break;
 	case ICMP6_ECHO_REPLY:
-		printf(_("Echo reply"));
+		ping_printf(rts, _("Echo reply"));
 		break;
 	case MLD_LISTENER_QUERY:
-		printf(_("MLD Query"));
+		ping_printf(rts, _("MLD Query"));
 		break;
 	case MLD_LISTENER_REPORT:
-		printf(_("MLD Report"));
+		ping_printf(rts, _("MLD Report"));
 		break;
 	case MLD_LISTENER_REDUCTION:
-		printf(_("MLD Reduction"));
+		ping_printf(rts, _("MLD Reduction"));
 		break;
 	default:
-		printf(_("unknown icmp type: %u"), type);
+		ping_printf(rts, _("unknown icmp type: %u"), type);
 
 	}
 	return 0;
 }
 
+/* See ping4_receive_error_msg(). */
 int ping6_receive_error_msg(struct ping_rts *rts, socket_st *sock)
 {
-	ssize_t res;
-	char cbuf[512];
-	struct iovec iov;
-	struct msghdr msg;
-	struct cmsghdr *cmsg;
-	struct sock_extended_err *e;
-	struct icmp6_hdr icmph;
-	struct sockaddr_in6 target;
+	struct mmsghdr msgs[PING_ERR_BATCH];
+	struct iovec iov[PING_ERR_BATCH];
+	char cbuf[PING_ERR_BATCH][512];
+	struct icmp6_hdr icmphs[PING_ERR_BATCH];
+	struct sockaddr_in6 targets[PING_ERR_BATCH];
 	int net_errors = 0;
 	int local_errors = 0;
 	int saved_errno = errno;
-
-	iov.iov_base = &icmph;
-	iov.iov_len = sizeof(icmph);
-	msg.msg_name = (void *)&target;
-	msg.msg_namelen = sizeof(target);
-	msg.msg_iov = &iov;
-	msg.msg_iovlen = 1;
-	msg.msg_flags = 0;
-	msg.msg_control = cbuf;
-	msg.msg_controllen = sizeof(cbuf);
-
-	res = recvmsg(sock->fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT);
-	if (res < 0)
-		goto out;
-
-	e = NULL;
-	for (cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
-		if (cmsg->cmsg_level == IPPROTO_IPV6) {
-			if (cmsg->cmsg_type == IPV6_RECVERR)
-				e = (struct sock_extended_err *)CMSG_DATA(cmsg);
-		}
-	}
-	if (e == NULL)
-		abort();
-
-	if (e->ee_origin == SO_EE_ORIGIN_LOCAL) {
-		local_errors++;
-		if (rts->opt_quiet)
-			goto out;
-		if (rts->opt_flood)
-			write_stdout("E", 1);
-		else if (e->ee_errno != EMSGSIZE)
-			error(0, e->ee_errno, _("local error"));
-		else
-			error(0, 0, _("local error: message too long, mtu: %u"), e->ee_info);
-		rts->nerrors++;
-	} else if (e->ee_origin == SO_EE_ORIGIN_ICMP6) {
-		struct sockaddr_in6 *sin6 = (struct sockaddr_in6 *)(e + 1);
-
-		if ((size_t)res < sizeof(icmph) ||
-		    memcmp(&target.sin6_addr, &rts->whereto6.sin6_addr, 16) ||
-		    icmph.icmp6_type != ICMP6_ECHO_REQUEST ||
-		    !is_ours(rts, sock, icmph.icmp6_id)) {
-			/* Not our error, not an error at all. Clear. */
-			saved_errno = 0;
-			goto out;
+	int n, i;
+
+	/* Drain the queue, it fills quickly with timestamps. */
+	do {
+		memset(msgs, 0, sizeof(msgs));
+		for (i = 0; i < PING_ERR_BATCH; i++) {
+			iov[i].iov_base = &icmphs[i];
+			iov[i].iov_len = sizeof(icmphs[i]);
+			msgs[i].msg_hdr.msg_name = (void *)&targets[i];
+			msgs[i].msg_hdr.msg_namelen = sizeof(targets[i]);
+			msgs[i].msg_hdr.msg_iov = &iov[i];
+			msgs[i].msg_hdr.msg_iovlen = 1;
+			msgs[i].msg_hdr.msg_control = cbuf[i];
+			msgs[i].msg_hdr.msg_controllen = sizeof(cbuf[i]);
 		}
 
-		net_errors++;
-		rts->nerrors++;
-		if (rts->opt_quiet)
-			goto out;
-		if (rts->opt_flood) {
-			write_stdout("\bE", 2);
-		} else {
-			print_timestamp(rts);
-			printw(_("From %s icmp_seq=%u "), pr_addr(rts, sin6, sizeof *sin6), ntohs(icmph.icmp6_seq));
-			print_icmp(e->ee_type, e->ee_code, e->ee_info);
-			printw("\n");
-			fflush(stdout);
+		n = recvmmsg(sock->fd, msgs, PING_ERR_BATCH, MSG_ERRQUEUE | MSG_DONTWAIT, NULL);
+
+		for (i = 0; i < n; i++) {
+			struct msghdr *msg = &msgs[i].msg_hdr;
+			size_t res = msgs[i].msg_len;
+			struct icmp6_hdr icmph = icmphs[i];
+			struct sockaddr_in6 target = targets[i];
+			struct ping_rts *trts = rts;
+			struct cmsghdr *cmsg;
+			struct sock_extended_err *e;
+
+			/* The error may belong to any target sharing this socket. */
+			if (msg->msg_namelen >= sizeof(target)) {
+				struct ping_rts *owner = ping_target_lookup(rts, AF_INET6, &target.sin6_addr);
+
+				if (owner)
+					trts = owner;
+			}
+
+			e = NULL;
+			for (cmsg = CMSG_FIRSTHDR(msg); cmsg; cmsg = CMSG_NXTHDR(msg, cmsg)) {
+				if (cmsg->cmsg_level == IPPROTO_IPV6) {
+					if (cmsg->cmsg_type == IPV6_RECVERR)
+						e = (struct sock_extended_err *)CMSG_DATA(cmsg);
+				}
+			}
+			if (e == NULL)
+				abort();
+
+			/* -k: transmit timestamps share the queue with errors. */
+			if (ping_tx_timestamp(sock, msg, e))
+				continue;
+
+			if (e->ee_origin == SO_EE_ORIGIN_LOCAL) {
+				local_errors++;
+				if (trts->opt_quiet)
+					continue;
+				if (trts->opt_flood)
+					write_stdout("E", 1);
+				else if (e->ee_errno != EMSGSIZE)
+					error(0, e->ee_errno, _("local error"));
+				else
+					error(0, 0, _("local error: message too long, mtu: %u"), e->ee_info);
+				trts->nerrors++;
+				trts->changes++;
+			} else if (e->ee_origin == SO_EE_ORIGIN_ICMP6) {
+				struct sockaddr_in6 *sin6 = (struct sockaddr_in6 *)(e + 1);
+
+				if (res < sizeof(icmph) ||
+				    memcmp(&target.sin6_addr, &trts->whereto6.sin6_addr, 16) ||
+				    icmph.icmp6_type != ICMP6_ECHO_REQUEST ||
+				    !is_ours(trts, sock, icmph.icmp6_id)) {
+					/* Not our error, not an error at all. Clear. */
+					saved_errno = 0;
+					continue;
+				}
+
+				net_errors++;
+				trts->nerrors++;
+				trts->changes++;
+				ping_log_add(trts, PING_LOG_ERROR, ntohs(icmph.icmp6_seq),
+					     timer_wheel_clock() * 1000000LL, -1, 0);
+				ping_shm_update(trts, -1);
+				if (trts->output)
+					ping_output_error(trts, ntohs(icmph.icmp6_seq), sin6,
+							  e->ee_type, e->ee_code);
+				if (trts->opt_quiet)
+					continue;
+				if (trts->opt_flood) {
+					write_stdout("\bE", 2);
+				} else {
+					print_timestamp(trts);
+					ping_printf(trts, _("From %s icmp_seq=%u "), pr_addr(trts, sin6, sizeof *sin6), ntohs(icmph.icmp6_seq));
+					print_icmp(trts, e->ee_type, e->ee_code, e->ee_info);
+					ping_printf(trts, "\n");
+					fflush(stdout);
+				}
+			}
 		}
-	}
+	} while (n == PING_ERR_BATCH);
 
-out:
 	errno = saved_errno;
 	return net_errors ? net_errors : -local_errors;
 }
@@ -523,11 +547,10 @@ out:
  * 	Compose and transmit an ICMP ECHO REQUEST packet.  The IP packet
  * will be added on by the kernel.  The ID field is a random number,
  * and the sequence number is an ascending integer.  The first several bytes
- * of the data portion are used to hold a UNIX "timeval" struct in VAX
+ * of the data portion are used to hold a UNIX "timespec" struct in host
  * byte-order, to compute the round-trip time.
  */
-int build_echo(struct ping_rts *rts, uint8_t *_icmph,
-	       unsigned packet_size __attribute__((__unused__)))
+int build_echo(struct ping_rts *rts, uint8_t *_icmph, long seq)
 {
 	struct icmp6_hdr *icmph;
 	int cc;
@@ -536,12 +559,15 @@ int build_echo(struct ping_rts *rts, uint8_t *_icmph,
 	icmph->icmp6_type = ICMP6_ECHO_REQUEST;
 	icmph->icmp6_code = 0;
 	icmph->icmp6_cksum = 0;
-	icmph->icmp6_seq = htons(rts->ntransmitted + 1);
+	icmph->icmp6_seq = htons(seq);
 	icmph->icmp6_id = rts->ident;
 
-	if (rts->timing)
-		gettimeofday((struct timeval *)&_icmph[8],
-		    (struct timezone *)NULL);
+	if (rts->timing) {
+		struct timespec now;
+
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		memcpy(&_icmph[8], &now, sizeof(now));
+	}
 
 	cc = rts->datalen + 8;			/* skips ICMP portion */
 
@@ -549,8 +575,7 @@ int build_echo(struct ping_rts *rts, uint8_t *_icmph,
 }
 
 
-int build_niquery(struct ping_rts *rts, uint8_t *_nih,
-		  unsigned packet_size __attribute__((__unused__)))
+int build_niquery(struct ping_rts *rts, uint8_t *_nih, long seq)
 {
 	struct ni_hdr *nih;
 	int cc;
@@ -562,7 +587,7 @@ int build_niquery(struct ping_rts *rts, uint8_t *_nih,
 	cc = sizeof(*nih);
 	rts->datalen = 0;
 
-	niquery_fill_nonce(&rts->ni, rts->ntransmitted + 1, nih->ni_nonce);
+	niquery_fill_nonce(&rts->ni, seq, nih->ni_nonce);
 	nih->ni_code = rts->ni.subject_type;
 	nih->ni_qtype = htons(rts->ni.query);
 	nih->ni_flags = rts->ni.flag;
@@ -572,60 +597,45 @@ int build_niquery(struct ping_rts *rts, uint8_t *_nih,
 	return cc;
 }
 
-int ping6_send_probe(struct ping_rts *rts, socket_st *sock, void *packet, unsigned packet_size)
+int ping6_build_probe(struct ping_rts *rts, socket_st *sock __attribute__((__unused__)),
+		      void *packet, long seq, struct msghdr *msg)
 {
-	int len, cc;
+	int len;
 
-	rcvd_clear(rts, rts->ntransmitted + 1);
+	rcvd_clear(rts, seq);
 
 	if (niquery_is_enabled(&rts->ni))
-		len = build_niquery(rts, packet, packet_size);
+		len = build_niquery(rts, packet, seq);
 	else
-		len = build_echo(rts, packet, packet_size);
-
-	if (rts->cmsglen == 0) {
-		cc = sendto(sock->fd, (char *)packet, len, rts->confirm,
-			    (struct sockaddr *)&rts->whereto6,
-			    sizeof(struct sockaddr_in6));
-	} else {
-		struct msghdr mhdr;
-		struct iovec iov;
-
-		iov.iov_len = len;
-		iov.iov_base = packet;
+		len = build_echo(rts, packet, seq);
 
-		memset(&mhdr, 0, sizeof(mhdr));
-		mhdr.msg_name = &rts->whereto6;
-		mhdr.msg_namelen = sizeof(struct sockaddr_in6);
-		mhdr.msg_iov = &iov;
-		mhdr.msg_iovlen = 1;
-		mhdr.msg_control = rts->cmsgbuf;
-		mhdr.msg_controllen = rts->cmsglen;
-
-		cc = sendmsg(sock->fd, &mhdr, rts->confirm);
+	msg->msg_name = &rts->whereto6;
+	msg->msg_namelen = sizeof(struct sockaddr_in6);
+	if (rts->cmsglen) {
+		msg->msg_control = rts->cmsgbuf;
+		msg->msg_controllen = rts->cmsglen;
 	}
-	rts->confirm = 0;
 
-	return (cc == len ? 0 : cc);
+	return len;
 }
 
-void pr_echo_reply(uint8_t *_icmph, int cc __attribute__((__unused__)))
+void pr_echo_reply(struct ping_rts *rts, uint8_t *_icmph, int cc __attribute__((__unused__)))
 {
 	struct icmp6_hdr *icmph = (struct icmp6_hdr *)_icmph;
 
-	printw(_(" icmp_seq=%u"), ntohs(icmph->icmp6_seq));
+	ping_printf(rts, _(" icmp_seq=%u"), ntohs(icmph->icmp6_seq));
 }
 
-static void putchar_safe(char c)
+static void putchar_safe(struct ping_rts *rts, char c)
 {
 	if (isprint(c))
-		putchar(c);
+		ping_printf(rts, "%c", c);
 	else
-		printf("\\%03o", c);
+		ping_printf(rts, "\\%03o", c);
 }
 
 static
-void pr_niquery_reply_name(struct ni_hdr *nih, int len)
+void pr_niquery_reply_name(struct ping_rts *rts, struct ni_hdr *nih, int len)
 {
 	uint8_t *h = (uint8_t *)(nih + 1);
 	uint8_t *p = h + 4;
@@ -637,7 +647,7 @@ void pr_niquery_reply_name(struct ni_hdr *nih, int len)
 	len -= sizeof(struct ni_hdr) + 4;
 
 	if (len < 0) {
-		printf(_(" parse error (too short)"));
+		ping_printf(rts, _(" parse error (too short)"));
 		return;
 	}
 	while (p < end) {
@@ -647,21 +657,21 @@ void pr_niquery_reply_name(struct ni_hdr *nih, int len)
 		memset(buf, 0xff, sizeof(buf));
 
 		if (continued)
-			putchar(',');
+			ping_printf(rts, ",");
 
 		ret = dn_expand(h, end, p, buf, sizeof(buf));
 		if (ret < 0) {
-			printf(_(" parse error (truncated)"));
+			ping_printf(rts, _(" parse error (truncated)"));
 			break;
 		}
 		if (p + ret < end && *(p + ret) == '\0')
 			fqdn = 0;
 
-		putchar(' ');
+		ping_printf(rts, " ");
 		for (i = 0; i < strlen(buf); i++)
-			putchar_safe(buf[i]);
+			putchar_safe(rts, buf[i]);
 		if (fqdn)
-			putchar('.');
+			ping_printf(rts, ".");
 
 		p += ret + !fqdn;
 
@@ -670,7 +680,7 @@ void pr_niquery_reply_name(struct ni_hdr *nih, int len)
 }
 
 static
-void pr_niquery_reply_addr(struct ni_hdr *nih, int len)
+void pr_niquery_reply_addr(struct ping_rts *rts, struct ni_hdr *nih, int len)
 {
 	uint8_t *h = (uint8_t *)(nih + 1);
 	uint8_t *p;
@@ -698,33 +708,33 @@ void pr_niquery_reply_addr(struct ni_hdr *nih, int len)
 	}
 	p = h;
 	if (len < 0) {
-		printf(_(" parse error (too short)"));
+		ping_printf(rts, _(" parse error (too short)"));
 		return;
 	}
 
 	while (p < end) {
 		if (continued)
-			putchar(',');
+			ping_printf(rts, ",");
 
 		if (p + sizeof(uint32_t) + aflen > end) {
-			printf(_(" parse error (truncated)"));
+			ping_printf(rts, _(" parse error (truncated)"));
 			break;
 		}
 		if (!inet_ntop(af, p + sizeof(uint32_t), buf, sizeof(buf)))
-			printf(_(" unexpected error in inet_ntop(%s)"),
+			ping_printf(rts, _(" unexpected error in inet_ntop(%s)"),
 			       strerror(errno));
 		else
-			printf(" %s", buf);
+			ping_printf(rts, " %s", buf);
 		p += sizeof(uint32_t) + aflen;
 
 		continued = 1;
 	}
 	if (truncated)
-		printf(_(" (truncated)"));
+		ping_printf(rts, _(" (truncated)"));
 }
 
 static
-void pr_niquery_reply(uint8_t *_nih, int len)
+void pr_niquery_reply(struct ping_rts *rts, uint8_t *_nih, int len)
 {
 	struct ni_hdr *nih = (struct ni_hdr *)_nih;
 
@@ -732,26 +742,26 @@ void pr_niquery_reply(uint8_t *_nih, int len)
 	case IPUTILS_NI_ICMP6_SUCCESS:
 		switch (ntohs(nih->ni_qtype)) {
 		case IPUTILS_NI_QTYPE_DNSNAME:
-			pr_niquery_reply_name(nih, len);
+			pr_niquery_reply_name(rts, nih, len);
 			break;
 		case IPUTILS_NI_QTYPE_IPV4ADDR:
 		case IPUTILS_NI_QTYPE_IPV6ADDR:
-			pr_niquery_reply_addr(nih, len);
+			pr_niquery_reply_addr(rts, nih, len);
 			break;
 		default:
-			printf(_(" unknown qtype(0x%02x)"), ntohs(nih->ni_qtype));
+			ping_printf(rts, _(" unknown qtype(0x%02x)"), ntohs(nih->ni_qtype));
 		}
 		break;
 	case IPUTILS_NI_ICMP6_REFUSED:
-		printf(_(" refused"));
+		ping_printf(rts, _(" refused"));
 		break;
 	case IPUTILS_NI_ICMP6_UNKNOWN:
-		printf(_(" unknown"));
+		ping_printf(rts, _(" unknown"));
 		break;
 	default:
-		printf(_(" unknown code(%02x)"), ntohs(nih->ni_code));
+		ping_printf(rts, _(" unknown code(%02x)"), ntohs(nih->ni_code));
 	}
-	printf(_("; seq=%u;"), ntohsp((uint16_t *)nih->ni_nonce));
+	ping_printf(rts, _("; seq=%u;"), ntohsp((uint16_t *)nih->ni_nonce));
 }
 
 /*
@@ -763,7 +773,7 @@ void pr_niquery_reply(uint8_t *_nih, int len)
  */
 int ping6_parse_reply(struct ping_rts *rts, socket_st *sock,
 		      struct msghdr *msg, int cc, void *addr,
-		      struct timeval *tv)
+		      struct timespec *ts)
 {
 	struct sockaddr_in6 *from = addr;
 	uint8_t *buf = msg->msg_iov->iov_base;
@@ -796,6 +806,9 @@ int ping6_parse_reply(struct ping_rts *rts, socket_st *sock,
 	}
 
 	if (icmph->icmp6_type == ICMP6_ECHO_REPLY) {
+		rts = ping_target_lookup(rts, AF_INET6, &from->sin6_addr);
+		if (!rts)
+			return 1;
 		if (!rts->multicast &&
 		    memcmp(&from->sin6_addr.s6_addr, &rts->whereto6.sin6_addr.s6_addr, 16))
 			return 1;
@@ -805,7 +818,7 @@ int ping6_parse_reply(struct ping_rts *rts, socket_st *sock,
 			return 1;	/* 'Twas really not our ECHO */
 		if (gather_statistics(rts, (uint8_t *)icmph, sizeof(*icmph), cc,
 				      ntohs(icmph->icmp6_seq),
-				      hops, 0, tv, pr_addr(rts, from, sizeof *from),
+				      hops, 0, ts, pr_addr(rts, from, sizeof *from),
 				      pr_echo_reply,
 				      rts->multicast)) {
 			fflush(stdout);
@@ -813,12 +826,17 @@ int ping6_parse_reply(struct ping_rts *rts, socket_st *sock,
 		}
 	} else if (icmph->icmp6_type == IPUTILS_NI_ICMP6_REPLY) {
 		struct ni_hdr *nih = (struct ni_hdr *)icmph;
-		int seq = niquery_check_nonce(&rts->ni, nih->ni_nonce);
+		int seq;
+
+		rts = ping_target_lookup(rts, AF_INET6, &from->sin6_addr);
+		if (!rts)
+			return 1;
+		seq = niquery_check_nonce(&rts->ni, nih->ni_nonce);
 		if (seq < 0)
 			return 1;
 		if (gather_statistics(rts, (uint8_t *)icmph, sizeof(*icmph), cc,
 				      seq,
-				      hops, 0, tv, pr_addr(rts, from, sizeof *from),
+				      hops, 0, ts, pr_addr(rts, from, sizeof *from),
 				      pr_niquery_reply,
 				      rts->multicast))
 			return 0;
@@ -837,7 +855,8 @@ int ping6_parse_reply(struct ping_rts *rts, socket_st *sock,
 		if (cc < (int)(8 + sizeof(struct ip6_hdr) + 8))
 			return 1;
 
-		if (memcmp(&iph1->ip6_dst, &rts->whereto6.sin6_addr, 16))
+		rts = ping_target_lookup(rts, AF_INET6, &iph1->ip6_dst);
+		if (!rts || memcmp(&iph1->ip6_dst, &rts->whereto6.sin6_addr, 16))
 			return 1;
 
 		nexthdr = iph1->ip6_nxt;
@@ -858,17 +877,15 @@ int ping6_parse_reply(struct ping_rts *rts, socket_st *sock,
 		if (!rts->opt_verbose || rts->uid)
 			return 1;
 		print_timestamp(rts);
-		printw(_("From %s: "), pr_addr(rts, from, sizeof *from));
-		print_icmp(icmph->icmp6_type, icmph->icmp6_code, ntohl(icmph->icmp6_mtu));
+		ping_printf(rts, _("From %s: "), pr_addr(rts, from, sizeof *from));
+		print_icmp(rts, icmph->icmp6_type, icmph->icmp6_code, ntohl(icmph->icmp6_mtu));
 	}
 
-	if (rts->opt_audible) {
-		printw("\a");
-		if (rts->opt_flood)
-			fflush(stdout);
-	}
+	/* The screen rings it: curses is not the measurement thread's. */
+	if (rts->opt_audible)
+		rts->bells++;
 	if (!rts->opt_flood) {
-		printw("\n");
+		ping_printf(rts, "\n");
 		fflush(stdout);
 	}
 	return 0;
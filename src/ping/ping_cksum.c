@@ -0,0 +1,118 @@
+/*
+ * Internet checksum.
+ *
+ * The one's complement sum of RFC 1071 does not care how wide the words
+ * added up are, as long as the carries out of the top are added back in
+ * at the end, nor in what byte order they are, as long as the result is
+ * read back the same way.  So the packet is summed 64 bits at a time into
+ * a 64 bit accumulator, or with SSE2/AVX2 into 64 bit lanes of 32 bit
+ * words, and only folded to 16 bits once.  The widest kernel the CPU has
+ * is picked on the first call.
+ */
+#include "iputils_common.h"
+#include "ping.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+# include <immintrin.h>
+# define PING_CKSUM_X86
+#endif
+
+/* Sum of the "len" bytes at "p", in 64 bit words; the tail is zero padded. */
+static uint64_t cksum_words(const unsigned char *p, size_t len, uint64_t sum)
+{
+	uint64_t w;
+
+	for (; len >= 8; p += 8, len -= 8) {
+		memcpy(&w, p, 8);
+		sum += w;
+		sum += sum < w;		/* end around carry */
+	}
+	if (len) {
+		w = 0;
+		memcpy(&w, p, len);
+		sum += w;
+		sum += sum < w;
+	}
+	return sum;
+}
+
+#ifdef PING_CKSUM_X86
+__attribute__((target("sse2")))
+static uint64_t cksum_sse2(const unsigned char *p, size_t len, uint64_t sum)
+{
+	const __m128i zero = _mm_setzero_si128();
+	__m128i acc = _mm_setzero_si128();
+	uint64_t lanes[2];
+
+	for (; len >= 16; p += 16, len -= 16) {
+		__m128i v = _mm_loadu_si128((const __m128i *)p);
+
+		acc = _mm_add_epi64(acc, _mm_unpacklo_epi32(v, zero));
+		acc = _mm_add_epi64(acc, _mm_unpackhi_epi32(v, zero));
+	}
+	/* A lane takes 2^31 blocks to overflow, more than any packet has. */
+	_mm_storeu_si128((__m128i *)lanes, acc);
+	sum = cksum_words((const unsigned char *)&lanes[0], 8, sum);
+	sum = cksum_words((const unsigned char *)&lanes[1], 8, sum);
+	return cksum_words(p, len, sum);
+}
+
+__attribute__((target("avx2")))
+static uint64_t cksum_avx2(const unsigned char *p, size_t len, uint64_t sum)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	__m256i acc0 = _mm256_setzero_si256();
+	__m256i acc1 = _mm256_setzero_si256();
+	uint64_t lanes[4];
+	int i;
+
+	/* Two 32 byte blocks per round keep two chains of adds going. */
+	for (; len >= 64; p += 64, len -= 64) {
+		__m256i v0 = _mm256_loadu_si256((const __m256i *)p);
+		__m256i v1 = _mm256_loadu_si256((const __m256i *)(p + 32));
+
+		acc0 = _mm256_add_epi64(acc0, _mm256_unpacklo_epi32(v0, zero));
+		acc1 = _mm256_add_epi64(acc1, _mm256_unpackhi_epi32(v0, zero));
+		acc0 = _mm256_add_epi64(acc0, _mm256_unpacklo_epi32(v1, zero));
+		acc1 = _mm256_add_epi64(acc1, _mm256_unpackhi_epi32(v1, zero));
+	}
+	_mm256_storeu_si256((__m256i *)lanes, _mm256_add_epi64(acc0, acc1));
+	for (i = 0; i < 4; i++)
+		sum = cksum_words((const unsigned char *)&lanes[i], 8, sum);
+	return cksum_words(p, len, sum);
+}
+#endif
+
+static uint64_t cksum_pick(const unsigned char *p, size_t len, uint64_t sum);
+
+static uint64_t (*cksum_kernel)(const unsigned char *p, size_t len, uint64_t sum) = cksum_pick;
+
+static uint64_t cksum_pick(const unsigned char *p, size_t len, uint64_t sum)
+{
+	cksum_kernel = cksum_words;
+#ifdef PING_CKSUM_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		cksum_kernel = cksum_avx2;
+	else if (__builtin_cpu_supports("sse2"))
+		cksum_kernel = cksum_sse2;
+#endif
+	return cksum_kernel(p, len, sum);
+}
+
+/*
+ * in_cksum --
+ *	Checksum of the "len" bytes at "addr", starting from the complement
+ * of "csum": passing the checksum of a packet as "csum" extends it over
+ * more data.
+ */
+unsigned short in_cksum(const unsigned short *addr, int len, unsigned short csum)
+{
+	uint64_t sum = cksum_kernel((const unsigned char *)addr, len, csum);
+
+	sum = (sum & 0xffffffff) + (sum >> 32);
+	sum = (sum & 0xffffffff) + (sum >> 32);
+	sum = (sum & 0xffff) + (sum >> 16);
+	sum = (sum & 0xffff) + (sum >> 16);
+	return ~sum;
+}
@@ -38,10 +38,6 @@
 #define _GNU_SOURCE
 #endif
 
-#ifndef HZ
-#define HZ sysconf(_SC_CLK_TCK)
-#endif
-
 #ifndef HAVE_LIBCAP
 static uid_t euid;
 #endif
@@ -148,7 +144,7 @@ void drop_capabilities(void)
 }
 
 /* Fills all the outpack, excluding ICMP header, but _including_
- * timestamp area with supplied pattern.
+ * timestamp area with supplied pattern, or random bytes for "random".
  */
 void fill(struct ping_rts *rts, char *patp, unsigned char *packet, size_t packet_size)
 {
@@ -157,6 +153,17 @@ void fill(struct ping_rts *rts, char *patp, unsigned char *packet, size_t packet
 	char *cp;
 	unsigned char *bp = packet + 8;
 
+	/* Made once, so a random payload costs no more per probe than a pattern. */
+	if (!strcmp(patp, "random")) {
+		size_t kk;
+
+		for (kk = 0; kk < packet_size; kk++)
+			bp[kk] = random();
+		if (!rts->opt_quiet)
+			printw(_("PATTERN: random\n"));
+		return;
+	}
+
 #ifdef USE_IDN
 	setlocale(LC_ALL, "C");
 #endif
@@ -194,8 +201,6 @@ void fill(struct ping_rts *rts, char *patp, unsigned char *packet, size_t packet
 static void sigexit(int signo __attribute__((__unused__)))
 {
 	global_rts->exiting = 1;
-	if (global_rts->in_pr_addr)
-		longjmp(global_rts->pr_addr_jmp, 0);
 }
 
 static void sigstatus(int signo __attribute__((__unused__)))
@@ -203,37 +208,11 @@ static void sigstatus(int signo __attribute__((__unused__)))
 	global_rts->status_snapshot = 1;
 }
 
-int __schedule_exit(int next)
-{
-	static unsigned long waittime;
-	struct itimerval it;
-
-	if (waittime)
-		return next;
-
-	if (global_rts->nreceived) {
-		waittime = 2 * global_rts->tmax;
-		if (waittime < 1000 * (unsigned long)global_rts->interval)
-			waittime = 1000 * global_rts->interval;
-	} else
-		waittime = global_rts->lingertime * 1000;
-
-	if (next < 0 || (unsigned long)next < waittime / 1000)
-		next = waittime / 1000;
-
-	it.it_interval.tv_sec = 0;
-	it.it_interval.tv_usec = 0;
-	it.it_value.tv_sec = waittime / 1000000;
-	it.it_value.tv_usec = waittime % 1000000;
-	setitimer(ITIMER_REAL, &it, NULL);
-	return next;
-}
-
 static inline void update_interval(struct ping_rts *rts)
 {
-	int est = rts->rtt ? rts->rtt / 8 : rts->interval * 1000;
+	long long est = rts->stats.count ? ping_stats_ewma(&rts->stats) : rts->interval * 1000000LL;
 
-	rts->interval = (est + rts->rtt_addend + 500) / 1000;
+	rts->interval = (est + rts->rtt_addend + 500000) / 1000000;
 	if (rts->uid && rts->interval < MINUSERINTERVAL)
 		rts->interval = MINUSERINTERVAL;
 }
@@ -246,95 +225,354 @@ void print_timestamp(struct ping_rts *rts)
 	if (rts->opt_ptimeofday) {
 		struct timeval tv;
 		gettimeofday(&tv, NULL);
-		printw("[%lu.%06lu] ",
+		ping_printf(rts, "[%lu.%06lu] ",
 		       (unsigned long)tv.tv_sec, (unsigned long)tv.tv_usec);
 	}
 }
 
+/*
+ * send_probes --
+ *	Build "count" probes numbered from ntransmitted + 1 on and hand them
+ * to the kernel with a single sendmmsg().  The first probe is built in
+ * outpack and the others in copies of it.  Returns the number of probes
+ * sent, or -1 with errno set if not even the first one went out.
+ */
+static int send_probes(struct ping_rts *rts, ping_func_set_st *fset, socket_st *sock, int count)
+{
+	struct mmsghdr msgs[PING_SEND_BATCH];
+	struct iovec iov[PING_SEND_BATCH];
+	size_t size = rts->datalen + 28;
+	int i, cc;
+
+	/* With io_uring the probes are only queued here; should the ring
+	 * be full they go out directly. */
+	if (sock->uring) {
+		cc = ping_uring_send(rts, fset, sock, count);
+		if (cc > 0)
+			return cc;
+	}
+
+	/* The copies are made once: a probe differs from the next only in
+	 * what build_probe() writes. */
+	if (count > 1 && !rts->sendpack) {
+		rts->sendpack = malloc(size * (PING_SEND_BATCH - 1));
+		if (!rts->sendpack)
+			count = 1;
+		for (i = 0; rts->sendpack && i < PING_SEND_BATCH - 1; i++)
+			memcpy(rts->sendpack + i * size, rts->outpack, size);
+	}
+
+	memset(msgs, 0, sizeof(msgs[0]) * count);
+	for (i = 0; i < count; i++) {
+		unsigned char *packet = rts->outpack;
+
+		if (i > 0)
+			packet = rts->sendpack + (i - 1) * size;
+		iov[i].iov_base = packet;
+		iov[i].iov_len = fset->build_probe(rts, sock, packet, rts->ntransmitted + 1 + i,
+						   &msgs[i].msg_hdr);
+		msgs[i].msg_hdr.msg_iov = &iov[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	cc = sendmmsg(sock->fd, msgs, count, rts->confirm);
+	rts->confirm = 0;
+
+	for (i = 0; i < cc; i++) {
+		/* Apparently, it is some fatal bug. */
+		if (msgs[i].msg_len != iov[i].iov_len)
+			abort();
+	}
+	return cc;
+}
+
+static struct ping_windows *windows_of(struct ping_rts *rts)
+{
+	if (!rts->windows)
+		rts->windows = ping_windows_alloc();
+	return rts->windows;
+}
+
+/* Probe "timeout" is given up on: it is lost. */
+static void probe_lost(struct ping_rts *rts, struct ping_timeout *timeout)
+{
+	rts->npending--;
+	rts->changes++;
+	ping_windows_loss(windows_of(rts), rts->wheel->now / 1000);
+	ping_loss_timeout(rts, timeout->seq, timeout->timer.expires - rts->lingertime);
+	if (rts->output)
+		ping_output_timeout(rts, timeout->seq);
+	ping_log_add(rts, PING_LOG_TIMEOUT, timeout->seq,
+		     (timeout->timer.expires - rts->lingertime) * 1000000LL, -1, 0);
+	ping_shm_update(rts, -1);
+}
+
+/* A probe was not answered within the linger time. */
+static void ping_reply_timeout(struct timer_entry *timer)
+{
+	probe_lost(timer->data, (struct ping_timeout *)timer);
+}
+
+/*
+ * timeouts_grow --
+ *	Double the ring of reply timeouts of "rts", keeping the probes still
+ * waited for.  Returns 0 if it already spans the whole sequence space.
+ */
+static int timeouts_grow(struct ping_rts *rts)
+{
+	unsigned int size = (rts->timeout_mask + 1) * 2;
+	struct ping_timeout *old = rts->timeouts, *timeouts;
+	unsigned int j;
+
+	if (size > MAX_DUP_CHK)
+		return 0;
+	timeouts = calloc(size, sizeof(*timeouts));
+	if (!timeouts)
+		error(2, errno, _("memory allocation failed"));
+	for (j = 0; j < size; j++)
+		timer_init(&timeouts[j].timer, ping_reply_timeout, rts);
+
+	for (j = 0; j <= rts->timeout_mask; j++) {
+		struct ping_timeout *from = &old[j], *to;
+
+		if (!from->seq)
+			continue;
+		to = &timeouts[from->seq & (size - 1)];
+		to->seq = from->seq;
+		to->tx_time = from->tx_time;
+		if (timer_pending(&from->timer)) {
+			timer_del(rts->wheel, &from->timer);
+			timer_add(rts->wheel, &to->timer, from->timer.expires);
+		}
+	}
+	rts->timeouts = timeouts;
+	rts->timeout_mask = size - 1;
+	free(old);
+	return 1;
+}
+
+/* Count a probe as sent and start waiting for its reply. */
+static void probe_sent(struct ping_rts *rts)
+{
+	struct ping_timeout *timeout;
+
+	advance_ntransmitted(rts);
+
+	timeout = &rts->timeouts[rts->ntransmitted & rts->timeout_mask];
+	/* Its slot is still waited on: the interval went down since the ring
+	 * was sized.  Make room; the probe in it is not lost. */
+	while (timer_pending(&timeout->timer) && timeouts_grow(rts))
+		timeout = &rts->timeouts[rts->ntransmitted & rts->timeout_mask];
+	/* Only once the sequence numbers wrap around can its reply no longer
+	 * be told apart: give up on it then. */
+	if (timer_pending(&timeout->timer)) {
+		timer_del(rts->wheel, &timeout->timer);
+		probe_lost(rts, timeout);
+	}
+	timeout->seq = rts->ntransmitted;
+	timeout->tx_time.tv_sec = 0;
+	timeout->tx_time.tv_nsec = 0;
+	timer_add(rts->wheel, &timeout->timer, rts->wheel->now + rts->lingertime);
+	rts->npending++;
+	rts->changes++;
+	ping_shm_update(rts, -1);
+}
+
+/* -k: the kernel stamps the probe just sent with the next key. */
+static void probe_keyed(struct ping_rts *rts, socket_st *sock)
+{
+	struct ping_tx_slot *slot = &sock->tx_slots[sock->tx_key & (PING_TX_SLOTS - 1)];
+
+	slot->rts = rts;
+	slot->seq = rts->ntransmitted;
+	slot->key = sock->tx_key++;
+}
+
+/*
+ * ping_tx_timestamp --
+ *	Error queue entry "msg" with extended error "e": if it is a transmit
+ * timestamp, file it with its probe and return 1.  Returns 0 for real
+ * errors.
+ */
+int ping_tx_timestamp(socket_st *sock, struct msghdr *msg, struct sock_extended_err *e)
+{
+	struct scm_timestamping tss;
+	struct ping_tx_slot *slot;
+	struct ping_timeout *probe;
+	struct cmsghdr *c;
+	int found = 0;
+
+	if (e->ee_origin != SO_EE_ORIGIN_TIMESTAMPING)
+		return 0;
+	if (!sock->tx_slots)
+		return 1;
+
+	for (c = CMSG_FIRSTHDR(msg); c; c = CMSG_NXTHDR(msg, c)) {
+		if (c->cmsg_level != SOL_SOCKET || c->cmsg_type != SCM_TIMESTAMPING)
+			continue;
+		if (c->cmsg_len < CMSG_LEN(sizeof(tss)))
+			continue;
+		memcpy(&tss, CMSG_DATA(c), sizeof(tss));
+		found = 1;
+	}
+
+	slot = &sock->tx_slots[e->ee_data & (PING_TX_SLOTS - 1)];
+	if (!found || !slot->rts || slot->key != e->ee_data)
+		return 1;
+	probe = &slot->rts->timeouts[slot->seq & slot->rts->timeout_mask];
+	if (probe->seq != slot->seq)
+		return 1;
+
+	/* Scheduled, then handed to the device: keep the later stamp. */
+	ts_add(&tss.ts[0], -ping_clock_skew());
+	if (tsdiff(&tss.ts[0], &probe->tx_time) > 0)
+		probe->tx_time = tss.ts[0];
+	return 1;
+}
+
+/*
+ * kernel_send_time --
+ *	With -k, replace the send time probe "seq" carries, "sent", by the
+ * one the kernel gave, and account for the delay in between.
+ */
+static void kernel_send_time(struct ping_rts *rts, uint16_t seq, struct timespec *sent)
+{
+	struct ping_timeout *probe = &rts->timeouts[seq & rts->timeout_mask];
+	long long delay;
+
+	if ((uint16_t)probe->seq != seq)
+		return;
+
+	/* On a fast path the reply may overtake the stamp. */
+	if (!probe->tx_time.tv_sec) {
+		int saved_errno = errno;
+
+		rts->fset->receive_error_msg(rts, rts->sock);
+		errno = saved_errno;
+		if (!probe->tx_time.tv_sec)
+			return;
+	}
+
+	delay = tsdiff(&probe->tx_time, sent);
+	if (delay >= 0) {
+		rts->sdelay_sum += delay;
+		rts->nsdelay++;
+		if (delay > rts->sdelay_max)
+			rts->sdelay_max = delay;
+	}
+	*sent = probe->tx_time;
+	probe->tx_time.tv_sec = 0;
+	probe->tx_time.tv_nsec = 0;
+}
+
+/* The reply to "seq" arrived.  Returns 1 if the probe was still waited for. */
+static int probe_answered(struct ping_rts *rts, uint16_t seq)
+{
+	struct ping_timeout *timeout = &rts->timeouts[seq & rts->timeout_mask];
+	int settled = 0;
+
+	if (timer_pending(&timeout->timer) && (uint16_t)timeout->seq == seq) {
+		timer_del(rts->wheel, &timeout->timer);
+		rts->npending--;
+		settled = 1;
+	}
+
+	/* Flood and adaptive ping are paced by replies. */
+	if ((!rts->interval || rts->opt_adaptive) && timer_pending(&rts->send_timer))
+		timer_add(rts->wheel, &rts->send_timer, rts->wheel->now);
+	return settled;
+}
+
 /*
  * pinger --
  * 	Compose and transmit an ICMP ECHO REQUEST packet.  The IP packet
  * will be added on by the kernel.  The ID field is a random number,
  * and the sequence number is an ascending integer.  The first several bytes
- * of the data portion are used to hold a UNIX "timeval" struct in VAX
+ * of the data portion are used to hold a UNIX "timespec" struct in host
  * byte-order, to compute the round-trip time.
  */
 int pinger(struct ping_rts *rts, ping_func_set_st *fset, socket_st *sock)
 {
-	static int oom_count;
-	static int tokens;
+	int64_t now = rts->wheel->now;
+	int count;
 	int i;
 
 	/* Check that packets < rate*time + preload */
 	if (rts->cur_time.tv_sec == 0) {
-		gettimeofday(&rts->cur_time, NULL);
-		tokens = rts->interval * (rts->preload - 1);
+		clock_gettime(CLOCK_MONOTONIC, &rts->cur_time);
+		rts->send_at = now - (int64_t)rts->interval * (rts->preload - 1);
+	} else if (!rts->interval) {
+		/* Case of unlimited flood is special;
+		 * if we see no reply, they are limited to 100pps */
+		if (now < rts->send_at + MININTERVAL && in_flight(rts) >= rts->preload)
+			return rts->send_at + MININTERVAL - now;
+		rts->send_at = now;
 	} else {
-		long ntokens, tmp;
-		struct timeval tv;
-
-		gettimeofday(&tv, NULL);
-		ntokens = (tv.tv_sec - rts->cur_time.tv_sec) * 1000 +
-			  (tv.tv_usec - rts->cur_time.tv_usec) / 1000;
-		if (!rts->interval) {
-			/* Case of unlimited flood is special;
-			 * if we see no reply, they are limited to 100pps */
-			if (ntokens < MININTERVAL && in_flight(rts) >= rts->preload)
-				return MININTERVAL - ntokens;
-		}
-		ntokens += tokens;
-		tmp = (long)rts->interval * (long)rts->preload;
-		if (tmp < ntokens)
-			ntokens = tmp;
-		if (ntokens < rts->interval)
-			return rts->interval - ntokens;
-
-		rts->cur_time = tv;
-		tokens = ntokens - rts->interval;
+		if (now < rts->send_at)
+			return rts->send_at - now;
+		/* Never owe more than a preload worth of probes. */
+		if (rts->send_at < now - (int64_t)rts->interval * (rts->preload - 1))
+			rts->send_at = now - (int64_t)rts->interval * (rts->preload - 1);
 	}
 
 	if (rts->opt_outstanding) {
 		if (rts->ntransmitted > 0 && !rcvd_test(rts, rts->ntransmitted)) {
 			print_timestamp(rts);
-			printw(_("no answer yet for icmp_seq=%lu\n"), (rts->ntransmitted % MAX_DUP_CHK));
+			ping_printf(rts, _("no answer yet for icmp_seq=%lu\n"), (rts->ntransmitted % MAX_DUP_CHK));
 			fflush(stdout);
 		}
 	}
 
+	/* Whatever else is due right now goes out in the same sendmmsg():
+	 * the preload burst, or a flood refilling its pipe. */
+	if (rts->interval)
+		count = 1 + (now - rts->send_at) / rts->interval;
+	else
+		count = rts->preload - in_flight(rts);
+	if (count > PING_SEND_BATCH)
+		count = PING_SEND_BATCH;
+	if (count < 1)
+		count = 1;
+
 resend:
-	i = fset->send_probe(rts, sock, rts->outpack, sizeof(rts->outpack));
-
-	if (i == 0) {
-		oom_count = 0;
-		advance_ntransmitted(rts);
-		if (!rts->opt_quiet && rts->opt_flood) {
-			/* Very silly, but without this output with
-			 * high preload or pipe size is very confusing. */
-			if ((rts->preload < rts->screen_width && rts->pipesize < rts->screen_width) ||
-			    in_flight(rts) < rts->screen_width)
-				write_stdout(".", 1);
+	i = send_probes(rts, fset, sock, count);
+
+	if (i > 0) {
+		clock_gettime(CLOCK_MONOTONIC, &rts->cur_time);
+		rts->oom_count = 0;
+		/* The probes that did not fit stay due and are retried,
+		 * reporting their error, on the next call. */
+		rts->send_at += (int64_t)i * rts->interval;
+		while (i--) {
+			probe_sent(rts);
+			if (sock->tx_slots)
+				probe_keyed(rts, sock);
+			if (!rts->opt_quiet && rts->opt_flood) {
+				/* Very silly, but without this output with
+				 * high preload or pipe size is very confusing. */
+				if ((rts->preload < rts->screen_width && rts->pipesize < rts->screen_width) ||
+				    in_flight(rts) < rts->screen_width)
+					write_stdout(".", 1);
+			}
 		}
-		return rts->interval - tokens;
+		return rts->send_at - now;
 	}
 
 	/* And handle various errors... */
-	if (i > 0) {
-		/* Apparently, it is some fatal bug. */
-		abort();
-	} else if (errno == ENOBUFS || errno == ENOMEM) {
+	if (errno == ENOBUFS || errno == ENOMEM) {
 		int nores_interval;
 
 		/* Device queue overflow or OOM. Packet is not sent. */
-		tokens = 0;
+		rts->send_at = now + rts->interval;
 		/* Slowdown. This works only in adaptive mode (option -A) */
-		rts->rtt_addend += (rts->rtt < 8 * 50000 ? rts->rtt / 8 : 50000);
+		rts->rtt_addend += (ping_stats_ewma(&rts->stats) < 50000000 ? ping_stats_ewma(&rts->stats) : 50000000);
 		if (rts->opt_adaptive)
 			update_interval(rts);
 		nores_interval = SCHINT(rts->interval / 2);
 		if (nores_interval > 500)
 			nores_interval = 500;
-		oom_count++;
-		if (oom_count * nores_interval < rts->lingertime)
+		rts->oom_count++;
+		if (rts->oom_count * nores_interval < rts->lingertime)
 			return nores_interval;
 		i = 0;
 		/* Fall to hard error. It is to avoid complete deadlock
@@ -343,7 +581,6 @@ resend:
 		 * exit some day. :-) */
 	} else if (errno == EAGAIN) {
 		/* Socket buffer is full. */
-		tokens += rts->interval;
 		return MININTERVAL;
 	} else {
 		if ((i = fset->receive_error_msg(rts, sock)) > 0) {
@@ -367,7 +604,7 @@ resend:
 
 hard_local_error:
 	/* Hard local error. Pretend we sent packet. */
-	advance_ntransmitted(rts);
+	probe_sent(rts);
 
 	if (i == 0 && !rts->opt_quiet) {
 		if (rts->opt_flood)
@@ -375,7 +612,7 @@ hard_local_error:
 		else
 			error(0, errno, "sendmsg");
 	}
-	tokens = 0;
+	rts->send_at = now + rts->interval;
 	return SCHINT(rts->interval);
 }
 
@@ -390,7 +627,8 @@ void sock_setbufs(struct ping_rts *rts, socket_st *sock, int alloc)
 		rts->sndbuf = alloc;
 	setsockopt(sock->fd, SOL_SOCKET, SO_SNDBUF, (char *)&rts->sndbuf, sizeof(rts->sndbuf));
 
-	rcvbuf = hold = alloc * rts->preload;
+	/* The socket may be shared by several targets, this one included. */
+	rcvbuf = hold = alloc * rts->preload * (sock->ntargets + 1);
 	if (hold < 65536)
 		hold = 65536;
 	setsockopt(sock->fd, SOL_SOCKET, SO_RCVBUF, (char *)&hold, sizeof(hold));
@@ -423,11 +661,25 @@ void setup(struct ping_rts *rts, socket_st *sock)
 	if (rts->opt_so_dontroute)
 		setsockopt(sock->fd, SOL_SOCKET, SO_DONTROUTE, (char *)&hold, sizeof(hold));
 
-#ifdef SO_TIMESTAMP
+	if (rts->opt_txstamp && !sock->tx_slots) {
+		int flags = SOF_TIMESTAMPING_TX_SCHED | SOF_TIMESTAMPING_TX_SOFTWARE |
+			    SOF_TIMESTAMPING_SOFTWARE | SOF_TIMESTAMPING_OPT_ID |
+			    SOF_TIMESTAMPING_OPT_TSONLY;
+
+		if (setsockopt(sock->fd, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags))) {
+			error(0, errno, _("Warning: no kernel transmit timestamps"));
+		} else {
+			sock->tx_slots = calloc(PING_TX_SLOTS, sizeof(*sock->tx_slots));
+			if (!sock->tx_slots)
+				error(2, errno, _("memory allocation failed"));
+		}
+	}
+
+#ifdef SO_TIMESTAMPNS
 	if (!rts->opt_latency) {
 		int on = 1;
-		if (setsockopt(sock->fd, SOL_SOCKET, SO_TIMESTAMP, &on, sizeof(on)))
-			error(0, 0, _("Warning: no SO_TIMESTAMP support, falling back to SIOCGSTAMP"));
+		if (setsockopt(sock->fd, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on)))
+			error(0, 0, _("Warning: no SO_TIMESTAMPNS support, falling back to SIOCGSTAMPNS"));
 	}
 #endif
 #ifdef SO_MARK
@@ -459,13 +711,6 @@ void setup(struct ping_rts *rts, socket_st *sock)
 	}
 	setsockopt(sock->fd, SOL_SOCKET, SO_SNDTIMEO, (char *)&tv, sizeof(tv));
 
-	/* Set RCVTIMEO to "interval". Note, it is just an optimization
-	 * allowing to avoid redundant poll(). */
-	tv.tv_sec = SCHINT(rts->interval) / 1000;
-	tv.tv_usec = 1000 * (SCHINT(rts->interval) % 1000);
-	if (setsockopt(sock->fd, SOL_SOCKET, SO_RCVTIMEO, (char *)&tv, sizeof(tv)))
-		rts->opt_flood_poll = 1;
-
 	if (!rts->opt_pingfilled) {
 		size_t i;
 		unsigned char *p = rts->outpack + 8;
@@ -475,27 +720,26 @@ void setup(struct ping_rts *rts, socket_st *sock)
 			*p++ = i;
 	}
 
+	/* The payload past the timestamp never changes: its part of the
+	 * ICMP checksum is summed once, see ping4_build_probe(). */
+	if (rts->timing)
+		rts->payload_cksum = in_cksum((unsigned short *)(rts->outpack + 8 + sizeof(struct timespec)),
+					      rts->datalen - sizeof(struct timespec), 0);
+	else
+		rts->payload_cksum = in_cksum((unsigned short *)(rts->outpack + 8), rts->datalen, 0);
+
+	/* All targets on a raw socket use the same id, so that one
+	 * socket filter passes the replies for every one of them. */
 	if (sock->socktype == SOCK_RAW)
-		rts->ident = rand() & 0xFFFF;
+		rts->ident = sock->ident;
 
 	set_signal(SIGINT, sigexit);
-	set_signal(SIGALRM, sigexit);
 	set_signal(SIGQUIT, sigstatus);
 
 	sigemptyset(&sset);
 	sigprocmask(SIG_SETMASK, &sset, NULL);
 
-	gettimeofday(&rts->start_time, NULL);
-
-	if (rts->deadline) {
-		struct itimerval it;
-
-		it.it_interval.tv_sec = 0;
-		it.it_interval.tv_usec = 0;
-		it.it_value.tv_sec = rts->deadline;
-		it.it_value.tv_usec = 0;
-		setitimer(ITIMER_REAL, &it, NULL);
-	}
+	clock_gettime(CLOCK_MONOTONIC, &rts->start_time);
 
 	if (isatty(STDOUT_FILENO)) {
 		struct winsize w;
@@ -508,114 +752,155 @@ void setup(struct ping_rts *rts, socket_st *sock)
 }
 
 /*
- * Return 0 if pattern in payload point to be ptr did not match the pattern that was sent  
+ * payload_mismatch --
+ *	Offset of the first byte of reply payload "ptr" past the timestamp
+ * that differs from what was sent, or 0 if they all match.  The payload is
+ * compared in one memcmp(); only a mismatch is then looked for bytewise.
  */
-int contains_pattern_in_payload(struct ping_rts *rts, uint8_t *ptr)
+static size_t payload_mismatch(struct ping_rts *rts, const uint8_t *ptr)
 {
+	const uint8_t *cp = ptr + sizeof(struct timespec);
+	const uint8_t *dp = &rts->outpack[8 + sizeof(struct timespec)];
 	size_t i;
-	uint8_t *cp, *dp;
- 
-	/* check the data */
-	cp = ((u_char *)ptr) + sizeof(struct timeval);
-	dp = &rts->outpack[8 + sizeof(struct timeval)];
-	for (i = sizeof(struct timeval); i < rts->datalen; ++i, ++cp, ++dp) {
-		if (*cp != *dp)
-			return 0;
-	}
+
+	if (rts->datalen <= sizeof(struct timespec) ||
+	    !memcmp(cp, dp, rts->datalen - sizeof(struct timespec)))
+		return 0;
+	for (i = sizeof(struct timespec); *cp == *dp; ++i, ++cp, ++dp)
+		;
+	return i;
+}
+
+int contains_pattern_in_payload(struct ping_rts *rts, uint8_t *ptr)
+{
+	if (payload_mismatch(rts, ptr))
+		return 0;
+	/* gather_statistics() need not look again. */
+	rts->payload_checked = 1;
 	return 1;
 }
 
-int main_ping(struct ping_rts *rts, ping_func_set_st *fset, socket_st *sock,
-	      uint8_t *packet, int packlen)
+/* Exit code as ping(8) would report it for the whole set of targets. */
+int ping_exit_status(ping_setup_data *setup_data)
 {
-	char addrbuf[128];
-	char ans_data[4096];
-	struct iovec iov;
-	struct msghdr msg;
-	int cc;
-	int next;
-	int polling;
-	int recv_error;
+	int i;
 
-	iov.iov_base = (char *)packet;
+	for (i = 0; i < setup_data->targets.count; i++) {
+		struct ping_rts *rts = setup_data->targets.list[i];
 
-	/* Check exit conditions. */
-	if (rts->exiting)
-		return !rts->nreceived || rts->deadline;
-	if (rts->deadline && rts->nerrors)
-		return !rts->nreceived || rts->deadline;
-	/* Check for and do special actions. */
-	if (rts->status_snapshot)
-		status(rts);
+		if (!rts->nreceived || rts->deadline)
+			return 1;
+	}
+	return 0;
+}
 
-	/* Send probes scheduled to this time. */
-	do {
-		next = pinger(rts, fset, sock);
-		next = schedule_exit(rts, next);
-	} while (next <= 0);
+/*
+ * ping_recv_batch_init --
+ *	Allocate the receive buffers once setup_data->packlen is final and
+ * point every slot of the recvmmsg() batch at its own part of them.
+ */
+void ping_recv_batch_init(ping_setup_data *setup_data)
+{
+	struct ping_recv_batch *batch;
+	int i;
 
-	/* "next" is time to send next probe, if positive.
-	 * If next<=0 send now or as soon as possible. */
-
-	/* Technical part. Looks wicked. Could be dropped,
-	 * if everyone used the newest kernel. :-)
-	 * Its purpose is:
-	 * 1. Provide intervals less than resolution of scheduler.
-	 *    Solution: spinning.
-	 * 2. Avoid use of poll(), when recvmsg() can provide
-	 *    timed waiting (SO_RCVTIMEO). */
-	polling = 0;
-	recv_error = 0;
-	if (rts->opt_adaptive || rts->opt_flood_poll || next < SCHINT(rts->interval)) {
-		int recv_expected = in_flight(rts);
-
-		/* If we are here, recvmsg() is unable to wait for
-		 * required timeout. */
-		if (1000 % HZ == 0 ? next <= 1000 / HZ : (next < INT_MAX / HZ && next * HZ <= 1000)) {
-			/* Very short timeout... So, if we wait for
-			 * something, we sleep for MININTERVAL.
-			 * Otherwise, spin! */
-			if (recv_expected) {
-				next = MININTERVAL;
-			} else {
-				next = 0;
-				/* When spinning, no reasons to poll.
-				 * Use nonblocking recvmsg() instead. */
-				polling = MSG_DONTWAIT;
-				/* But yield yet. */
-				sched_yield();
-			}
-		}
+	setup_data->packet = malloc((size_t)setup_data->packlen * PING_RECV_BATCH);
+	batch = calloc(1, sizeof(*batch));
+	if (!setup_data->packet || !batch)
+		error(2, errno, _("memory allocation failed"));
 
-		if (!polling && (rts->opt_adaptive || rts->opt_flood_poll || rts->interval)) {
-			struct pollfd pset;
-			pset.fd = sock->fd;
-			pset.events = POLLIN;
-			pset.revents = 0;
-			if (poll(&pset, 1, next) < 1 || !(pset.revents & (POLLIN | POLLERR)))
-				return !rts->nreceived || rts->deadline;
-			polling = MSG_DONTWAIT;
-			recv_error = pset.revents & POLLERR;
-		}
+	for (i = 0; i < PING_RECV_BATCH; i++) {
+		struct msghdr *msg = &batch->msgs[i].msg_hdr;
+
+		batch->iov[i].iov_base = setup_data->packet + (size_t)i * setup_data->packlen;
+		batch->iov[i].iov_len = setup_data->packlen;
+		msg->msg_iov = &batch->iov[i];
+		msg->msg_iovlen = 1;
+		msg->msg_name = &batch->addrs[i];
+		msg->msg_control = batch->control[i];
+	}
+	setup_data->recv = batch;
+}
+
+/*
+ * ping_clock_skew --
+ *	CLOCK_REALTIME minus CLOCK_MONOTONIC, in nsec.  Kernel timestamps are
+ * taken on the former and are moved onto the latter with this, so that a
+ * step of the wall clock can only disturb probes in flight at that very
+ * moment.
+ */
+long long ping_clock_skew(void)
+{
+	struct timespec real, mono;
+
+	clock_gettime(CLOCK_REALTIME, &real);
+	clock_gettime(CLOCK_MONOTONIC, &mono);
+	return tsdiff(&real, &mono);
+}
+
+/*
+ * ping_recv_timestamp --
+ *	Put the kernel receive timestamp of a reply, on CLOCK_MONOTONIC, into
+ * "ts".  Returns 0 if there is none.
+ */
+int ping_recv_timestamp(struct msghdr *msg, long long skew, struct timespec *ts)
+{
+	int found = 0;
+
+#ifdef SO_TIMESTAMPNS
+	struct cmsghdr *c;
+
+	for (c = CMSG_FIRSTHDR(msg); c; c = CMSG_NXTHDR(msg, c)) {
+		if (c->cmsg_level != SOL_SOCKET || c->cmsg_type != SCM_TIMESTAMPNS)
+			continue;
+		if (c->cmsg_len < CMSG_LEN(sizeof(struct timespec)))
+			continue;
+		memcpy(ts, CMSG_DATA(c), sizeof(*ts));
+		found = 1;
+	}
+	if (found)
+		ts_add(ts, -skew);
+#endif
+	return found;
+}
+
+/*
+ * ping_receive --
+ *	Drain everything queued on one socket, up to PING_RECV_BATCH replies
+ * per recvmmsg() call.  Replies are handed to the parse_reply hook of the
+ * socket family, which finds the target they belong to.
+ */
+void ping_receive(ping_setup_data *setup_data, socket_st *sock, int recv_error)
+{
+	ping_func_set_st *fset = sock == setup_data->sock4 ? &ping4_func_set : &ping6_func_set;
+	struct ping_rts *rts = setup_data->targets.list[0];
+	struct ping_recv_batch *batch = setup_data->recv;
+	int cc, i;
+
+	/* The replies are io_uring's to take, racing it for them would lose
+	 * some: only the error queue is left to read here. */
+	if (sock->uring) {
+		if (recv_error)
+			fset->receive_error_msg(rts, sock);
+		return;
 	}
 
 	for (;;) {
-		struct timeval *recv_timep = NULL;
-		struct timeval recv_time;
+		struct timespec recv_time;
+		int have_recv_time = 0;
+		long long skew = ping_clock_skew();
 		int not_ours = 0; /* Raw socket can receive messages
 				   			* destined to other running pings. */
 
-		iov.iov_len = packlen;
-		memset(&msg, 0, sizeof(msg));
-		msg.msg_name = addrbuf;
-		msg.msg_namelen = sizeof(addrbuf);
-		msg.msg_iov = &iov;
-		msg.msg_iovlen = 1;
-		msg.msg_control = ans_data;
-		msg.msg_controllen = sizeof(ans_data);
+		for (i = 0; i < PING_RECV_BATCH; i++) {
+			struct msghdr *msg = &batch->msgs[i].msg_hdr;
+
+			msg->msg_namelen = sizeof(batch->addrs[i]);
+			msg->msg_controllen = sizeof(batch->control[i]);
+			msg->msg_flags = 0;
+		}
 
-		cc = recvmsg(sock->fd, &msg, polling);
-		polling = MSG_DONTWAIT;
+		cc = recvmmsg(sock->fd, batch->msgs, PING_RECV_BATCH, MSG_DONTWAIT, NULL);
 
 		if (cc < 0) {
 			/* If there was a POLLERR and there is no packet
@@ -627,98 +912,315 @@ int main_ping(struct ping_rts *rts, ping_func_set_st *fset, socket_st *sock,
 				break;
 			recv_error = 0;
 			if (!fset->receive_error_msg(rts, sock)) {
+				/* Nothing but -k timestamps were queued. */
+				if (errno == EAGAIN)
+					break;
 				if (errno) {
-					error(0, errno, "recvmsg");
+					error(0, errno, "recvmmsg");
 					break;
 				}
 				not_ours = 1;
 			}
+		}
 
-		} else {
-
-#ifdef SO_TIMESTAMP
-			struct cmsghdr *c;
-
-			for (c = CMSG_FIRSTHDR(&msg); c; c = CMSG_NXTHDR(&msg, c)) {
-				if (c->cmsg_level != SOL_SOCKET || c->cmsg_type != SO_TIMESTAMP)
-					continue;
-				if (c->cmsg_len < CMSG_LEN(sizeof(struct timeval)))
-					continue;
-				recv_timep = (struct timeval *)CMSG_DATA(c);
-			}
-#endif
-
-			if (rts->opt_latency || recv_timep == NULL) {
-				if (rts->opt_latency ||
-				    ioctl(sock->fd, SIOCGSTAMP, &recv_time))
-					gettimeofday(&recv_time, NULL);
+		for (i = 0; i < cc; i++) {
+			struct msghdr *msg = &batch->msgs[i].msg_hdr;
+			struct timespec stamp;
+			struct timespec *recv_timep = &stamp;
+
+			if (rts->opt_latency || !ping_recv_timestamp(msg, skew, &stamp)) {
+				/* SIOCGSTAMPNS only knows the last packet read, so
+				 * the whole batch shares one fallback stamp. */
+				if (!have_recv_time) {
+					if (!rts->opt_latency &&
+					    !ioctl(sock->fd, SIOCGSTAMPNS, &recv_time))
+						ts_add(&recv_time, -skew);
+					else
+						clock_gettime(CLOCK_MONOTONIC, &recv_time);
+				}
+				have_recv_time = 1;
 				recv_timep = &recv_time;
 			}
 
-			not_ours = fset->parse_reply(rts, sock, &msg, cc, addrbuf, recv_timep);
+			not_ours |= fset->parse_reply(rts, sock, msg, batch->msgs[i].msg_len,
+						      msg->msg_name, recv_timep);
 		}
 
 		/* See? ... someone runs another ping on this host. */
 		if (not_ours && sock->socktype == SOCK_RAW)
 			fset->install_filter(rts, sock);
 
-		/* If nothing is in flight, "break" returns us to pinger. */
-		if (in_flight(rts) == 0)
+		/* A short batch means the queue is empty.  Go round once
+		 * more only if the error queue still needs reading. */
+		if (cc >= 0 && cc < PING_RECV_BATCH && !recv_error)
 			break;
+	}
+}
+
+/*
+ * ping_run_timers --
+ *	Run what is due on the timer wheel and arm the timerfd for what is
+ * next.  With "early" set the tick in progress is run as well, even if the
+ * clock has not reached it yet: replies pull the send timer of flood and
+ * adaptive ping to that tick, and waiting for it would cap them at one
+ * round trip per msec.
+ */
+static void ping_run_timers(ping_setup_data *setup_data, int early)
+{
+	struct timer_wheel *wheel = &setup_data->wheel;
+	uint64_t now = timer_wheel_clock();
+	uint64_t next;
+	int i;
+
+	/* Check for and do special actions. */
+	if (global_rts->status_snapshot) {
+		for (i = 0; i < setup_data->targets.count; i++)
+			status(setup_data->targets.list[i]);
+		global_rts->status_snapshot = 0;
+	}
 
-		/* Otherwise, try to recvmsg() again. recvmsg()
-		 * is nonblocking after the first iteration, so that
-		 * if nothing is queued, it will receive EAGAIN
-		 * and return to pinger. */
+	if (now < wheel->now)
+		now = wheel->now;
+	timer_wheel_run(wheel, now);
+	/* A send timer put back to right now by a reply would otherwise wait
+	 * for the next tick; running that tick early instead would get the
+	 * wheel ahead of the clock, and every other timer with it. */
+	if (early) {
+		for (i = 0; i < setup_data->targets.count; i++) {
+			struct timer_entry *timer = &setup_data->targets.list[i]->send_timer;
+
+			if (timer_pending(timer) && timer->expires <= now) {
+				timer_del(wheel, timer);
+				timer->handler(timer);
+			}
+		}
 	}
-	finish(rts);
-	return !rts->nreceived || rts->deadline;
+	if (setup_data->uring)
+		ping_uring_submit(setup_data->uring);
+
+	next = timer_wheel_next(wheel);
+	if (next == setup_data->wheel_armed)
+		return;
+	setup_data->wheel_armed = next;
+	if (next == UINT64_MAX)
+		event_timer_disarm(&setup_data->wheel_timer);
+	else
+		event_timer_arm(&setup_data->wheel_timer, next - wheel->now, 0);
+}
+
+static void ping_wheel_event(event_source *source, uint32_t events __attribute__((__unused__)))
+{
+	ping_setup_data *setup_data = source->data;
+
+	event_timer_read(source);
+	setup_data->wheel_armed = UINT64_MAX;
+	ping_run_timers(setup_data, 0);
+}
+
+/* Replies came in: the next probes may be due earlier now. */
+void ping_reschedule(ping_setup_data *setup_data)
+{
+	ping_run_timers(setup_data, 1);
+}
+
+/* The send timer of a target: send what is due and wait for the next. */
+static void ping_send_timer(struct timer_entry *timer)
+{
+	struct ping_rts *rts = timer->data;
+	int next;
+
+	if (global_rts->exiting || (rts->deadline && rts->nerrors))
+		return;
+
+	/* Send probes scheduled to this time. */
+	do {
+		next = pinger(rts, rts->fset, rts->sock);
+	} while (next <= 0);
+
+	timer_add(rts->wheel, timer, rts->wheel->now + next);
+}
+
+/* -w: stop probing, replies are still taken in. */
+static void ping_deadline(struct timer_entry *timer)
+{
+	ping_setup_data *setup_data = timer->data;
+	int i;
+
+	global_rts->exiting = 1;
+	for (i = 0; i < setup_data->targets.count; i++)
+		timer_del(&setup_data->wheel, &setup_data->targets.list[i]->send_timer);
+}
+
+static void ping_socket_event(event_source *source, uint32_t events)
+{
+	ping_setup_data *setup_data = source->data;
+	socket_st *sock = source == &setup_data->sock4_event ? setup_data->sock4 : setup_data->sock6;
+
+	ping_receive(setup_data, sock, events & EPOLLERR);
+
+	/* A reply may allow the next probe to go out earlier, as with
+	 * flood and adaptive ping. */
+	ping_reschedule(setup_data);
+}
+
+/*
+ * ping_timers_init --
+ *	Put the send timer of every target on the wheel, due right away, and
+ * give each target a ring of reply timeouts large enough for the probes
+ * it can have outstanding within the linger time, at the shortest interval
+ * -A may go down to.  probe_sent() grows it should that not do.
+ */
+static void ping_timers_init(ping_setup_data *setup_data)
+{
+	struct timer_wheel *wheel = &setup_data->wheel;
+	uint64_t now = timer_wheel_clock();
+	int i;
+
+	timer_wheel_init(wheel, now);
+
+	for (i = 0; i < setup_data->targets.count; i++) {
+		struct ping_rts *rts = setup_data->targets.list[i];
+		long interval = rts->opt_adaptive ? (rts->uid ? MINUSERINTERVAL : MININTERVAL) :
+				rts->interval;
+		long slots = rts->lingertime / SCHINT(interval) + rts->preload + 1;
+		unsigned int size;
+		unsigned int j;
+
+		for (size = 16; size < slots && size < MAX_DUP_CHK; size <<= 1)
+			;
+		rts->timeouts = calloc(size, sizeof(*rts->timeouts));
+		if (!rts->timeouts)
+			error(2, errno, _("memory allocation failed"));
+		rts->timeout_mask = size - 1;
+		for (j = 0; j < size; j++)
+			timer_init(&rts->timeouts[j].timer, ping_reply_timeout, rts);
+
+		rts->wheel = wheel;
+		timer_init(&rts->send_timer, ping_send_timer, rts);
+		timer_add(wheel, &rts->send_timer, now);
+		ping_resolve_init(setup_data, rts, now);
+	}
+
+	ping_log_start(setup_data, now);
+	ping_shm_start(setup_data);
+
+	if (global_rts->deadline) {
+		timer_init(&setup_data->deadline_timer, ping_deadline, setup_data);
+		timer_add(wheel, &setup_data->deadline_timer, now + global_rts->deadline * 1000ULL);
+	}
+}
+
+/*
+ * ping_thread_start --
+ *	Run "fn" with "arg" on a detached thread, which leaves all signals to
+ * the calling one.  Returns 0, or the error of pthread_create().
+ */
+int ping_thread_start(void *(*fn)(void *), void *arg)
+{
+	pthread_t thread;
+	sigset_t all, old;
+	int ret;
+
+	sigfillset(&all);
+	pthread_sigmask(SIG_SETMASK, &all, &old);
+	ret = pthread_create(&thread, NULL, fn, arg);
+	pthread_sigmask(SIG_SETMASK, &old, NULL);
+	if (!ret)
+		pthread_detach(thread);
+	return ret;
+}
+
+/*
+ * ping_socket_register --
+ *	Watch "sock" on the event loop, unless it already is.  Sockets served
+ * by io_uring are only watched for EPOLLERR, to read their error queue.
+ */
+void ping_socket_register(ping_setup_data *setup_data, socket_st *sock)
+{
+	event_source *source = sock == setup_data->sock4 ? &setup_data->sock4_event :
+							   &setup_data->sock6_event;
+
+	if (source->handler)
+		return;
+	source->fd = sock->fd;
+	source->handler = ping_socket_event;
+	source->data = setup_data;
+	event_add(setup_data->epfd, source, sock->uring ? 0 : EPOLLIN);
+}
+
+/*
+ * ping_register_events --
+ *	Add the sockets, the timer wheel and the -E listener to the event
+ * loop "epfd" and send the first probes.
+ */
+void ping_register_events(ping_setup_data *setup_data, int epfd)
+{
+	socket_st *sock4 = setup_data->sock4;
+	socket_st *sock6 = setup_data->sock6;
+
+	setup_data->epfd = epfd;
+
+	if (sock4->fd != -1 && sock4->ntargets)
+		ping_socket_register(setup_data, sock4);
+	if (sock6->fd != -1 && sock6->ntargets)
+		ping_socket_register(setup_data, sock6);
+	if (setup_data->uring)
+		ping_uring_register(setup_data, epfd);
+
+	ping_timers_init(setup_data);
+	event_timer_init(&setup_data->wheel_timer, ping_wheel_event, setup_data);
+	event_add(epfd, &setup_data->wheel_timer, EPOLLIN);
+	setup_data->wheel_armed = UINT64_MAX;
+	ping_metrics_register(setup_data, epfd);
+	ping_run_timers(setup_data, 0);
 }
 
 int gather_statistics(struct ping_rts *rts, uint8_t *icmph, int icmplen,
 		      int cc, uint16_t seq, int hops,
-		      int csfailed, struct timeval *tv, char *from,
-		      void (*pr_reply)(uint8_t *icmph, int cc), int multicast)
+		      int csfailed, struct timespec *ts, char *from,
+		      void (*pr_reply)(struct ping_rts *rts, uint8_t *icmph, int cc), int multicast)
 {
 	int dupflag = 0;
-	long triptime = 0;
+	long long triptime = 0;
+	long long windowed = -1;
+	int settled = 0;
+	int payload_checked = rts->payload_checked;
 	uint8_t *ptr = icmph + icmplen;
+	long long sent_ns = -1;
+
+	rts->payload_checked = 0;
 
+	rts->changes++;
 	++rts->nreceived;
-	if (!csfailed)
+	if (!csfailed) {
 		acknowledge(rts, seq);
+		settled = probe_answered(rts, seq);
+	}
 
-	if (rts->timing && cc >= (int)(8 + sizeof(struct timeval))) {
-		struct timeval tmp_tv;
-		memcpy(&tmp_tv, ptr, sizeof(tmp_tv));
+	if (rts->timing && cc >= (int)(8 + sizeof(struct timespec))) {
+		struct timespec sent;
+		memcpy(&sent, ptr, sizeof(sent));
+		if (rts->sock->tx_slots)
+			kernel_send_time(rts, seq, &sent);
 
-restamp:
-		tvsub(tv, &tmp_tv);
-		triptime = tv->tv_sec * 1000000 + tv->tv_usec;
-		if (triptime < 0) {
-			error(0, 0, _("Warning: time of day goes back (%ldus), taking countermeasures"), triptime);
+		/* Both ends are on CLOCK_MONOTONIC; only the mapping of
+		 * kernel stamps onto it can be off, by a hair. */
+		triptime = tsdiff(ts, &sent);
+		if (triptime < 0)
 			triptime = 0;
-			if (!rts->opt_latency) {
-				gettimeofday(tv, NULL);
-				rts->opt_latency = 1;
-				goto restamp;
-			}
-		}
+		sent_ns = sent.tv_sec * 1000000000LL + sent.tv_nsec;
 		if (!csfailed) {
-			rts->tsum += triptime;
-			rts->tsum2 += (double)((long long)triptime * (long long)triptime);
-			if (triptime < rts->tmin)
-				rts->tmin = triptime;
-			if (triptime > rts->tmax)
-				rts->tmax = triptime;
-			if (!rts->rtt)
-				rts->rtt = triptime * 8;
-			else
-				rts->rtt += triptime - rts->rtt / 8;
+			ping_stats_add(&rts->stats, triptime);
+			if (!rts->hist)
+				rts->hist = ping_hist_alloc();
+			ping_hist_record(rts->hist, triptime);
 			if (rts->opt_adaptive)
 				update_interval(rts);
+			windowed = triptime;
 		}
 	}
+	if (settled)
+		ping_windows_reply(windows_of(rts), rts->wheel->now / 1000, windowed);
 
 	if (csfailed) {
 		++rts->nchecksum;
@@ -730,9 +1232,22 @@ restamp:
 	} else {
 		rcvd_set(rts, seq);
 		dupflag = 0;
+		ping_jitter_reply(&rts->jitter, seq, windowed);
+		ping_loss_reply(rts);
 	}
 	rts->confirm = rts->confirm_flag;
 
+	if (sent_ns < 0)
+		ping_log_add(rts, csfailed ? PING_LOG_CKSUM : dupflag ? PING_LOG_DUP : PING_LOG_REPLY,
+			     seq, ts->tv_sec * 1000000000LL + ts->tv_nsec, -1, hops);
+	else
+		ping_log_add(rts, csfailed ? PING_LOG_CKSUM : dupflag ? PING_LOG_DUP : PING_LOG_REPLY,
+			     seq, sent_ns, triptime, hops);
+	ping_shm_update(rts, windowed);
+
+	if (rts->output && !csfailed)
+		ping_output_reply(rts, seq, cc, hops, windowed, from, dupflag);
+
 	if (rts->opt_quiet)
 		return 1;
 
@@ -743,89 +1258,117 @@ restamp:
 			write_stdout("\bC", 2);
 	} else {
 		size_t i;
-		uint8_t *cp, *dp;
+		uint8_t *cp;
 
 		print_timestamp(rts);
-		printw(_("%d bytes from %s:"), cc, from);
+		ping_printf(rts, _("%d bytes from %s:"), cc, from);
 
 		if (pr_reply)
-			pr_reply(icmph, cc);
+			pr_reply(rts, icmph, cc);
 
 		if (hops >= 0)
-			printw(_(" ttl=%d"), hops);
+			ping_printf(rts, _(" ttl=%d"), hops);
 
 		if ((size_t)cc < rts->datalen + 8) {
-			printw(_(" (truncated)\n"));
+			ping_printf(rts, _(" (truncated)\n"));
 			return 1;
 		}
-		if (rts->timing) {
-			printw(" time=");
+		if (rts->timing && rts->opt_nsec) {
+			ping_printf(rts, " time=");
+			ping_set_color(rts, ping_color(triptime / 1000000));
+			ping_printf(rts, _("%lld.%06lld ms"), triptime / 1000000, triptime % 1000000);
+			ping_set_color(rts, NORMAL_COLOR_INDEX);
+		} else if (rts->timing) {
+			ping_printf(rts, " time=");
 			long timeWhole = 0;
 			long timeDecimal = 0;
 
+			/* Rounded as before nsec were kept, to 3 digits. */
+			triptime /= 1000;
 			if (triptime >= 100000 - 50) {
 				timeWhole = (triptime + 500) / 1000;
-				set_ping_color(timeWhole);
-				printw(_("%ld ms"), timeWhole);
+				ping_set_color(rts, ping_color(timeWhole));
+				ping_printf(rts, _("%ld ms"), timeWhole);
 			} else if (triptime >= 10000 - 5) {
 				timeWhole = (triptime + 50) / 1000;
 				timeDecimal = ((triptime + 50) % 1000) / 100;
-				set_ping_color(timeWhole);
-				printw(_("%ld.%01ld ms"), timeWhole,
+				ping_set_color(rts, ping_color(timeWhole));
+				ping_printf(rts, _("%ld.%01ld ms"), timeWhole,
 				       timeDecimal);
 			} else if (triptime >= 1000) {
 				timeWhole = (triptime + 5) / 1000;
 				timeDecimal = ((triptime + 5) % 1000) / 10;
-				set_ping_color(timeWhole);
-				printw(_("%ld.%02ld ms"), timeWhole,
+				ping_set_color(rts, ping_color(timeWhole));
+				ping_printf(rts, _("%ld.%02ld ms"), timeWhole,
 				       timeDecimal);
 			} else {
 				timeWhole = triptime / 1000;
 				timeDecimal = triptime % 1000;
-				set_ping_color(timeWhole);
-				printw(_("%ld.%03ld ms"), timeWhole,
+				ping_set_color(rts, ping_color(timeWhole));
+				ping_printf(rts, _("%ld.%03ld ms"), timeWhole,
 				       timeDecimal);
 			}
-			set_color(NORMAL_COLOR_INDEX);
+			ping_set_color(rts, NORMAL_COLOR_INDEX);
 		}
 		if (dupflag && (!multicast || rts->opt_verbose))
-			printw(_(" (DUP!)"));
+			ping_printf(rts, _(" (DUP!)"));
 		if (csfailed)
-			printw(_(" (BAD CHECKSUM!)"));
+			ping_printf(rts, _(" (BAD CHECKSUM!)"));
 
 		/* check the data */
-		cp = ((unsigned char *)ptr) + sizeof(struct timeval);
-		dp = &rts->outpack[8 + sizeof(struct timeval)];
-		for (i = sizeof(struct timeval); i < rts->datalen; ++i, ++cp, ++dp) {
-			if (*cp != *dp) {
-				printw(_("\nwrong data byte #%zu should be 0x%x but was 0x%x"),
-				       i, *dp, *cp);
-				cp = (unsigned char *)ptr + sizeof(struct timeval);
-				for (i = sizeof(struct timeval); i < rts->datalen; ++i, ++cp) {
-					if ((i % 32) == sizeof(struct timeval))
-						printw("\n#%zu\t", i);
-					printw("%x ", *cp);
-				}
-				break;
+		i = payload_checked ? 0 : payload_mismatch(rts, ptr);
+		if (i) {
+			ping_printf(rts, _("\nwrong data byte #%zu should be 0x%x but was 0x%x"),
+			       i, rts->outpack[8 + i], ptr[i]);
+			cp = (unsigned char *)ptr + sizeof(struct timespec);
+			for (i = sizeof(struct timespec); i < rts->datalen; ++i, ++cp) {
+				if ((i % 32) == sizeof(struct timespec))
+					ping_printf(rts, "\n#%zu\t", i);
+				ping_printf(rts, "%x ", *cp);
 			}
 		}
 	}
 	return 0;
 }
 
-static long llsqrt(long long a)
+/*
+ * format_msec --
+ *	Put "ns" into "buf" as msec, to the usec or, with -e, to the nsec.
+ */
+static char *format_msec(struct ping_rts *rts, long long ns, char *buf, size_t len)
+{
+	const char *sign = ns < 0 ? "-" : "";
+
+	if (ns < 0)
+		ns = -ns;
+	if (rts->opt_nsec)
+		snprintf(buf, len, "%s%lld.%06lld", sign, ns / 1000000, ns % 1000000);
+	else
+		snprintf(buf, len, "%s%lld.%03lld", sign, ns / 1000000, ns / 1000 % 1000);
+	return buf;
+}
+
+/* Wall clock time of day of wheel time "msec", as HH:MM:SS.mmm. */
+static char *format_wheel_time(long long msec, char *buf, size_t len)
 {
-	long long prev = LLONG_MAX;
-	long long x = a;
+	static long long offset = LLONG_MIN;
+	struct tm tm;
+	time_t sec;
+	size_t n;
 
-	if (x > 0) {
-		while (x < prev) {
-			prev = x;
-			x = (x + (a / x)) / 2;
-		}
-	}
+	/* Taken once, so that redraws do not wobble by a msec. */
+	if (offset == LLONG_MIN) {
+		struct timespec now;
 
-	return (long)x;
+		clock_gettime(CLOCK_REALTIME, &now);
+		offset = now.tv_sec * 1000LL + now.tv_nsec / 1000000 - (long long)timer_wheel_clock();
+	}
+	msec += offset;
+	sec = msec / 1000;
+	localtime_r(&sec, &tm);
+	n = strftime(buf, len, "%H:%M:%S", &tm);
+	snprintf(buf + n, len - n, ".%03lld", msec % 1000);
+	return buf;
 }
 
 /*
@@ -834,11 +1377,9 @@ static long llsqrt(long long a)
  */
 int finish(struct ping_rts *rts)
 {
-	struct timeval tv = rts->cur_time;
+	long long elapsed = tsdiff(&rts->cur_time, &rts->start_time);
 	char *comma = "";
 
-	tvsub(&tv, &rts->start_time);
-
 	printw("\n");
 	printw(_("--- %s ping statistics ---\n"), rts->hostname);
 	printw(_("%ld packets transmitted, "), rts->ntransmitted);
@@ -855,55 +1396,36 @@ int finish(struct ping_rts *rts)
 		setlocale(LC_ALL, "C");
 #endif
 		printw(", ");
-		float packet_loss = (float)((((long long)(rts->ntransmitted - rts->nreceived)) * 100.0) / rts->ntransmitted);
-		set_packet_loss_color(packet_loss);
-		printw("%g%%", packet_loss);
+		float loss = packet_loss(rts);
+		set_packet_loss_color(loss);
+		printw("%g%%", loss);
 		set_color(NORMAL_COLOR_INDEX);
 		printw(" packet loss");
-		printw(_(", time %ldms"), 1000 * tv.tv_sec + (tv.tv_usec + 500) / 1000);
+		printw(_(", time %lldms"), (elapsed + 500000) / 1000000);
 	}
 
 	printw("\n");
 
 	if (rts->nreceived && rts->timing) {
-		double tmdev;
-		long total = rts->nreceived + rts->nrepeats;
-		long tmavg = rts->tsum / total;
-		long long tmvar;
-
-		if (rts->tsum < INT_MAX)
-			/* This slightly clumsy computation order is important to avoid
-			 * integer rounding errors for small ping times. */
-			tmvar = (rts->tsum2 - ((rts->tsum * rts->tsum) / total)) / total;
-		else
-			tmvar = (rts->tsum2 / total) - (tmavg * tmavg);
-
-		tmdev = llsqrt(tmvar);
-
-		long min_whole = (long)rts->tmin / 1000;
-		long min_decimal = (long)rts->tmin % 1000;
-		unsigned long avg_whole = (unsigned long)(tmavg / 1000);
-		long avg_decimal = (long)(tmavg % 1000);
-		long max_whole = (long)rts->tmax / 1000;
-		long max_decimal = (long)rts->tmax % 1000;
-		long mdev_whole = (long)tmdev / 1000;
-		long mdev_decimal = (long)tmdev % 1000;
+		long long tmavg = ping_stats_mean(&rts->stats);
+		long long tmdev = ping_stats_mdev(&rts->stats);
+		char buf[32];
 
 		printw("rtt min/avg/max/mdev = ");
-		set_ping_color(min_whole);
-		printw("%ld.%03ld", min_whole, min_decimal);
+		set_ping_color(rts->stats.min / 1000000);
+		printw("%s", format_msec(rts, rts->stats.min, buf, sizeof(buf)));
 		set_color(NORMAL_COLOR_INDEX);
 		printw("/");
-		set_ping_color(avg_whole);
-		printw("%lu.%03ld", avg_whole, avg_decimal);
+		set_ping_color(tmavg / 1000000);
+		printw("%s", format_msec(rts, tmavg, buf, sizeof(buf)));
 		set_color(NORMAL_COLOR_INDEX);
 		printw("/");
-		set_ping_color(max_whole);
-		printw("%ld.%03ld", max_whole, max_decimal);
+		set_ping_color(rts->stats.max / 1000000);
+		printw("%s", format_msec(rts, rts->stats.max, buf, sizeof(buf)));
 		set_color(NORMAL_COLOR_INDEX);
 		printw("/");
-		set_deviation_color(mdev_whole);
-		printw("%ld.%03ld", mdev_whole, mdev_decimal);
+		set_deviation_color(tmdev / 1000000);
+		printw("%s", format_msec(rts, tmdev, buf, sizeof(buf)));
 		set_color(NORMAL_COLOR_INDEX);
 		printw(" ms");
 
@@ -915,40 +1437,298 @@ int finish(struct ping_rts *rts)
 	}
 
 	if (rts->nreceived && (!rts->interval || rts->opt_flood || rts->opt_adaptive) && rts->ntransmitted > 1) {
-		int ipg = (1000000 * (long long)tv.tv_sec + tv.tv_usec) / (rts->ntransmitted - 1);
+		long long ipg = elapsed / (rts->ntransmitted - 1);
+		char ipg_buf[32], ewma_buf[32];
 
-		printw(_("%sipg/ewma %d.%03d/%d.%03d ms"),
-		       comma, ipg / 1000, ipg % 1000, rts->rtt / 8000, (rts->rtt / 8) % 1000);
+		printw(_("%sipg/ewma %s/%s ms"), comma,
+		       format_msec(rts, ipg, ipg_buf, sizeof(ipg_buf)),
+		       format_msec(rts, ping_stats_ewma(&rts->stats), ewma_buf, sizeof(ewma_buf)));
 	}
 	printw("\n");
+
+	if (rts->hist) {
+		char p50[32], p90[32], p99[32], p999[32];
+
+		printw(_("rtt p50/p90/p99/p99.9 = %s/%s/%s/%s ms\n"),
+		       format_msec(rts, ping_hist_percentile(rts->hist, 50), p50, sizeof(p50)),
+		       format_msec(rts, ping_hist_percentile(rts->hist, 90), p90, sizeof(p90)),
+		       format_msec(rts, ping_hist_percentile(rts->hist, 99), p99, sizeof(p99)),
+		       format_msec(rts, ping_hist_percentile(rts->hist, 99.9), p999, sizeof(p999)));
+	}
+
+	if (rts->jitter.ipdv || rts->jitter.reordered) {
+		comma = "";
+		if (rts->jitter.ipdv) {
+			char jit[32], p50[32], p99[32], min[32], max[32];
+
+			printw(_("jitter %s ms, ipdv p50/p99 = %s/%s ms, min/max = %s/%s ms"),
+			       format_msec(rts, ping_jitter_value(&rts->jitter), jit, sizeof(jit)),
+			       format_msec(rts, ping_hist_percentile(rts->jitter.ipdv, 50), p50, sizeof(p50)),
+			       format_msec(rts, ping_hist_percentile(rts->jitter.ipdv, 99), p99, sizeof(p99)),
+			       format_msec(rts, rts->jitter.ipdv_min, min, sizeof(min)),
+			       format_msec(rts, rts->jitter.ipdv_max, max, sizeof(max)));
+			comma = ", ";
+		}
+		printw(_("%s%llu reordered"), comma, rts->jitter.reordered);
+		if (rts->jitter.reordered)
+			printw(_(" (max extent %d)"), rts->jitter.reorder_max);
+		printw("\n");
+	}
+
+	if (rts->loss.nlost) {
+		struct ping_loss *loss = &rts->loss;
+		char from[32], to[32];
+		unsigned int b;
+
+		printw(_("loss runs"));
+		for (b = 0; b < PING_LOSS_BUCKETS; b++) {
+			unsigned long long n = loss->runs[b];
+
+			/* An outage still going on counts as it is so far. */
+			if (loss->run && ping_loss_bucket(loss->run) == b)
+				n++;
+			if (!n)
+				continue;
+			if (b == 0)
+				printw(" 1:%llu", n);
+			else if (b == PING_LOSS_BUCKETS - 1)
+				printw(" %lu+:%llu", 1UL << b, n);
+			else
+				printw(" %lu-%lu:%llu", 1UL << b, (2UL << b) - 1, n);
+		}
+		printw(_(", longest %ld (%s - %s)"), loss->longest,
+		       format_wheel_time(loss->longest_start, from, sizeof(from)),
+		       format_wheel_time(loss->longest_end, to, sizeof(to)));
+		if (loss->from_good && loss->from_bad)
+			printw(_(", gilbert p/r = %.2f%%/%.2f%%"),
+			       loss->good_bad * 100.0 / loss->from_good,
+			       loss->bad_good * 100.0 / loss->from_bad);
+		printw("\n");
+	}
+
+	if (rts->windows) {
+		long long now = timer_wheel_clock() / 1000;
+		struct ping_window_stats ws;
+		int i;
+
+		for (i = 0; i < PING_WINDOWS; i++) {
+			char min[32], avg[32], max[32], p99[32];
+
+			if (!ping_window_stats(rts->windows, i, now, &ws))
+				continue;
+			printw(_("last %s: %u/%u received, "), ws.name, ws.received, ws.received + ws.lost);
+			set_packet_loss_color(ws.loss);
+			printw("%g%%", ws.loss);
+			set_color(NORMAL_COLOR_INDEX);
+			printw(_(" loss"));
+			if (ws.timed)
+				printw(_(", rtt min/avg/max/p99 = %s/%s/%s/%s ms"),
+				       format_msec(rts, ws.min, min, sizeof(min)),
+				       format_msec(rts, ws.avg, avg, sizeof(avg)),
+				       format_msec(rts, ws.max, max, sizeof(max)),
+				       format_msec(rts, ws.p99, p99, sizeof(p99)));
+			printw("\n");
+		}
+	}
+
+	if (rts->nsdelay) {
+		char avg[32], max[32];
+
+		printw(_("send delay avg/max = %s/%s ms\n"),
+		       format_msec(rts, rts->sdelay_sum / rts->nsdelay, avg, sizeof(avg)),
+		       format_msec(rts, rts->sdelay_max, max, sizeof(max)));
+	}
 	printw("\n");
 	return !rts->nreceived || rts->deadline;
 }
 
 void status(struct ping_rts *rts)
 {
-	int loss = 0;
-	long tavg = 0;
+	int loss;
 
 	rts->status_snapshot = 0;
 
-	if (rts->ntransmitted)
-		loss = (((long long)(rts->ntransmitted - rts->nreceived)) * 100) / rts->ntransmitted;
+	loss = packet_loss(rts);
+
+	ping_printf(rts, "\r");
+	ping_printf(rts, _("%ld/%ld packets, %d%% loss"), rts->nreceived, rts->ntransmitted, loss);
+
+	if (rts->nreceived && rts->timing) {
+		long long tavg = ping_stats_mean(&rts->stats);
+		char min[32], avg[32], ewma[32], max[32];
+
+		ping_printf(rts, _(", min/avg/ewma/max = %s/%s/%s/%s ms"),
+			format_msec(rts, rts->stats.min, min, sizeof(min)),
+			format_msec(rts, tavg, avg, sizeof(avg)),
+			format_msec(rts, ping_stats_ewma(&rts->stats), ewma, sizeof(ewma)),
+			format_msec(rts, rts->stats.max, max, sizeof(max)));
+	}
+	if (rts->hist) {
+		char p50[32], p90[32], p99[32], p999[32];
+
+		ping_printf(rts, _(", p50/p90/p99/p99.9 = %s/%s/%s/%s ms"),
+			format_msec(rts, ping_hist_percentile(rts->hist, 50), p50, sizeof(p50)),
+			format_msec(rts, ping_hist_percentile(rts->hist, 90), p90, sizeof(p90)),
+			format_msec(rts, ping_hist_percentile(rts->hist, 99), p99, sizeof(p99)),
+			format_msec(rts, ping_hist_percentile(rts->hist, 99.9), p999, sizeof(p999)));
+	}
+	if (rts->nsdelay) {
+		char delay[32];
+
+		ping_printf(rts, _(", send delay %s ms"),
+			format_msec(rts, rts->sdelay_sum / rts->nsdelay, delay, sizeof(delay)));
+	}
+	ping_printf(rts, "\n");
+}
+
+/*
+ * summary --
+ *	Print a one line overview of a target, used in place of the full
+ * statistics block when several targets share the screen.
+ */
+void summary(struct ping_rts *rts, int name_width)
+{
+	float loss = packet_loss(rts);
 
-	printw("\r");
-	printw(_("%ld/%ld packets, %d%% loss"), rts->nreceived, rts->ntransmitted, loss);
+	printw("%-*.*s ", name_width, name_width, rts->hostname);
+	printw(_("%ld/%ld packets, "), rts->nreceived, rts->ntransmitted);
+	set_packet_loss_color(loss);
+	printw("%g%%", loss);
+	set_color(NORMAL_COLOR_INDEX);
+	printw(_(" loss"));
 
 	if (rts->nreceived && rts->timing) {
-		tavg = rts->tsum / (rts->nreceived + rts->nrepeats);
+		long long tavg = ping_stats_mean(&rts->stats);
+		char min[32], avg[32], ewma[32], max[32];
+
+		printw(_(", min/avg/ewma/max = %s/%s/%s/%s ms"),
+			format_msec(rts, rts->stats.min, min, sizeof(min)),
+			format_msec(rts, tavg, avg, sizeof(avg)),
+			format_msec(rts, ping_stats_ewma(&rts->stats), ewma, sizeof(ewma)),
+			format_msec(rts, rts->stats.max, max, sizeof(max)));
+	}
+	if (rts->nsdelay) {
+		char delay[32];
 
-		printw(_(", min/avg/ewma/max = %ld.%03ld/%lu.%03ld/%d.%03d/%ld.%03ld ms"),
-			(long)rts->tmin / 1000, (long)rts->tmin % 1000,
-			tavg / 1000, tavg % 1000,
-			rts->rtt / 8000, (rts->rtt / 8) % 1000, (long)rts->tmax / 1000, (long)rts->tmax % 1000);
+		printw(_(", send delay %s ms"),
+			format_msec(rts, rts->sdelay_sum / rts->nsdelay, delay, sizeof(delay)));
 	}
 	printw("\n");
 }
 
+static const void *target_key(struct ping_rts *rts, size_t *len)
+{
+	if (rts->ipv4) {
+		*len = sizeof(rts->whereto.sin_addr);
+		return &rts->whereto.sin_addr;
+	}
+	*len = sizeof(rts->whereto6.sin6_addr);
+	return &rts->whereto6.sin6_addr;
+}
+
+static unsigned int target_hash(int family, const void *addr, size_t len)
+{
+	const unsigned char *p = addr;
+	uint32_t h = 2166136261u ^ (uint32_t)family;
+	size_t i;
+
+	for (i = 0; i < len; i++)
+		h = (h ^ p[i]) * 16777619u;
+	return h;
+}
+
+/* Put "rts" into the address table; returns the target it duplicates, if any. */
+static struct ping_rts *target_insert(struct ping_targets *targets, struct ping_rts *rts)
+{
+	const void *key;
+	size_t len;
+	unsigned int i;
+
+	key = target_key(rts, &len);
+	i = target_hash(rts->ipv4 ? AF_INET : AF_INET6, key, len) & targets->hash_mask;
+	while (targets->hash[i]) {
+		if (targets->hash[i]->ipv4 == rts->ipv4 &&
+		    !memcmp(target_key(targets->hash[i], &len), key, len))
+			return targets->hash[i];
+		i = (i + 1) & targets->hash_mask;
+	}
+	targets->hash[i] = rts;
+	return NULL;
+}
+
+/*
+ * ping_targets_rehash --
+ *	Rebuild the address table after a target changed its address.  Should
+ * two targets now share one, replies go to the first of them.
+ */
+void ping_targets_rehash(struct ping_targets *targets)
+{
+	int n;
+
+	memset(targets->hash, 0, (targets->hash_mask + 1) * sizeof(*targets->hash));
+	for (n = 0; n < targets->count; n++)
+		target_insert(targets, targets->list[n]);
+}
+
+/*
+ * ping_targets_add --
+ *	Register a resolved target.  The address table is kept at most half
+ * full, and rebuilt whenever a new target would exceed that.
+ */
+void ping_targets_add(struct ping_targets *targets, struct ping_rts *rts)
+{
+	targets->list = realloc(targets->list, (targets->count + 1) * sizeof(*targets->list));
+	if (!targets->list)
+		error(2, errno, _("memory allocation failed"));
+	rts->id = targets->count;
+	targets->list[targets->count++] = rts;
+
+	if ((unsigned int)targets->count * 2 > targets->hash_mask) {
+		unsigned int size = targets->hash_mask ? (targets->hash_mask + 1) * 2 : 16;
+		int n;
+
+		while ((unsigned int)targets->count * 2 > size - 1)
+			size *= 2;
+		free(targets->hash);
+		targets->hash = calloc(size, sizeof(*targets->hash));
+		if (!targets->hash)
+			error(2, errno, _("memory allocation failed"));
+		targets->hash_mask = size - 1;
+		for (n = 0; n < targets->count - 1; n++)
+			target_insert(targets, targets->list[n]);
+	}
+
+	if (target_insert(targets, rts))
+		error(2, 0, _("duplicate destination: %s"), rts->target);
+}
+
+/*
+ * ping_target_lookup --
+ *	Find the target that a reply or error for address "addr" belongs to.
+ * With a single target every packet is offered to it, as broadcast and
+ * multicast replies come from addresses other than the destination.
+ */
+struct ping_rts *ping_target_lookup(struct ping_rts *rts, int family, const void *addr)
+{
+	struct ping_targets *targets = rts->targets;
+	size_t len = family == AF_INET ? sizeof(struct in_addr) : sizeof(struct in6_addr);
+	unsigned int i;
+
+	if (!targets || targets->count <= 1)
+		return rts;
+
+	i = target_hash(family, addr, len) & targets->hash_mask;
+	while (targets->hash[i]) {
+		struct ping_rts *t = targets->hash[i];
+		size_t tlen;
+
+		if (t->ipv4 == (family == AF_INET) && !memcmp(target_key(t, &tlen), addr, len))
+			return t;
+		i = (i + 1) & targets->hash_mask;
+	}
+	return NULL;
+}
+
 inline int is_ours(struct ping_rts *rts, socket_st * sock, uint16_t id)
 {
 	return sock->socktype == SOCK_DGRAM || id == rts->ident;
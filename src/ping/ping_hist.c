@@ -0,0 +1,81 @@
+/*
+ * Round trip time histogram.
+ *
+ * Log-linear buckets in the manner of HdrHistogram: times below
+ * 2^PING_HIST_SUB_BITS nsec get a bucket each, every octave above is split
+ * into 2^PING_HIST_SUB_BITS equal buckets.  A recorded time is thus off by
+ * less than 1 / 2^PING_HIST_SUB_BITS of itself, recording is a few shifts
+ * and an increment, and the memory stays the same however long it runs.
+ */
+#include "iputils_common.h"
+#include "ping.h"
+
+/*
+ * ping_hist_bucket --
+ *	Bucket of "ns" in a histogram with 2^"sub_bits" buckets per octave.
+ */
+unsigned int ping_hist_bucket(long long ns, int sub_bits)
+{
+	unsigned long long v = ns < 0 ? 0 : ns;
+	int msb;
+
+	if (v < 1ULL << sub_bits)
+		return v;
+	if (v >= 1ULL << PING_HIST_MAX_BITS)
+		v = (1ULL << PING_HIST_MAX_BITS) - 1;
+
+	msb = 63 - __builtin_clzll(v);
+	return ((msb - sub_bits + 1) << sub_bits) + (v >> (msb - sub_bits)) - (1U << sub_bits);
+}
+
+/* The middle of bucket "index", in nsec. */
+long long ping_hist_value(unsigned int index, int sub_bits)
+{
+	unsigned int group = index >> sub_bits;
+	unsigned int sub = index & ((1U << sub_bits) - 1);
+	int shift;
+
+	if (!group)
+		return sub;
+	shift = group - 1;
+	return ((long long)((1U << sub_bits) + sub) << shift) + ((1LL << shift) >> 1);
+}
+
+struct ping_hist *ping_hist_alloc(void)
+{
+	struct ping_hist *hist = calloc(1, sizeof(*hist));
+
+	if (!hist)
+		error(2, errno, _("memory allocation failed"));
+	return hist;
+}
+
+void ping_hist_record(struct ping_hist *hist, long long ns)
+{
+	hist->buckets[ping_hist_bucket(ns, PING_HIST_SUB_BITS)]++;
+	hist->count++;
+}
+
+/*
+ * ping_hist_percentile --
+ *	The time that "percent" of the recorded times do not exceed, or 0 if
+ * nothing was recorded.
+ */
+long long ping_hist_percentile(const struct ping_hist *hist, double percent)
+{
+	unsigned long long rank, seen = 0;
+	unsigned int i;
+
+	if (!hist || !hist->count)
+		return 0;
+
+	rank = (unsigned long long)(percent / 100 * hist->count + 0.5);
+	if (rank < 1)
+		rank = 1;
+	for (i = 0; i < PING_HIST_BUCKETS; i++) {
+		seen += hist->buckets[i];
+		if (seen >= rank)
+			return ping_hist_value(i, PING_HIST_SUB_BITS);
+	}
+	return ping_hist_value(PING_HIST_BUCKETS - 1, PING_HIST_SUB_BITS);
+}
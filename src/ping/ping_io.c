@@ -0,0 +1,54 @@
+/*
+ * Measurement thread.
+ *
+ * The sockets, the timer wheel and the statistics of all targets belong to
+ * a thread that does nothing but send probes and take in replies, so that
+ * neither a long redraw nor a terminal that stops reading holds up the
+ * probe schedule or lets replies pile up in the socket buffers.  It holds
+ * setup_data->lock while handling events, never while waiting for them.
+ * Other threads take the lock only to copy out what they show: the screen
+ * copies the targets into curses' window in memory and writes that to the
+ * terminal once it has let go.
+ */
+#include <pthread.h>
+
+#include "iputils_common.h"
+#include "ping.h"
+
+static void *ping_io_thread(void *arg)
+{
+	ping_setup_data *setup_data = arg;
+	struct epoll_event events[EVENT_BATCH];
+	int n;
+
+	for (;;) {
+		n = event_wait(setup_data->epfd, events, EVENT_BATCH, -1);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			error(2, errno, "epoll_wait");
+		}
+		pthread_mutex_lock(&setup_data->lock);
+		event_run(events, n);
+		pthread_mutex_unlock(&setup_data->lock);
+	}
+	return NULL;
+}
+
+/*
+ * ping_io_start --
+ *	Send the first probes and leave the targets to the measurement
+ * thread.  From here on they may only be looked at with setup_data->lock
+ * held.  Signals are all left to the calling thread.
+ */
+void ping_io_start(ping_setup_data *setup_data)
+{
+	int ret;
+
+	pthread_mutex_init(&setup_data->lock, NULL);
+	ping_register_events(setup_data, event_loop_create());
+
+	ret = ping_thread_start(ping_io_thread, setup_data);
+	if (ret)
+		error(2, ret, "pthread_create");
+}
@@ -0,0 +1,59 @@
+/*
+ * Delay variation and reordering.
+ *
+ * Interarrival jitter is the RFC 3550 estimator: for each reply, D is the
+ * change in transit time from the reply before it, and the running J moves
+ * 1/16 of the way towards |D|.  J is kept as nsec << 4 so that the integer
+ * update of RFC 3550 A.8 loses nothing.  The same D is the IPDV of RFC 5481
+ * (consecutive packets in arrival order); its magnitude goes into a
+ * histogram like the round trip times, its extremes are kept with sign.
+ *
+ * A reply is reordered if a later sequence number has already been seen,
+ * and its extent is how far behind the highest one it is (RFC 4737).
+ * Everything is O(1) per reply.
+ */
+#include "iputils_common.h"
+#include "ping.h"
+
+/*
+ * ping_jitter_reply --
+ *	A reply with sequence number "seq" and round trip time "ns", or -1
+ * if it was not timed, arrived.  Duplicates must not be passed in.
+ */
+void ping_jitter_reply(struct ping_jitter *jitter, uint16_t seq, long long ns)
+{
+	if (!jitter->nseq) {
+		jitter->highest = seq;
+	} else {
+		int16_t behind = jitter->highest - seq;
+
+		if (behind > 0) {
+			jitter->reordered++;
+			if (behind > jitter->reorder_max)
+				jitter->reorder_max = behind;
+		} else {
+			jitter->highest = seq;
+		}
+	}
+	jitter->nseq++;
+
+	if (ns < 0)
+		return;
+
+	if (jitter->timed) {
+		long long d = ns - jitter->transit;
+		long long absd = d < 0 ? -d : d;
+
+		jitter->jitter += absd - ((jitter->jitter + 8) >> 4);
+		if (!jitter->ipdv)
+			jitter->ipdv = ping_hist_alloc();
+		ping_hist_record(jitter->ipdv, absd);
+		jitter->ipdv_sum += absd;
+		if (jitter->ipdv->count == 1 || d < jitter->ipdv_min)
+			jitter->ipdv_min = d;
+		if (jitter->ipdv->count == 1 || d > jitter->ipdv_max)
+			jitter->ipdv_max = d;
+	}
+	jitter->transit = ns;
+	jitter->timed = 1;
+}
@@ -0,0 +1,214 @@
+/*
+ * Binary sample log.
+ *
+ * With -g every probe outcome is appended to a file of fixed size records,
+ * see ping_log.h.  Appending is a store into a shared mapping of a file
+ * extended to its full size up front: no system call on the receive path.
+ * Files are numbered "<path>.0000", "<path>.0001", ... and rolled over by
+ * size and by age.  Everything that does system calls happens on a timer:
+ * it keeps the next file opened and mapped, so that the receive path only
+ * swaps to it once the current one is full, and it trims the files done
+ * with to the records they hold.  Records that find no room are counted,
+ * not waited for.
+ */
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/mman.h>
+
+#include "iputils_common.h"
+#include "ping.h"
+
+#define PING_LOG_TICK		1000		/* msec */
+
+struct log_file {
+	int fd;
+	struct ping_log_header *header;	/* NULL: none */
+	struct ping_log_record *records;
+	uint64_t capacity;		/* records it has room for */
+	uint64_t opened;		/* wheel msec it became current */
+};
+
+static struct {
+	char *path;
+	uint64_t max_bytes;
+	uint64_t max_msec;		/* 0: no roll over by age */
+	unsigned int serial;		/* of the next file */
+	struct ping_targets *targets;
+	int64_t realtime;		/* CLOCK_REALTIME - CLOCK_MONOTONIC, nsec */
+	struct log_file cur, next, done;
+	unsigned long long dropped;
+	struct timer_entry timer;
+} plog;
+
+/*
+ * ping_log_config --
+ *	Log to files named after "path", of at most "max_bytes" each and
+ * rolled over after "max_sec" seconds, if that is not 0.
+ */
+void ping_log_config(const char *path, uint64_t max_bytes, long max_sec)
+{
+	plog.path = strdup(path);
+	if (!plog.path)
+		error(2, errno, _("memory allocation failed"));
+	if (max_bytes < PING_LOG_HEADER + 64 * sizeof(struct ping_log_record))
+		max_bytes = PING_LOG_HEADER + 64 * sizeof(struct ping_log_record);
+	plog.max_bytes = max_bytes;
+	plog.max_msec = max_sec * 1000ULL;
+}
+
+/* Create and map the next file into "f". */
+static void log_prepare(struct log_file *f, uint64_t now)
+{
+	struct ping_log_header *h;
+	char name[PATH_MAX];
+	size_t off = 0;
+	int i;
+
+	snprintf(name, sizeof(name), "%s.%04u", plog.path, plog.serial++);
+	f->fd = open(name, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (f->fd < 0)
+		error(2, errno, _("cannot create %s"), name);
+	/* Allocate the blocks now, not on the first store to each page. */
+	if (fallocate(f->fd, 0, 0, plog.max_bytes) < 0 &&
+	    ftruncate(f->fd, plog.max_bytes) < 0)
+		error(2, errno, _("cannot extend %s"), name);
+	h = mmap(NULL, plog.max_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, f->fd, 0);
+	if (h == MAP_FAILED)
+		error(2, errno, _("cannot map %s"), name);
+
+	memset(h, 0, sizeof(*h));
+	memcpy(h->magic, PING_LOG_MAGIC, sizeof(h->magic));
+	h->version = PING_LOG_VERSION;
+	h->header_size = sizeof(*h);
+	h->record_size = sizeof(struct ping_log_record);
+	h->ntargets = plog.targets->count;
+	h->created_ns = now * 1000000 + plog.realtime;
+	for (i = 0; i < plog.targets->count; i++) {
+		const char *target = plog.targets->list[i]->target;
+		size_t len = strlen(target) + 1;
+
+		if (off + len > sizeof(h->targets))
+			break;
+		memcpy(h->targets + off, target, len);
+		off += len;
+	}
+
+	f->header = h;
+	f->records = (struct ping_log_record *)((char *)h + sizeof(*h));
+	f->capacity = (plog.max_bytes - sizeof(*h)) / sizeof(struct ping_log_record);
+}
+
+/* Unmap "f" and cut its file down to the records in it. */
+static void log_finish(struct log_file *f)
+{
+	uint64_t count = f->header->count;
+
+	munmap(f->header, plog.max_bytes);
+	if (ftruncate(f->fd, sizeof(struct ping_log_header) + count * sizeof(struct ping_log_record)) < 0)
+		error(0, errno, "ftruncate");
+	close(f->fd);
+	f->header = NULL;
+}
+
+/* Make the prepared file the current one, as of wheel time "now". */
+static void log_switch(uint64_t now)
+{
+	plog.done = plog.cur;
+	plog.cur = plog.next;
+	plog.cur.opened = now;
+	plog.next.header = NULL;
+}
+
+static void ping_log_timer(struct timer_entry *timer)
+{
+	uint64_t now = plog.targets->list[0]->wheel->now;
+
+	if (plog.done.header)
+		log_finish(&plog.done);
+	if (plog.max_msec && now - plog.cur.opened >= plog.max_msec &&
+	    plog.next.header && plog.cur.header->count) {
+		log_switch(now);
+		log_finish(&plog.done);
+	}
+	if (!plog.next.header)
+		log_prepare(&plog.next, now);
+	if (plog.dropped) {
+		error(0, 0, _("sample log full, %llu records dropped"), plog.dropped);
+		plog.dropped = 0;
+	}
+	timer_add(timer->data, timer, now + PING_LOG_TICK);
+}
+
+/*
+ * ping_log_start --
+ *	Open the first log files, if -g was given, and keep the next one
+ * ready from wheel time "now" on.
+ */
+void ping_log_start(ping_setup_data *setup_data, uint64_t now)
+{
+	struct timespec real, mono;
+
+	if (!plog.path)
+		return;
+	clock_gettime(CLOCK_REALTIME, &real);
+	clock_gettime(CLOCK_MONOTONIC, &mono);
+	plog.realtime = (real.tv_sec - mono.tv_sec) * 1000000000LL + real.tv_nsec - mono.tv_nsec;
+	plog.targets = &setup_data->targets;
+
+	log_prepare(&plog.cur, now);
+	plog.cur.opened = now;
+	log_prepare(&plog.next, now);
+	timer_init(&plog.timer, ping_log_timer, &setup_data->wheel);
+	timer_add(&setup_data->wheel, &plog.timer, now + PING_LOG_TICK);
+}
+
+/*
+ * ping_log_add --
+ *	Append an outcome of probe "seq" of "rts".  "mono" is the
+ * CLOCK_MONOTONIC nsec it was sent, or the answer came in.
+ */
+void ping_log_add(struct ping_rts *rts, int status, long seq, long long mono,
+		  long long rtt, int ttl)
+{
+	struct ping_log_record *rec;
+	uint64_t count;
+
+	if (!plog.cur.header)
+		return;
+	count = plog.cur.header->count;
+	if (count == plog.cur.capacity) {
+		if (!plog.next.header || plog.done.header) {
+			plog.dropped++;
+			return;
+		}
+		log_switch(rts->wheel->now);
+		count = 0;
+	}
+
+	rec = &plog.cur.records[count];
+	rec->time_ns = mono + plog.realtime;
+	rec->rtt_ns = rtt;
+	rec->seq = seq;
+	rec->target = rts->id;
+	rec->ttl = ttl > 0 ? ttl : 0;
+	rec->status = status;
+	/* Readers may be looking on: the record first, then the count. */
+	__atomic_store_n(&plog.cur.header->count, count + 1, __ATOMIC_RELEASE);
+}
+
+/* Trim the files written to, at exit. */
+void ping_log_close(void)
+{
+	if (plog.done.header)
+		log_finish(&plog.done);
+	if (plog.cur.header)
+		log_finish(&plog.cur);
+	if (plog.next.header) {
+		char name[PATH_MAX];
+
+		/* Never written to, the last serial handed out was its. */
+		log_finish(&plog.next);
+		snprintf(name, sizeof(name), "%s.%04u", plog.path, --plog.serial);
+		unlink(name);
+	}
+}
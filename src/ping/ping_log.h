@@ -0,0 +1,53 @@
+#ifndef PING_LOG_H
+#define PING_LOG_H
+
+/*
+ * Layout of the -g sample log, shared with the watchping-log reader.
+ *
+ * A log file is a PING_LOG_HEADER byte header followed by fixed size
+ * records, one per probe outcome, in the order they happened.  Everything
+ * is in host byte order.  The writer fills in a record before it bumps
+ * "count", so a reader of a file still being written sees whole records
+ * up to "count" and may ignore the rest of the file.
+ */
+#include <stdint.h>
+
+#define PING_LOG_MAGIC		"WPINGLOG"
+#define PING_LOG_VERSION	1
+#define PING_LOG_HEADER		4096
+
+/* ping_log_record.status */
+enum {
+	PING_LOG_REPLY = 1,
+	PING_LOG_DUP,			/* duplicate reply */
+	PING_LOG_CKSUM,			/* reply with a bad checksum */
+	PING_LOG_TIMEOUT,		/* no reply within the linger time */
+	PING_LOG_ERROR,			/* ICMP error */
+};
+
+struct ping_log_header {
+	char magic[8];			/* PING_LOG_MAGIC, not NUL terminated */
+	uint32_t version;
+	uint32_t header_size;		/* offset of the first record */
+	uint32_t record_size;
+	uint32_t ntargets;
+	uint64_t created_ns;		/* CLOCK_REALTIME */
+	uint64_t count;			/* records written */
+	/* target names as given, by target id, each NUL terminated */
+	char targets[PING_LOG_HEADER - 40];
+};
+
+struct ping_log_record {
+	uint64_t time_ns;		/* CLOCK_REALTIME the probe was sent, or
+					 * the answer came in if that is unknown */
+	int64_t rtt_ns;			/* -1 if not timed */
+	uint32_t seq;
+	uint16_t target;		/* id, see ping_log_header.targets */
+	uint8_t ttl;			/* 0 if unknown */
+	uint8_t status;			/* PING_LOG_* */
+};
+
+_Static_assert(sizeof(struct ping_log_header) == PING_LOG_HEADER, "ping_log_header");
+_Static_assert(sizeof(struct ping_log_record) == 24, "ping_log_record");
+
+#endif /* PING_LOG_H */
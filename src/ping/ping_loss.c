@@ -0,0 +1,91 @@
+/*
+ * Loss runs.
+ *
+ * Probes are classified as received or lost in sequence order, each once.
+ * All reply timeouts are the same linger time after the send, so they fire
+ * in sequence order: when a probe times out, every earlier probe has
+ * settled and the received-sequence table tells which of them came back.
+ * A reply that arrives in order moves the classification on by itself, so
+ * nothing waits for the next loss.  Each probe is looked at once, however
+ * the replies and timeouts interleave.
+ *
+ * The outcomes feed a histogram of loss run lengths in powers of two, the
+ * longest outage and the transition counts of a two state Gilbert model.
+ */
+#include "iputils_common.h"
+#include "ping.h"
+
+static void classify(struct ping_loss *loss, int lost, uint64_t sent)
+{
+	if (loss->classified) {
+		if (loss->lost) {
+			loss->from_bad++;
+			if (!lost)
+				loss->bad_good++;
+		} else {
+			loss->from_good++;
+			if (lost)
+				loss->good_bad++;
+		}
+	}
+	loss->classified++;
+
+	if (!lost) {
+		if (loss->run)
+			loss->runs[ping_loss_bucket(loss->run)]++;
+		loss->run = 0;
+		loss->received++;
+		loss->lost = 0;
+		return;
+	}
+
+	if (!loss->run)
+		loss->run_start = sent;
+	loss->run++;
+	loss->nlost++;
+	loss->lost = 1;
+	if (loss->run > loss->longest) {
+		loss->longest = loss->run;
+		loss->longest_start = loss->run_start;
+		loss->longest_end = sent;
+	}
+}
+
+/* Classify the probes from the next one on for as long as they came back. */
+static void classify_received(struct ping_rts *rts, long upto)
+{
+	struct ping_loss *loss = &rts->loss;
+
+	while (loss->classified < upto && rcvd_test(rts, loss->classified + 1))
+		classify(loss, 0, 0);
+}
+
+/*
+ * ping_loss_timeout --
+ *	Probe "seq", sent at wheel time "sent", was given up on.
+ */
+void ping_loss_timeout(struct ping_rts *rts, long seq, uint64_t sent)
+{
+	struct ping_loss *loss = &rts->loss;
+
+	if (seq <= loss->classified)
+		return;
+	classify_received(rts, seq - 1);
+	/* Anything before it not back by now timed out earlier. */
+	while (loss->classified < seq - 1)
+		classify(loss, 1, sent);
+	classify(loss, 1, sent);
+}
+
+/* A probe was answered: classify it if it is the next one. */
+void ping_loss_reply(struct ping_rts *rts)
+{
+	classify_received(rts, rts->ntransmitted);
+}
+
+unsigned int ping_loss_bucket(long run)
+{
+	unsigned int b = 63 - __builtin_clzll(run);
+
+	return b < PING_LOSS_BUCKETS ? b : PING_LOSS_BUCKETS - 1;
+}
@@ -0,0 +1,648 @@
+/*
+ * Prometheus exporter.
+ *
+ * With -E a small HTTP server answers GET /metrics with the counters,
+ * gauges and round trip time histogram of every target, in the Prometheus
+ * text format, or in OpenMetrics if the scraper asks for it.  Its sockets
+ * are sources on the event loop of the probes, so a scrape is handled
+ * between two probe events by the thread that owns the statistics and
+ * takes no lock the probe path would wait on.  What it reads is copied into
+ * a snapshot first, the histograms already folded into the few exported
+ * buckets; the response is then formatted from the snapshot alone and sent
+ * without blocking, the rest whenever the socket takes more.  A connection
+ * gets METRICS_TIMEOUT on the wheel to be done with, and the oldest one
+ * makes way for a new one when all are taken, so clients that stall
+ * cannot lock the scrapers out.
+ */
+#include "iputils_common.h"
+#include "ping.h"
+
+#define METRICS_CONNS		8
+#define METRICS_REQUEST		4096		/* longest request head taken */
+#define METRICS_TIMEOUT		10000		/* msec a connection may last */
+
+/* Upper bounds of the exported histogram buckets, nsec */
+static const long long metrics_le[] = {
+	100000, 250000, 500000,
+	1000000, 2500000, 5000000,
+	10000000, 25000000, 50000000,
+	100000000, 250000000, 500000000,
+	1000000000, 2500000000LL, 5000000000LL, 10000000000LL,
+};
+#define METRICS_LE	ARRAY_SIZE(metrics_le)
+
+/* The same for |IPDV|, which is mostly well below the round trip time */
+static const long long metrics_ipdv_le[] = {
+	10000, 25000, 50000,
+	100000, 250000, 500000,
+	1000000, 2500000, 5000000,
+	10000000, 25000000, 50000000,
+	100000000, 250000000, 500000000, 1000000000,
+};
+_Static_assert(ARRAY_SIZE(metrics_ipdv_le) == METRICS_LE, "metrics_ipdv_le");
+
+struct metrics_window {
+	const char *name;
+	int valid, timed;
+	double loss;			/* percent */
+	long long p99;
+};
+
+/* What a scrape reports of one target, copied out in one go */
+struct metrics_target {
+	const char *name;
+	long transmitted, received, repeats, checksum, errors;
+	double loss;			/* percent */
+	long loss_run_max;
+	int timed;			/* min..jitter are valid */
+	long long min, avg, max, mdev, ewma, jitter;
+	unsigned long long le[METRICS_LE], count;
+	double sum;			/* nsec */
+	unsigned long long reordered;
+	long reorder_max;
+	long long ipdv_min, ipdv_max;	/* valid if ipdv_count */
+	unsigned long long ipdv_le[METRICS_LE], ipdv_count;
+	double ipdv_sum;		/* nsec */
+	struct metrics_window windows[PING_WINDOWS];
+};
+
+struct metrics_conn {
+	event_source source;
+	struct timer_entry timer;	/* METRICS_TIMEOUT after the accept */
+	char request[METRICS_REQUEST];
+	size_t request_len;
+	char *response;			/* NULL until the request is complete */
+	size_t response_len, sent, size;
+};
+
+static struct {
+	const char *arg;		/* NULL: no -E */
+	char host[INET6_ADDRSTRLEN + 2];
+	const char *port;
+	int fd;
+	event_source source;
+	int epfd;
+	ping_setup_data *setup_data;
+	struct metrics_conn conns[METRICS_CONNS];
+} metrics = {
+	.fd = -1,
+};
+
+/*
+ * ping_metrics_config --
+ *	Take scrapes on "[<addr>:]<port>", on the loopback address if no
+ * address is given.  An IPv6 address is written in brackets.  Only the
+ * argument is checked here; the socket is opened by ping_metrics_start(),
+ * once the privileges are gone.
+ */
+void ping_metrics_config(const char *arg)
+{
+	const char *colon = strrchr(arg, ':');
+
+	metrics.arg = arg;
+	metrics.port = arg;
+	strcpy(metrics.host, "127.0.0.1");
+	if (colon) {
+		const char *start = arg, *end = colon;
+
+		if (*start == '[' && end > start && end[-1] == ']') {
+			start++;
+			end--;
+		}
+		if ((size_t)(end - start) >= sizeof(metrics.host) || end == start)
+			error(2, 0, _("invalid -E argument: %s"), arg);
+		memcpy(metrics.host, start, end - start);
+		metrics.host[end - start] = '\0';
+		metrics.port = colon + 1;
+	}
+}
+
+/*
+ * ping_metrics_start --
+ *	Listen for scrapes, if -E was given.  Called after the capabilities
+ * are dropped, so that a set-uid watchping cannot be made to bind what
+ * its user may not.
+ */
+void ping_metrics_start(void)
+{
+	struct addrinfo hints = {
+		.ai_socktype = SOCK_STREAM,
+		.ai_flags = AI_PASSIVE | AI_NUMERICHOST | AI_NUMERICSERV,
+	}, *ai;
+	const char *arg = metrics.arg;
+	int one = 1, ret, i;
+
+	if (!arg)
+		return;
+	ret = getaddrinfo(metrics.host, metrics.port, &hints, &ai);
+	if (ret)
+		error(2, 0, _("invalid -E argument: %s: %s"), arg, gai_strerror(ret));
+	metrics.fd = socket(ai->ai_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (metrics.fd < 0)
+		error(2, errno, "socket");
+	setsockopt(metrics.fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+	if (bind(metrics.fd, ai->ai_addr, ai->ai_addrlen) < 0)
+		error(2, errno, _("cannot listen on %s"), arg);
+	if (listen(metrics.fd, METRICS_CONNS) < 0)
+		error(2, errno, "listen");
+	freeaddrinfo(ai);
+
+	for (i = 0; i < METRICS_CONNS; i++)
+		metrics.conns[i].source.fd = -1;
+}
+
+static void conn_close(struct metrics_conn *conn)
+{
+	timer_del(&metrics.setup_data->wheel, &conn->timer);
+	event_del(metrics.epfd, &conn->source);
+	close(conn->source.fd);
+	conn->source.fd = -1;
+	free(conn->response);
+	conn->response = NULL;
+}
+
+static void out_grow(struct metrics_conn *conn, size_t need)
+{
+	size_t size = conn->size ? conn->size : 16384;
+
+	while (size < conn->response_len + need)
+		size *= 2;
+	if (size == conn->size)
+		return;
+	conn->response = realloc(conn->response, size);
+	if (!conn->response)
+		error(2, errno, _("memory allocation failed"));
+	conn->size = size;
+}
+
+static void __attribute__((format(printf, 2, 3))) out_printf(struct metrics_conn *conn,
+							      const char *fmt, ...)
+{
+	va_list ap;
+	int n;
+
+	for (;;) {
+		size_t room = conn->size - conn->response_len;
+
+		va_start(ap, fmt);
+		n = vsnprintf(conn->response + conn->response_len, room, fmt, ap);
+		va_end(ap);
+		if ((size_t)n < room)
+			break;
+		out_grow(conn, n + 1);
+	}
+	conn->response_len += n;
+}
+
+/* The target label, with what the format wants escaped */
+static void out_target(struct metrics_conn *conn, const char *name)
+{
+	const char *s;
+
+	out_printf(conn, "{target=\"");
+	for (s = name; *s; s++) {
+		if (*s == '\\' || *s == '"')
+			out_printf(conn, "\\%c", *s);
+		else if (*s == '\n')
+			out_printf(conn, "\\n");
+		else
+			out_printf(conn, "%c", *s);
+	}
+	out_printf(conn, "\"");
+}
+
+/* Fold the log-linear buckets of "hist" into the exported ones "le",
+ * counting the bucket a bound falls in as below it. */
+static void fold_hist(const struct ping_hist *hist, const long long *le, unsigned long long *out)
+{
+	unsigned long long seen = 0;
+	unsigned int i = 0, j, limit;
+
+	for (j = 0; j < METRICS_LE; j++) {
+		limit = ping_hist_bucket(le[j], PING_HIST_SUB_BITS);
+		for (; i <= limit; i++)
+			seen += hist->buckets[i];
+		out[j] = seen;
+	}
+}
+
+static void snapshot_target(struct ping_rts *rts, struct metrics_target *t, long long now)
+{
+	unsigned int i;
+
+	memset(t, 0, sizeof(*t));
+	t->name = rts->target;
+	t->transmitted = rts->ntransmitted;
+	t->received = rts->nreceived;
+	t->repeats = rts->nrepeats;
+	t->checksum = rts->nchecksum;
+	t->errors = rts->nerrors;
+	t->loss = packet_loss(rts);
+	t->loss_run_max = rts->loss.longest;
+	if (rts->nreceived && rts->timing && rts->stats.count) {
+		t->timed = 1;
+		t->min = rts->stats.min;
+		t->avg = ping_stats_mean(&rts->stats);
+		t->max = rts->stats.max;
+		t->mdev = ping_stats_mdev(&rts->stats);
+		t->ewma = ping_stats_ewma(&rts->stats);
+		t->jitter = ping_jitter_value(&rts->jitter);
+		t->sum = rts->stats.mean * rts->stats.count;
+	}
+
+	if (rts->hist) {
+		fold_hist(rts->hist, metrics_le, t->le);
+		t->count = rts->hist->count;
+	}
+	t->reordered = rts->jitter.reordered;
+	t->reorder_max = rts->jitter.reorder_max;
+	if (rts->jitter.ipdv) {
+		fold_hist(rts->jitter.ipdv, metrics_ipdv_le, t->ipdv_le);
+		t->ipdv_count = rts->jitter.ipdv->count;
+		t->ipdv_sum = rts->jitter.ipdv_sum;
+		t->ipdv_min = rts->jitter.ipdv_min;
+		t->ipdv_max = rts->jitter.ipdv_max;
+	}
+
+	if (rts->windows) {
+		for (i = 0; i < PING_WINDOWS; i++) {
+			struct metrics_window *w = &t->windows[i];
+			struct ping_window_stats ws;
+
+			w->valid = ping_window_stats(rts->windows, i, now, &ws);
+			w->name = ws.name;
+			w->loss = ws.loss;
+			w->timed = ws.timed;
+			w->p99 = ws.p99;
+		}
+	}
+}
+
+static void out_family(struct metrics_conn *conn, int openmetrics, const char *name,
+		       const char *type, const char *help)
+{
+	size_t len = strlen(name);
+
+	/* OpenMetrics names a counter family without the _total. */
+	if (openmetrics && !strcmp(type, "counter") && len > 6 &&
+	    !strcmp(name + len - 6, "_total"))
+		len -= 6;
+	out_printf(conn, "# HELP %.*s %s\n# TYPE %.*s %s\n", (int)len, name, help,
+		   (int)len, name, type);
+}
+
+static void out_seconds(struct metrics_conn *conn, long long ns)
+{
+	out_printf(conn, " %lld.%09lld\n", ns / 1000000000, ns % 1000000000);
+}
+
+#define FAMILY(name, type, help)	out_family(conn, openmetrics, name, type, help)
+#define EACH(t)				for (t = targets; t < targets + n; t++)
+
+static void format_metrics(struct metrics_conn *conn, const struct metrics_target *targets,
+			   int n, int openmetrics)
+{
+	const struct metrics_target *t;
+	unsigned int i, j;
+
+	FAMILY("watchping_transmitted_total", "counter", "Probes sent.");
+	EACH(t) {
+		out_printf(conn, "watchping_transmitted_total");
+		out_target(conn, t->name);
+		out_printf(conn, "} %ld\n", t->transmitted);
+	}
+	FAMILY("watchping_received_total", "counter", "Replies received, duplicates left out.");
+	EACH(t) {
+		out_printf(conn, "watchping_received_total");
+		out_target(conn, t->name);
+		out_printf(conn, "} %ld\n", t->received);
+	}
+	FAMILY("watchping_duplicates_total", "counter", "Duplicate replies received.");
+	EACH(t) {
+		out_printf(conn, "watchping_duplicates_total");
+		out_target(conn, t->name);
+		out_printf(conn, "} %ld\n", t->repeats);
+	}
+	FAMILY("watchping_checksum_errors_total", "counter", "Replies with a bad checksum.");
+	EACH(t) {
+		out_printf(conn, "watchping_checksum_errors_total");
+		out_target(conn, t->name);
+		out_printf(conn, "} %ld\n", t->checksum);
+	}
+	FAMILY("watchping_icmp_errors_total", "counter", "ICMP errors in answer to probes.");
+	EACH(t) {
+		out_printf(conn, "watchping_icmp_errors_total");
+		out_target(conn, t->name);
+		out_printf(conn, "} %ld\n", t->errors);
+	}
+
+	FAMILY("watchping_loss_ratio", "gauge", "Share of the settled probes that got no reply.");
+	EACH(t) {
+		out_printf(conn, "watchping_loss_ratio");
+		out_target(conn, t->name);
+		out_printf(conn, "} %g\n", t->loss / 100);
+	}
+	FAMILY("watchping_loss_run_max", "gauge", "Most probes lost in a row.");
+	EACH(t) {
+		out_printf(conn, "watchping_loss_run_max");
+		out_target(conn, t->name);
+		out_printf(conn, "} %ld\n", t->loss_run_max);
+	}
+	FAMILY("watchping_reordered_total", "counter",
+	       "Replies that came in after one with a later sequence number.");
+	EACH(t) {
+		out_printf(conn, "watchping_reordered_total");
+		out_target(conn, t->name);
+		out_printf(conn, "} %llu\n", t->reordered);
+	}
+	FAMILY("watchping_reorder_extent_max", "gauge",
+	       "Most sequence numbers a reordered reply was behind.");
+	EACH(t) {
+		out_printf(conn, "watchping_reorder_extent_max");
+		out_target(conn, t->name);
+		out_printf(conn, "} %ld\n", t->reorder_max);
+	}
+
+	{
+		static const struct {
+			const char *name, *help;
+			size_t offset;
+		} gauges[] = {
+#define GAUGE(name, field, help) \
+			{ "watchping_" name "_seconds", help, offsetof(struct metrics_target, field) }
+			GAUGE("rtt_min", min, "Shortest round trip time."),
+			GAUGE("rtt_avg", avg, "Mean round trip time."),
+			GAUGE("rtt_max", max, "Longest round trip time."),
+			GAUGE("rtt_mdev", mdev, "Standard deviation of the round trip time."),
+			GAUGE("rtt_ewma", ewma, "Moving average of the round trip time."),
+			GAUGE("jitter", jitter, "Interarrival jitter after RFC 3550."),
+#undef GAUGE
+		};
+
+		for (i = 0; i < ARRAY_SIZE(gauges); i++) {
+			FAMILY(gauges[i].name, "gauge", gauges[i].help);
+			EACH(t) {
+				if (!t->timed)
+					continue;
+				out_printf(conn, "%s", gauges[i].name);
+				out_target(conn, t->name);
+				out_printf(conn, "}");
+				out_seconds(conn, *(const long long *)((const char *)t + gauges[i].offset));
+			}
+		}
+	}
+
+	FAMILY("watchping_ipdv_min_seconds", "gauge",
+	       "Most negative change in round trip time between consecutive replies.");
+	EACH(t) {
+		if (!t->ipdv_count)
+			continue;
+		out_printf(conn, "watchping_ipdv_min_seconds");
+		out_target(conn, t->name);
+		out_printf(conn, "} %.9f\n", t->ipdv_min / 1e9);
+	}
+	FAMILY("watchping_ipdv_max_seconds", "gauge",
+	       "Most positive change in round trip time between consecutive replies.");
+	EACH(t) {
+		if (!t->ipdv_count)
+			continue;
+		out_printf(conn, "watchping_ipdv_max_seconds");
+		out_target(conn, t->name);
+		out_printf(conn, "} %.9f\n", t->ipdv_max / 1e9);
+	}
+
+	FAMILY("watchping_window_loss_ratio", "gauge", "Share of the probes lost in the last window.");
+	EACH(t) {
+		for (j = 0; j < PING_WINDOWS; j++) {
+			if (!t->windows[j].valid)
+				continue;
+			out_printf(conn, "watchping_window_loss_ratio");
+			out_target(conn, t->name);
+			out_printf(conn, ",window=\"%s\"} %g\n", t->windows[j].name,
+				   t->windows[j].loss / 100);
+		}
+	}
+	FAMILY("watchping_window_rtt_p99_seconds", "gauge",
+	       "99th percentile round trip time in the last window.");
+	EACH(t) {
+		for (j = 0; j < PING_WINDOWS; j++) {
+			if (!t->windows[j].timed)
+				continue;
+			out_printf(conn, "watchping_window_rtt_p99_seconds");
+			out_target(conn, t->name);
+			out_printf(conn, ",window=\"%s\"}", t->windows[j].name);
+			out_seconds(conn, t->windows[j].p99);
+		}
+	}
+
+	FAMILY("watchping_rtt_seconds", "histogram", "Round trip times.");
+	EACH(t) {
+		for (j = 0; j < METRICS_LE; j++) {
+			out_printf(conn, "watchping_rtt_seconds_bucket");
+			out_target(conn, t->name);
+			out_printf(conn, ",le=\"%g\"} %llu\n", metrics_le[j] / 1e9, t->le[j]);
+		}
+		out_printf(conn, "watchping_rtt_seconds_bucket");
+		out_target(conn, t->name);
+		out_printf(conn, ",le=\"+Inf\"} %llu\n", t->count);
+		out_printf(conn, "watchping_rtt_seconds_sum");
+		out_target(conn, t->name);
+		out_printf(conn, "} %.9f\n", t->sum / 1e9);
+		out_printf(conn, "watchping_rtt_seconds_count");
+		out_target(conn, t->name);
+		out_printf(conn, "} %llu\n", t->count);
+	}
+	FAMILY("watchping_ipdv_seconds", "histogram",
+	       "Size of the change in round trip time between consecutive replies (RFC 5481).");
+	EACH(t) {
+		for (j = 0; j < METRICS_LE; j++) {
+			out_printf(conn, "watchping_ipdv_seconds_bucket");
+			out_target(conn, t->name);
+			out_printf(conn, ",le=\"%g\"} %llu\n", metrics_ipdv_le[j] / 1e9, t->ipdv_le[j]);
+		}
+		out_printf(conn, "watchping_ipdv_seconds_bucket");
+		out_target(conn, t->name);
+		out_printf(conn, ",le=\"+Inf\"} %llu\n", t->ipdv_count);
+		out_printf(conn, "watchping_ipdv_seconds_sum");
+		out_target(conn, t->name);
+		out_printf(conn, "} %.9f\n", t->ipdv_sum / 1e9);
+		out_printf(conn, "watchping_ipdv_seconds_count");
+		out_target(conn, t->name);
+		out_printf(conn, "} %llu\n", t->ipdv_count);
+	}
+
+	if (openmetrics)
+		out_printf(conn, "# EOF\n");
+}
+
+#undef FAMILY
+#undef EACH
+
+/* Send what the socket takes; returns 1 once all is sent. */
+static int conn_send(struct metrics_conn *conn)
+{
+	ssize_t n;
+
+	while (conn->sent < conn->response_len) {
+		n = send(conn->source.fd, conn->response + conn->sent,
+			 conn->response_len - conn->sent, MSG_DONTWAIT | MSG_NOSIGNAL);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			if (errno == EAGAIN)
+				return 0;
+			return -1;
+		}
+		conn->sent += n;
+	}
+	return 1;
+}
+
+static void conn_respond(struct metrics_conn *conn)
+{
+	ping_setup_data *setup_data = metrics.setup_data;
+	struct metrics_target *targets;
+	const char *status = "200 OK", *type;
+	int openmetrics = 0, i, head;
+	size_t body;
+	char *eol;
+
+	eol = strstr(conn->request, "\r\n");
+	*eol = '\0';
+	if (strncmp(conn->request, "GET ", 4))
+		status = "405 Method Not Allowed";
+	else if (strncmp(conn->request + 4, "/metrics", 8) ||
+		 (conn->request[12] != ' ' && conn->request[12] != '?'))
+		status = "404 Not Found";
+	*eol = '\r';
+
+	if (strstr(conn->request, "application/openmetrics-text"))
+		openmetrics = 1;
+	type = openmetrics ? "application/openmetrics-text; version=1.0.0; charset=utf-8" :
+			     "text/plain; version=0.0.4; charset=utf-8";
+
+	/* Room for the head, filled in once the length of the body is known */
+	head = 256;
+	out_grow(conn, head);
+	conn->response_len = head;
+
+	if (!strcmp(status, "200 OK")) {
+		long long now = timer_wheel_clock() / 1000;
+
+		targets = calloc(setup_data->targets.count, sizeof(*targets));
+		if (!targets)
+			error(2, errno, _("memory allocation failed"));
+		for (i = 0; i < setup_data->targets.count; i++)
+			snapshot_target(setup_data->targets.list[i], &targets[i], now);
+		format_metrics(conn, targets, setup_data->targets.count, openmetrics);
+		free(targets);
+	} else {
+		type = "text/plain; charset=utf-8";
+		out_printf(conn, "%s\n", status);
+	}
+
+	body = conn->response_len - head;
+	conn->response_len = 0;
+	out_printf(conn, "HTTP/1.1 %s\r\nContent-Type: %s\r\nContent-Length: %zu\r\n"
+		   "Connection: close\r\n\r\n", status, type, body);
+	/* Close the gap between the head and the body. */
+	memmove(conn->response + conn->response_len, conn->response + head, body);
+	conn->response_len += body;
+	conn->sent = 0;
+}
+
+static void conn_event(event_source *source, uint32_t events)
+{
+	struct metrics_conn *conn = source->data;
+	ssize_t n;
+
+	if (conn->response) {
+		if (conn_send(conn))
+			conn_close(conn);
+		return;
+	}
+
+	n = recv(source->fd, conn->request + conn->request_len,
+		 sizeof(conn->request) - 1 - conn->request_len, MSG_DONTWAIT);
+	if (n < 0 && (errno == EAGAIN || errno == EINTR))
+		return;
+	if (n <= 0 || (events & (EPOLLERR | EPOLLHUP) && !(events & EPOLLIN))) {
+		conn_close(conn);
+		return;
+	}
+	conn->request_len += n;
+	conn->request[conn->request_len] = '\0';
+	if (!strstr(conn->request, "\r\n\r\n")) {
+		if (conn->request_len == sizeof(conn->request) - 1)
+			conn_close(conn);
+		return;
+	}
+
+	conn_respond(conn);
+	switch (conn_send(conn)) {
+	case 0:
+		/* The rest when there is room for it */
+		event_del(metrics.epfd, source);
+		event_add(metrics.epfd, source, EPOLLOUT);
+		break;
+	default:
+		conn_close(conn);
+	}
+}
+
+/* Too slow to send its request or to take the response */
+static void conn_expired(struct timer_entry *timer)
+{
+	conn_close(timer->data);
+}
+
+static void listen_event(event_source *source, uint32_t events __attribute__((__unused__)))
+{
+	struct metrics_conn *conn = NULL;
+	int fd, i;
+
+	fd = accept4(source->fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+	if (fd < 0)
+		return;
+	for (i = 0; i < METRICS_CONNS; i++) {
+		struct metrics_conn *c = &metrics.conns[i];
+
+		if (c->source.fd == -1) {
+			conn = c;
+			break;
+		}
+		if (!conn || c->timer.expires < conn->timer.expires)
+			conn = c;
+	}
+	/* All taken: the oldest goes. */
+	if (conn->source.fd != -1)
+		conn_close(conn);
+
+	conn->source.fd = fd;
+	conn->source.handler = conn_event;
+	conn->source.data = conn;
+	conn->request_len = 0;
+	conn->response = NULL;
+	conn->response_len = conn->sent = conn->size = 0;
+	event_add(metrics.epfd, &conn->source, EPOLLIN);
+	timer_init(&conn->timer, conn_expired, conn);
+	timer_add(&metrics.setup_data->wheel, &conn->timer, timer_wheel_clock() + METRICS_TIMEOUT);
+	/* The wheel may not be due to run again before then. */
+	ping_reschedule(metrics.setup_data);
+}
+
+/*
+ * ping_metrics_register --
+ *	Take scrapes on the event loop "epfd" of the probes, if -E was given.
+ */
+void ping_metrics_register(ping_setup_data *setup_data, int epfd)
+{
+	if (metrics.fd < 0)
+		return;
+	metrics.epfd = epfd;
+	metrics.setup_data = setup_data;
+	metrics.source.fd = metrics.fd;
+	metrics.source.handler = listen_event;
+	metrics.source.data = NULL;
+	event_add(epfd, &metrics.source, EPOLLIN);
+}
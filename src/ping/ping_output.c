@@ -0,0 +1,395 @@
+/*
+ * Headless output.
+ *
+ * With -o the screen is left out altogether and every reply, lost probe
+ * and ICMP error becomes a record on stdout, together with a summary of
+ * each target every -i seconds, as JSON Lines or CSV.  All records share
+ * one set of columns, so CSV gets a single header row and JSON simply
+ * leaves out what a record does not have.  Records are formatted straight
+ * into one large buffer, which is written out when it fills up and by a
+ * timer, never per record.
+ */
+#include "iputils_common.h"
+#include "ping.h"
+
+#define PING_OUTPUT_BUF		(256 * 1024)
+#define PING_OUTPUT_FLUSH	500		/* msec */
+
+/* What a record does not have */
+#define NONE	LLONG_MIN
+
+struct record {
+	const char *type;
+	struct ping_rts *rts;
+	const char *from;
+	long long seq, bytes, ttl, rtt, dup, icmp_type, icmp_code;
+	long long transmitted, received, duplicates, errors;
+	double loss;			/* percent, NAN if none */
+	long long rtt_min, rtt_avg, rtt_max, rtt_mdev, rtt_ewma;
+	long long rtt_p50, rtt_p90, rtt_p99, jitter;
+	long long ipdv_p50, ipdv_p99, ipdv_min, ipdv_max;
+	long long reordered, reorder_max, loss_run_max;
+};
+
+enum column_kind {
+	COLUMN_STR,
+	COLUMN_INT,
+	COLUMN_MSEC,			/* nsec, written as msec */
+	COLUMN_PERCENT,
+	COLUMN_BOOL,
+};
+
+static const struct column {
+	const char *name;
+	enum column_kind kind;
+	size_t offset;
+} columns[] = {
+#define COLUMN(name, kind)	{ #name, kind, offsetof(struct record, name) }
+	COLUMN(seq, COLUMN_INT),
+	COLUMN(from, COLUMN_STR),
+	COLUMN(bytes, COLUMN_INT),
+	COLUMN(ttl, COLUMN_INT),
+	COLUMN(rtt, COLUMN_MSEC),
+	COLUMN(dup, COLUMN_BOOL),
+	COLUMN(icmp_type, COLUMN_INT),
+	COLUMN(icmp_code, COLUMN_INT),
+	COLUMN(transmitted, COLUMN_INT),
+	COLUMN(received, COLUMN_INT),
+	COLUMN(duplicates, COLUMN_INT),
+	COLUMN(errors, COLUMN_INT),
+	COLUMN(loss, COLUMN_PERCENT),
+	COLUMN(rtt_min, COLUMN_MSEC),
+	COLUMN(rtt_avg, COLUMN_MSEC),
+	COLUMN(rtt_max, COLUMN_MSEC),
+	COLUMN(rtt_mdev, COLUMN_MSEC),
+	COLUMN(rtt_ewma, COLUMN_MSEC),
+	COLUMN(rtt_p50, COLUMN_MSEC),
+	COLUMN(rtt_p90, COLUMN_MSEC),
+	COLUMN(rtt_p99, COLUMN_MSEC),
+	COLUMN(jitter, COLUMN_MSEC),
+	COLUMN(ipdv_p50, COLUMN_MSEC),
+	COLUMN(ipdv_p99, COLUMN_MSEC),
+	COLUMN(ipdv_min, COLUMN_MSEC),
+	COLUMN(ipdv_max, COLUMN_MSEC),
+	COLUMN(reordered, COLUMN_INT),
+	COLUMN(reorder_max, COLUMN_INT),
+	COLUMN(loss_run_max, COLUMN_INT),
+#undef COLUMN
+};
+
+static struct {
+	char buf[PING_OUTPUT_BUF];
+	size_t len;
+} out;
+
+static void out_flush(void)
+{
+	size_t done = 0;
+	ssize_t n;
+
+	while (done < out.len) {
+		n = write(STDOUT_FILENO, out.buf + done, out.len - done);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			error(2, errno, _("write error"));
+		}
+		done += n;
+	}
+	out.len = 0;
+}
+
+static inline void out_putc(char c)
+{
+	if (out.len == sizeof(out.buf))
+		out_flush();
+	out.buf[out.len++] = c;
+}
+
+static void out_puts(const char *s)
+{
+	while (*s)
+		out_putc(*s++);
+}
+
+static void out_string(int format, const char *s)
+{
+	if (format == PING_OUTPUT_CSV) {
+		if (!strpbrk(s, ",\"\r\n")) {
+			out_puts(s);
+			return;
+		}
+		out_putc('"');
+		for (; *s; s++) {
+			if (*s == '"')
+				out_putc('"');
+			out_putc(*s);
+		}
+		out_putc('"');
+		return;
+	}
+
+	out_putc('"');
+	for (; *s; s++) {
+		unsigned char c = *s;
+
+		if (c == '"' || c == '\\') {
+			out_putc('\\');
+			out_putc(c);
+		} else if (c < 0x20) {
+			char esc[8];
+
+			snprintf(esc, sizeof(esc), "\\u%04x", c);
+			out_puts(esc);
+		} else {
+			out_putc(c);
+		}
+	}
+	out_putc('"');
+}
+
+/* Format column "col" of "rec" into "buf"; returns 0 if the record has none. */
+static int format_column(const struct column *col, const struct record *rec, char *buf, size_t len)
+{
+	const char *base = (const char *)rec + col->offset;
+	long long v;
+	double d;
+
+	switch (col->kind) {
+	case COLUMN_STR:
+		return *(const char *const *)base != NULL;
+	case COLUMN_PERCENT:
+		memcpy(&d, base, sizeof(d));
+		if (isnan(d))
+			return 0;
+		snprintf(buf, len, "%g", d);
+		return 1;
+	default:
+		break;
+	}
+
+	memcpy(&v, base, sizeof(v));
+	if (v == NONE)
+		return 0;
+	if (col->kind == COLUMN_MSEC)
+		snprintf(buf, len, "%s%lld.%06lld", v < 0 ? "-" : "", llabs(v) / 1000000,
+			 llabs(v) % 1000000);
+	else if (col->kind == COLUMN_BOOL)
+		snprintf(buf, len, "%s", v ? "true" : "false");
+	else
+		snprintf(buf, len, "%lld", v);
+	return 1;
+}
+
+static void record_write(const struct record *rec)
+{
+	int format = rec->rts->output;
+	struct timespec now;
+	char buf[64];
+	size_t i;
+
+	clock_gettime(CLOCK_REALTIME, &now);
+	snprintf(buf, sizeof(buf), "%lld.%06ld", (long long)now.tv_sec, now.tv_nsec / 1000);
+
+	if (format == PING_OUTPUT_CSV) {
+		out_puts(rec->type);
+		out_putc(',');
+		out_puts(buf);
+		out_putc(',');
+		out_string(format, rec->rts->target);
+		for (i = 0; i < ARRAY_SIZE(columns); i++) {
+			out_putc(',');
+			if (!format_column(&columns[i], rec, buf, sizeof(buf)))
+				continue;
+			if (columns[i].kind == COLUMN_STR)
+				out_string(format, *(const char *const *)((const char *)rec + columns[i].offset));
+			else
+				out_puts(buf);
+		}
+		out_putc('\n');
+		return;
+	}
+
+	out_puts("{\"type\":\"");
+	out_puts(rec->type);
+	out_puts("\",\"time\":");
+	out_puts(buf);
+	out_puts(",\"target\":");
+	out_string(format, rec->rts->target);
+	for (i = 0; i < ARRAY_SIZE(columns); i++) {
+		if (!format_column(&columns[i], rec, buf, sizeof(buf)))
+			continue;
+		out_puts(",\"");
+		out_puts(columns[i].name);
+		out_puts("\":");
+		if (columns[i].kind == COLUMN_STR)
+			out_string(format, *(const char *const *)((const char *)rec + columns[i].offset));
+		else
+			out_puts(buf);
+	}
+	out_puts("}\n");
+}
+
+static void record_init(struct record *rec, const char *type, struct ping_rts *rts)
+{
+	rec->type = type;
+	rec->rts = rts;
+	rec->from = NULL;
+	rec->seq = rec->bytes = rec->ttl = rec->rtt = rec->dup = NONE;
+	rec->icmp_type = rec->icmp_code = NONE;
+	rec->transmitted = rec->received = rec->duplicates = rec->errors = NONE;
+	rec->loss = NAN;
+	rec->rtt_min = rec->rtt_avg = rec->rtt_max = rec->rtt_mdev = rec->rtt_ewma = NONE;
+	rec->rtt_p50 = rec->rtt_p90 = rec->rtt_p99 = rec->jitter = NONE;
+	rec->ipdv_p50 = rec->ipdv_p99 = rec->ipdv_min = rec->ipdv_max = NONE;
+	rec->reordered = rec->reorder_max = rec->loss_run_max = NONE;
+}
+
+/*
+ * ping_output_reply --
+ *	Reply "seq" of "cc" bytes came in from "from"; "rtt" is -1 if the
+ * probe carried no time stamp, "ttl" -1 if unknown.
+ */
+void ping_output_reply(struct ping_rts *rts, long seq, int cc, int ttl, long long rtt,
+		       const char *from, int dup)
+{
+	struct record rec;
+
+	record_init(&rec, "reply", rts);
+	rec.seq = seq;
+	rec.bytes = cc;
+	rec.from = from;
+	if (ttl >= 0)
+		rec.ttl = ttl;
+	if (rtt >= 0)
+		rec.rtt = rtt;
+	rec.dup = dup;
+	record_write(&rec);
+}
+
+void ping_output_timeout(struct ping_rts *rts, long seq)
+{
+	struct record rec;
+
+	record_init(&rec, "timeout", rts);
+	rec.seq = seq;
+	record_write(&rec);
+}
+
+/* Probe "seq" drew an ICMP error "type"/"code" from "sa". */
+void ping_output_error(struct ping_rts *rts, long seq, const void *sa, int type, int code)
+{
+	const struct sockaddr *s = sa;
+	char from[INET6_ADDRSTRLEN];
+	struct record rec;
+
+	record_init(&rec, "error", rts);
+	rec.seq = seq;
+	rec.icmp_type = type;
+	rec.icmp_code = code;
+	if (s->sa_family == AF_INET)
+		rec.from = inet_ntop(AF_INET, &((const struct sockaddr_in *)sa)->sin_addr,
+				     from, sizeof(from));
+	else if (s->sa_family == AF_INET6)
+		rec.from = inet_ntop(AF_INET6, &((const struct sockaddr_in6 *)sa)->sin6_addr,
+				     from, sizeof(from));
+	record_write(&rec);
+}
+
+static void ping_output_summary(struct ping_rts *rts)
+{
+	struct record rec;
+
+	record_init(&rec, "summary", rts);
+	rec.transmitted = rts->ntransmitted;
+	rec.received = rts->nreceived;
+	rec.duplicates = rts->nrepeats;
+	rec.errors = rts->nerrors;
+	if (rts->ntransmitted)
+		rec.loss = packet_loss(rts);
+	if (rts->nreceived && rts->timing) {
+		rec.rtt_min = rts->stats.min;
+		rec.rtt_avg = ping_stats_mean(&rts->stats);
+		rec.rtt_max = rts->stats.max;
+		rec.rtt_mdev = ping_stats_mdev(&rts->stats);
+		rec.rtt_ewma = ping_stats_ewma(&rts->stats);
+		rec.jitter = ping_jitter_value(&rts->jitter);
+	}
+	if (rts->hist) {
+		rec.rtt_p50 = ping_hist_percentile(rts->hist, 50);
+		rec.rtt_p90 = ping_hist_percentile(rts->hist, 90);
+		rec.rtt_p99 = ping_hist_percentile(rts->hist, 99);
+	}
+	/* As finish() shows them */
+	if (rts->jitter.ipdv) {
+		rec.ipdv_p50 = ping_hist_percentile(rts->jitter.ipdv, 50);
+		rec.ipdv_p99 = ping_hist_percentile(rts->jitter.ipdv, 99);
+		rec.ipdv_min = rts->jitter.ipdv_min;
+		rec.ipdv_max = rts->jitter.ipdv_max;
+	}
+	rec.reordered = rts->jitter.reordered;
+	rec.reorder_max = rts->jitter.reorder_max;
+	rec.loss_run_max = rts->loss.longest;
+	record_write(&rec);
+}
+
+static void summary_event(event_source *source, uint32_t events __attribute__((__unused__)))
+{
+	ping_setup_data *setup_data = source->data;
+	int i;
+
+	event_timer_read(source);
+	for (i = 0; i < setup_data->targets.count; i++)
+		ping_output_summary(setup_data->targets.list[i]);
+}
+
+static void flush_event(event_source *source, uint32_t events __attribute__((__unused__)))
+{
+	event_timer_read(source);
+	out_flush();
+}
+
+/*
+ * ping_output_run --
+ *	Ping the targets without a screen, with a summary every "interval"
+ * seconds, until interrupted or the -w deadline.  Returns the exit status.
+ */
+int ping_output_run(ping_setup_data *setup_data, double interval)
+{
+	struct ping_rts *first = setup_data->targets.list[0];
+	event_source summary_timer, flush_timer;
+	long msec = interval * 1000;
+	int epfd, i;
+
+	if (first->output == PING_OUTPUT_CSV) {
+		out_puts("type,time,target");
+		for (i = 0; i < (int)ARRAY_SIZE(columns); i++) {
+			out_putc(',');
+			out_puts(columns[i].name);
+		}
+		out_putc('\n');
+	}
+
+	epfd = event_loop_create();
+	ping_register_events(setup_data, epfd);
+
+	if (msec < 100)
+		msec = 100;
+	event_timer_init(&summary_timer, summary_event, setup_data);
+	event_add(epfd, &summary_timer, EPOLLIN);
+	event_timer_arm(&summary_timer, msec, msec);
+
+	event_timer_init(&flush_timer, flush_event, NULL);
+	event_add(epfd, &flush_timer, EPOLLIN);
+	event_timer_arm(&flush_timer, PING_OUTPUT_FLUSH, PING_OUTPUT_FLUSH);
+
+	while (!global_rts->exiting) {
+		if (event_dispatch(epfd, -1) < 0 && errno != EINTR)
+			error(2, errno, "epoll_wait");
+	}
+
+	for (i = 0; i < setup_data->targets.count; i++)
+		ping_output_summary(setup_data->targets.list[i]);
+	out_flush();
+	return ping_exit_status(setup_data);
+}
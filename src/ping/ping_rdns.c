@@ -0,0 +1,266 @@
+/*
+ * Reverse DNS.
+ *
+ * Names are looked up by a resolver thread, never on the receive path:
+ * a lookup that misses the cache queues the address and returns at once,
+ * and the reply is shown with its numeric address until the name is in.
+ * The cache holds PING_RDNS_ENTRIES addresses and drops the least recently
+ * used one to make room.  Addresses without a name are cached as such for
+ * a shorter time, so a dead resolver is not asked again for every reply.
+ */
+#include <pthread.h>
+
+#include "iputils_common.h"
+#include "ping.h"
+
+#define PING_RDNS_ENTRIES	256
+#define PING_RDNS_HASH		512
+#define PING_RDNS_QUEUE		64
+#define PING_RDNS_TTL		(10 * 60 * 1000)	/* msec, a name */
+#define PING_RDNS_NEG_TTL	(60 * 1000)		/* msec, no name */
+#define PING_RDNS_WAIT		(30 * 1000)		/* msec, asked for */
+
+enum {
+	RDNS_FREE,
+	RDNS_PENDING,
+	RDNS_NAME,
+	RDNS_NONAME,
+};
+
+struct rdns_key {
+	sa_family_t family;
+	uint32_t scope_id;
+	unsigned char addr[16];
+};
+
+struct rdns_entry {
+	struct rdns_key key;
+	struct sockaddr_storage sa;
+	socklen_t salen;
+	int state;
+	uint64_t expires;		/* wheel clock, msec */
+	int hnext;			/* hash chain */
+	int prev, next;			/* LRU list, most recent first */
+	char name[NI_MAXHOST];
+};
+
+struct rdns_request {
+	struct rdns_key key;
+	struct sockaddr_storage sa;
+	socklen_t salen;
+};
+
+static struct {
+	pthread_mutex_t lock;
+	pthread_cond_t wake;
+	int inited;
+	int started;			/* -1 if the thread could not be made */
+	int hash[PING_RDNS_HASH];
+	int head, tail;			/* LRU list */
+	struct rdns_entry entries[PING_RDNS_ENTRIES];
+	struct rdns_request queue[PING_RDNS_QUEUE];
+	unsigned int qhead, qlen;
+} rdns = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.wake = PTHREAD_COND_INITIALIZER,
+};
+
+static int rdns_make_key(const void *sa, socklen_t salen, struct rdns_key *key)
+{
+	const struct sockaddr *s = sa;
+
+	memset(key, 0, sizeof(*key));
+	key->family = s->sa_family;
+	if (s->sa_family == AF_INET && salen >= sizeof(struct sockaddr_in)) {
+		memcpy(key->addr, &((const struct sockaddr_in *)sa)->sin_addr, 4);
+		return 0;
+	}
+	if (s->sa_family == AF_INET6 && salen >= sizeof(struct sockaddr_in6)) {
+		const struct sockaddr_in6 *sin6 = sa;
+
+		memcpy(key->addr, &sin6->sin6_addr, 16);
+		key->scope_id = sin6->sin6_scope_id;
+		return 0;
+	}
+	return -1;
+}
+
+static unsigned int rdns_hash(const struct rdns_key *key)
+{
+	uint32_t h = 2166136261U;	/* FNV-1a */
+	const unsigned char *p = (const unsigned char *)key;
+	size_t i;
+
+	for (i = 0; i < sizeof(*key); i++)
+		h = (h ^ p[i]) * 16777619U;
+	return h % PING_RDNS_HASH;
+}
+
+static void lru_unlink(int i)
+{
+	struct rdns_entry *e = &rdns.entries[i];
+
+	if (e->prev >= 0)
+		rdns.entries[e->prev].next = e->next;
+	else
+		rdns.head = e->next;
+	if (e->next >= 0)
+		rdns.entries[e->next].prev = e->prev;
+	else
+		rdns.tail = e->prev;
+}
+
+static void lru_push(int i)
+{
+	struct rdns_entry *e = &rdns.entries[i];
+
+	e->prev = -1;
+	e->next = rdns.head;
+	if (rdns.head >= 0)
+		rdns.entries[rdns.head].prev = i;
+	rdns.head = i;
+	if (rdns.tail < 0)
+		rdns.tail = i;
+}
+
+static void rdns_init(void)
+{
+	int i;
+
+	for (i = 0; i < PING_RDNS_HASH; i++)
+		rdns.hash[i] = -1;
+	rdns.head = rdns.tail = -1;
+	rdns.inited = 1;
+	for (i = 0; i < PING_RDNS_ENTRIES; i++) {
+		rdns.entries[i].hnext = -1;
+		lru_push(i);
+	}
+}
+
+static int rdns_find(const struct rdns_key *key)
+{
+	int i;
+
+	for (i = rdns.hash[rdns_hash(key)]; i >= 0; i = rdns.entries[i].hnext)
+		if (!memcmp(&rdns.entries[i].key, key, sizeof(*key)))
+			return i;
+	return -1;
+}
+
+/* Take the least recently used entry for "key". */
+static int rdns_evict(const struct rdns_key *key)
+{
+	int i = rdns.tail;
+	struct rdns_entry *e = &rdns.entries[i];
+	int *pp;
+
+	if (e->state != RDNS_FREE) {
+		for (pp = &rdns.hash[rdns_hash(&e->key)]; *pp != i; pp = &rdns.entries[*pp].hnext)
+			;
+		*pp = e->hnext;
+	}
+	e->key = *key;
+	e->name[0] = '\0';
+	e->hnext = rdns.hash[rdns_hash(key)];
+	rdns.hash[rdns_hash(key)] = i;
+	return i;
+}
+
+static void *rdns_thread(void *arg __attribute__((__unused__)))
+{
+	pthread_mutex_lock(&rdns.lock);
+	for (;;) {
+		struct rdns_request req;
+		char name[NI_MAXHOST];
+		int ret, i;
+
+		while (!rdns.qlen)
+			pthread_cond_wait(&rdns.wake, &rdns.lock);
+		req = rdns.queue[rdns.qhead];
+		rdns.qhead = (rdns.qhead + 1) % PING_RDNS_QUEUE;
+		rdns.qlen--;
+		pthread_mutex_unlock(&rdns.lock);
+
+		ret = getnameinfo((struct sockaddr *)&req.sa, req.salen, name, sizeof(name),
+				  NULL, 0, getnameinfo_flags | NI_NAMEREQD);
+
+		pthread_mutex_lock(&rdns.lock);
+		/* It may have been dropped from the cache meanwhile. */
+		i = rdns_find(&req.key);
+		if (i < 0 || rdns.entries[i].state != RDNS_PENDING)
+			continue;
+		if (ret) {
+			rdns.entries[i].name[0] = '\0';
+			rdns.entries[i].state = RDNS_NONAME;
+			rdns.entries[i].expires = timer_wheel_clock() + PING_RDNS_NEG_TTL;
+		} else {
+			strcpy(rdns.entries[i].name, name);
+			rdns.entries[i].state = RDNS_NAME;
+			rdns.entries[i].expires = timer_wheel_clock() + PING_RDNS_TTL;
+		}
+	}
+	return NULL;
+}
+
+/* Hand entry "i" to the resolver thread; if it is busy, it is asked again later. */
+static void rdns_request(int i, uint64_t now)
+{
+	struct rdns_entry *e = &rdns.entries[i];
+	struct rdns_request *req;
+
+	/* Until queued, the next lookup of it asks again. */
+	e->state = RDNS_PENDING;
+	e->expires = now;
+	if (!rdns.started)
+		rdns.started = ping_thread_start(rdns_thread, NULL) ? -1 : 1;
+	if (rdns.started < 0 || rdns.qlen == PING_RDNS_QUEUE)
+		return;
+	e->expires = now + PING_RDNS_WAIT;
+	req = &rdns.queue[(rdns.qhead + rdns.qlen++) % PING_RDNS_QUEUE];
+	req->key = e->key;
+	req->sa = e->sa;
+	req->salen = e->salen;
+	pthread_cond_signal(&rdns.wake);
+}
+
+/*
+ * ping_rdns_lookup --
+ *	Copy the name of address "sa" to "name" and return 1 if it is known.
+ * Otherwise return 0, the lookup being under way or known to fail.
+ */
+int ping_rdns_lookup(const void *sa, socklen_t salen, char *name, size_t len)
+{
+	uint64_t now = timer_wheel_clock();
+	struct rdns_key key;
+	struct rdns_entry *e;
+	int i, found = 0;
+
+	if (rdns_make_key(sa, salen, &key) || salen > sizeof(e->sa))
+		return 0;
+
+	pthread_mutex_lock(&rdns.lock);
+	if (!rdns.inited)
+		rdns_init();
+
+	i = rdns_find(&key);
+	if (i < 0) {
+		i = rdns_evict(&key);
+		e = &rdns.entries[i];
+		memcpy(&e->sa, sa, salen);
+		e->salen = salen;
+		rdns_request(i, now);
+	} else {
+		e = &rdns.entries[i];
+		if (now >= e->expires)
+			rdns_request(i, now);
+		/* A name being looked up again is shown meanwhile. */
+		if (e->name[0]) {
+			snprintf(name, len, "%s", e->name);
+			found = 1;
+		}
+	}
+	lru_unlink(i);
+	lru_push(i);
+	pthread_mutex_unlock(&rdns.lock);
+	return found;
+}
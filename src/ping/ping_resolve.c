@@ -0,0 +1,251 @@
+/*
+ * Re-resolution of target names.
+ *
+ * A target given by name is looked up again whenever the DNS records its
+ * address came from expire, so that probes follow a failover or anycast
+ * change.  The lookups run on a resolver thread; the target's timer only
+ * hands the name over and then checks back for the answer.  A changed
+ * address is switched to in place: the sockets, sequence numbers and all
+ * statistics carry on, and the change is reported on the target's text.
+ * A target whose address family is gone from the DNS moves to the other
+ * one, on the socket ping_initialize() opened for it, if it did.
+ */
+#include <pthread.h>
+#include <arpa/nameser.h>
+#include <resolv.h>
+
+#include "iputils_common.h"
+#include "ping.h"
+
+#define PING_RESOLVE_MIN	(10 * 1000)	/* msec */
+#define PING_RESOLVE_MAX	(60 * 60 * 1000)
+#define PING_RESOLVE_DEFAULT	(60 * 1000)	/* no TTL from the DNS */
+#define PING_RESOLVE_POLL	100			/* msec, waiting for it */
+
+enum {
+	RESOLVE_IDLE,
+	RESOLVE_QUEUED,
+	RESOLVE_DONE,
+};
+
+static struct {
+	pthread_mutex_t lock;
+	pthread_cond_t wake;
+	int started;			/* -1 if the thread could not be made */
+	struct ping_rts *queue, **queue_tail;
+	ping_setup_data *setup_data;
+} resolver = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.wake = PTHREAD_COND_INITIALIZER,
+	.queue_tail = &resolver.queue,
+};
+
+/* The lowest TTL of the answers for "name", in msec, or 0 if unknown.  The
+ * search list is applied as getaddrinfo() does, so short names get one too. */
+static long resolve_ttl(res_state res, const char *name, int family)
+{
+	unsigned char answer[NS_PACKETSZ * 4];
+	ns_msg msg;
+	ns_rr rr;
+	long ttl = 0;
+	int len, i;
+
+	len = res_nsearch(res, name, ns_c_in, family == AF_INET ? ns_t_a : ns_t_aaaa,
+			  answer, sizeof(answer));
+	if (len < 0 || len > (int)sizeof(answer) || ns_initparse(answer, len, &msg) < 0)
+		return 0;
+	for (i = 0; i < ns_msg_count(msg, ns_s_an); i++) {
+		if (ns_parserr(&msg, ns_s_an, i, &rr) < 0)
+			break;
+		if (!ttl || (long)ns_rr_ttl(rr) * 1000 < ttl)
+			ttl = (long)ns_rr_ttl(rr) * 1000;
+	}
+	return ttl;
+}
+
+/* Look up "rts" the way it was at the start, keeping the addresses of its
+ * family, or failing that of the other one. */
+static void resolve(res_state res, struct ping_rts *rts, struct ping_resolve *out)
+{
+	struct addrinfo hints = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_RAW };
+	struct addrinfo *result, *ai;
+	int family = rts->ipv4 ? AF_INET : AF_INET6;
+
+	out->naddrs = 0;
+	out->ttl = 0;
+	out->family = family;
+	out->error = getaddrinfo(rts->target, NULL, &hints, &result);
+	if (out->error)
+		return;
+	for (;;) {
+		for (ai = result; ai && out->naddrs < PING_RESOLVE_ADDRS; ai = ai->ai_next) {
+			if (ai->ai_family != out->family || ai->ai_addrlen > sizeof(out->addrs[0]))
+				continue;
+			memcpy(&out->addrs[out->naddrs++], ai->ai_addr, ai->ai_addrlen);
+		}
+		if (out->naddrs || out->family != family)
+			break;
+		out->family = family == AF_INET ? AF_INET6 : AF_INET;
+	}
+	freeaddrinfo(result);
+	out->ttl = resolve_ttl(res, rts->target, out->family);
+}
+
+static void *resolver_thread(void *arg __attribute__((__unused__)))
+{
+	struct __res_state res;
+
+	memset(&res, 0, sizeof(res));
+	res_ninit(&res);
+
+	pthread_mutex_lock(&resolver.lock);
+	for (;;) {
+		struct ping_resolve result;
+		struct ping_rts *rts;
+
+		while (!resolver.queue)
+			pthread_cond_wait(&resolver.wake, &resolver.lock);
+		rts = resolver.queue;
+		resolver.queue = rts->resolve.next;
+		if (!resolver.queue)
+			resolver.queue_tail = &resolver.queue;
+		pthread_mutex_unlock(&resolver.lock);
+
+		resolve(&res, rts, &result);
+
+		pthread_mutex_lock(&resolver.lock);
+		memcpy(rts->resolve.addrs, result.addrs, sizeof(result.addrs));
+		rts->resolve.naddrs = result.naddrs;
+		rts->resolve.family = result.family;
+		rts->resolve.error = result.error;
+		rts->resolve.ttl = result.ttl;
+		rts->resolve.state = RESOLVE_DONE;
+	}
+	return NULL;
+}
+
+static const void *resolve_addr(const struct sockaddr_storage *ss)
+{
+	if (ss->ss_family == AF_INET)
+		return &((const struct sockaddr_in *)ss)->sin_addr;
+	return &((const struct sockaddr_in6 *)ss)->sin6_addr;
+}
+
+static const void *target_addr(const struct ping_rts *rts)
+{
+	if (rts->ipv4)
+		return &rts->whereto.sin_addr;
+	return &rts->whereto6.sin6_addr;
+}
+
+/* Act on the answer in rts->resolve; returns msec until the next lookup. */
+static long resolve_apply(struct ping_rts *rts)
+{
+	struct ping_resolve *r = &rts->resolve;
+	int family = rts->ipv4 ? AF_INET : AF_INET6;
+	size_t len = rts->ipv4 ? sizeof(struct in_addr) : sizeof(struct in6_addr);
+	char from[INET6_ADDRSTRLEN], to[INET6_ADDRSTRLEN];
+	long ttl = r->ttl ? r->ttl : PING_RESOLVE_DEFAULT;
+	int i, problem = 0;
+
+	if (ttl < PING_RESOLVE_MIN)
+		ttl = PING_RESOLVE_MIN;
+	if (ttl > PING_RESOLVE_MAX)
+		ttl = PING_RESOLVE_MAX;
+
+	if (!r->error && r->naddrs && r->family != family) {
+		if (!ping_target_move(resolver.setup_data, rts, &r->addrs[0])) {
+			inet_ntop(r->family, resolve_addr(&r->addrs[0]), to, sizeof(to));
+			print_timestamp(rts);
+			ping_printf(rts, _("%s: no IPv%d address any more, moved to %s\n"),
+				    rts->target, family == AF_INET ? 4 : 6, to);
+			r->problem = 0;
+			return ttl;
+		}
+		r->naddrs = 0;		/* none of its own family */
+	}
+
+	if (r->error || !r->naddrs) {
+		problem = 1;
+		if (!r->problem) {
+			inet_ntop(family, target_addr(rts), from, sizeof(from));
+			print_timestamp(rts);
+			if (r->error)
+				ping_printf(rts, _("%s: %s, staying with %s\n"), rts->target,
+					    gai_strerror(r->error), from);
+			else
+				ping_printf(rts, _("%s: no IPv%d address any more, staying with %s\n"),
+					    rts->target, rts->ipv4 ? 4 : 6, from);
+		}
+		r->problem = problem;
+		return r->error ? PING_RESOLVE_MIN : ttl;
+	}
+	r->problem = 0;
+
+	for (i = 0; i < r->naddrs; i++)
+		if (!memcmp(resolve_addr(&r->addrs[i]), target_addr(rts), len))
+			return ttl;
+
+	inet_ntop(family, target_addr(rts), from, sizeof(from));
+	inet_ntop(family, resolve_addr(&r->addrs[0]), to, sizeof(to));
+	print_timestamp(rts);
+	ping_printf(rts, _("%s: address changed from %s to %s\n"), rts->target, from, to);
+
+	if (rts->ipv4) {
+		rts->whereto.sin_addr = ((struct sockaddr_in *)&r->addrs[0])->sin_addr;
+	} else {
+		struct sockaddr_in6 *sin6 = (struct sockaddr_in6 *)&r->addrs[0];
+
+		rts->whereto6.sin6_addr = sin6->sin6_addr;
+		rts->whereto6.sin6_scope_id = sin6->sin6_scope_id;
+	}
+	ping_targets_rehash(rts->targets);
+	return ttl;
+}
+
+static void ping_resolve_timer(struct timer_entry *timer)
+{
+	struct ping_rts *rts = timer->data;
+	long next = PING_RESOLVE_POLL;
+
+	pthread_mutex_lock(&resolver.lock);
+	switch (rts->resolve.state) {
+	case RESOLVE_IDLE:
+		if (!resolver.started)
+			resolver.started = ping_thread_start(resolver_thread, NULL) ? -1 : 1;
+		if (resolver.started < 0) {
+			pthread_mutex_unlock(&resolver.lock);
+			return;
+		}
+		rts->resolve.state = RESOLVE_QUEUED;
+		rts->resolve.next = NULL;
+		*resolver.queue_tail = rts;
+		resolver.queue_tail = &rts->resolve.next;
+		pthread_cond_signal(&resolver.wake);
+		break;
+	case RESOLVE_DONE:
+		rts->resolve.state = RESOLVE_IDLE;
+		next = resolve_apply(rts);
+		break;
+	}
+	pthread_mutex_unlock(&resolver.lock);
+	timer_add(rts->wheel, timer, rts->wheel->now + next);
+}
+
+/*
+ * ping_resolve_init --
+ *	Start looking up "rts" again from wheel time "now" on, unless it was
+ * given as an address.
+ */
+void ping_resolve_init(ping_setup_data *setup_data, struct ping_rts *rts, uint64_t now)
+{
+	unsigned char buf[sizeof(struct in6_addr)];
+
+	resolver.setup_data = setup_data;
+	if (inet_pton(AF_INET, rts->target, buf) == 1 ||
+	    inet_pton(AF_INET6, rts->target, buf) == 1 ||
+	    rts->multicast || rts->broadcast_pings)
+		return;
+	timer_init(&rts->resolve_timer, ping_resolve_timer, rts);
+	timer_add(rts->wheel, &rts->resolve_timer, now);
+}
@@ -0,0 +1,134 @@
+/*
+ * Live statistics in shared memory.
+ *
+ * With -z the counters and round trip times of every target are kept in a
+ * POSIX shared memory object, see ping_shm.h, for other processes on the
+ * host to read with a plain memory copy.  Each target has a seqlock of its
+ * own: the measurement thread, the only writer, makes its sequence number
+ * odd, rewrites the target and makes it even again, so an update costs a
+ * few stores and never waits on a reader.  The object is removed at exit.
+ */
+#include <fcntl.h>
+#include <sys/mman.h>
+
+#include "iputils_common.h"
+#include "ping.h"
+
+static struct {
+	char *name;			/* with the leading '/' */
+	struct ping_shm_header *header;	/* NULL: no -z */
+	struct ping_shm_target *targets;
+	int ntargets;
+	size_t size;
+} shm;
+
+/*
+ * ping_shm_config --
+ *	Publish the statistics in the shared memory object "name".
+ */
+void ping_shm_config(const char *name)
+{
+	if (!*name || strchr(name + 1, '/'))
+		error(2, 0, _("invalid -z argument: %s"), name);
+	if (asprintf(&shm.name, "%s%s", *name == '/' ? "" : "/", name) < 0)
+		error(2, errno, _("memory allocation failed"));
+}
+
+/*
+ * ping_shm_start --
+ *	Create the object, if -z was given, with every target in it.
+ */
+void ping_shm_start(ping_setup_data *setup_data)
+{
+	struct timespec now;
+	int fd, i;
+
+	if (!shm.name)
+		return;
+	shm.ntargets = setup_data->targets.count;
+	shm.size = sizeof(*shm.header) + shm.ntargets * sizeof(*shm.targets);
+
+	fd = shm_open(shm.name, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd < 0)
+		error(2, errno, _("cannot create %s"), shm.name);
+	if (ftruncate(fd, shm.size) < 0)
+		error(2, errno, _("cannot extend %s"), shm.name);
+	shm.header = mmap(NULL, shm.size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (shm.header == MAP_FAILED)
+		error(2, errno, _("cannot map %s"), shm.name);
+	close(fd);
+	shm.targets = (struct ping_shm_target *)(shm.header + 1);
+
+	clock_gettime(CLOCK_REALTIME, &now);
+	shm.header->version = PING_SHM_VERSION;
+	shm.header->header_size = sizeof(*shm.header);
+	shm.header->target_size = sizeof(*shm.targets);
+	shm.header->ntargets = shm.ntargets;
+	shm.header->pid = getpid();
+	shm.header->started_ns = now.tv_sec * 1000000000ULL + now.tv_nsec;
+	for (i = 0; i < shm.ntargets; i++) {
+		struct ping_shm_target *t = &shm.targets[i];
+
+		snprintf(t->name, sizeof(t->name), "%s", setup_data->targets.list[i]->target);
+		t->rtt_last = -1;
+		ping_shm_update(setup_data->targets.list[i], -1);
+	}
+	/* Last, so that a reader finding the magic finds the rest. */
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	memcpy(shm.header->magic, PING_SHM_MAGIC, sizeof(shm.header->magic));
+}
+
+/*
+ * ping_shm_update --
+ *	Publish the statistics of "rts"; "rtt" is the round trip time just
+ * measured, or -1 if the update is not about a timed reply.
+ */
+void ping_shm_update(struct ping_rts *rts, long long rtt)
+{
+	struct ping_shm_target *t;
+	struct timespec now;
+	uint32_t seq;
+
+	if (!shm.header || rts->id >= shm.ntargets)
+		return;
+	t = &shm.targets[rts->id];
+	clock_gettime(CLOCK_REALTIME, &now);
+
+	seq = t->seq;
+	__atomic_store_n(&t->seq, seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	t->updated_ns = now.tv_sec * 1000000000ULL + now.tv_nsec;
+	t->transmitted = rts->ntransmitted;
+	t->received = rts->nreceived;
+	t->duplicates = rts->nrepeats;
+	t->checksum = rts->nchecksum;
+	t->errors = rts->nerrors;
+	t->pending = rts->npending;
+	t->loss = packet_loss(rts);
+	if (rtt >= 0)
+		t->rtt_last = rtt;
+	if (rts->timing && rts->stats.count) {
+		t->rtt_min = rts->stats.min;
+		t->rtt_avg = ping_stats_mean(&rts->stats);
+		t->rtt_max = rts->stats.max;
+		t->rtt_mdev = ping_stats_mdev(&rts->stats);
+		t->rtt_ewma = ping_stats_ewma(&rts->stats);
+		t->jitter = ping_jitter_value(&rts->jitter);
+	} else {
+		t->rtt_min = t->rtt_avg = t->rtt_max = -1;
+		t->rtt_mdev = t->rtt_ewma = t->jitter = -1;
+	}
+
+	__atomic_store_n(&t->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+/* Remove the object, at exit. */
+void ping_shm_close(void)
+{
+	if (!shm.header)
+		return;
+	munmap(shm.header, shm.size);
+	shm.header = NULL;
+	shm_unlink(shm.name);
+}
@@ -0,0 +1,61 @@
+#ifndef PING_SHM_H
+#define PING_SHM_H
+
+/*
+ * Layout of the -z live statistics segment, shared with the watchping-stat
+ * reader.
+ *
+ * The POSIX shared memory object holds a ping_shm_header followed by one
+ * ping_shm_target per target, in the order given, each header_size and
+ * target_size bytes.  Everything is in host byte order.  A reader checks
+ * magic, version and sizes, then copies a target out under its seqlock:
+ *
+ *	do {
+ *		s = load_acquire(&t->seq);
+ *		copy = *t;
+ *		fence_acquire();
+ *	} while ((s & 1) || s != load_relaxed(&t->seq));
+ *
+ * The writer never waits for readers; a reader that keeps losing the race
+ * tries again, backing off, and gives up once the writer, whose pid is in
+ * the header, has died or held a target odd for long.  Times are in nsec,
+ * -1 where there is none yet.
+ */
+#include <stdint.h>
+
+#define PING_SHM_MAGIC		"WPINGSHM"
+#define PING_SHM_VERSION	1
+#define PING_SHM_NAME		64
+
+struct ping_shm_header {
+	char magic[8];			/* PING_SHM_MAGIC, not NUL terminated */
+	uint32_t version;
+	uint32_t header_size;		/* offset of the first target */
+	uint32_t target_size;
+	uint32_t ntargets;
+	int32_t pid;			/* of the writer */
+	uint32_t reserved0;
+	uint64_t started_ns;		/* CLOCK_REALTIME */
+	uint8_t reserved[24];
+};
+
+struct ping_shm_target {
+	uint32_t seq;			/* odd while being written */
+	uint32_t reserved0;
+	uint64_t updated_ns;		/* CLOCK_REALTIME of the last update */
+	int64_t transmitted;
+	int64_t received;		/* duplicates left out */
+	int64_t duplicates;
+	int64_t checksum;		/* replies with a bad checksum */
+	int64_t errors;			/* ICMP errors */
+	int64_t pending;		/* probes still within the linger time */
+	double loss;			/* percent of the settled probes */
+	int64_t rtt_last, rtt_min, rtt_avg, rtt_max, rtt_mdev, rtt_ewma;
+	int64_t jitter;			/* RFC 3550 */
+	char name[PING_SHM_NAME];	/* target as given, NUL terminated */
+};
+
+_Static_assert(sizeof(struct ping_shm_header) == 64, "ping_shm_header");
+_Static_assert(sizeof(struct ping_shm_target) == 192, "ping_shm_target");
+
+#endif /* PING_SHM_H */
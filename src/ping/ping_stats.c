@@ -0,0 +1,46 @@
+/*
+ * Round trip time accumulator.
+ *
+ * Mean and variance are kept with Welford's online method: the running
+ * mean and the sum of squared deviations from it are updated per sample,
+ * which neither overflows nor cancels out however many samples there are,
+ * unlike a sum of squares.  Min and max are exact integer nsec, and the
+ * EWMA is a fixed point integer with weight 1/2^ewma_shift.  Reading any
+ * of them back is O(1).
+ */
+#include "iputils_common.h"
+#include "ping.h"
+
+void ping_stats_init(struct ping_stats *stats, int ewma_shift)
+{
+	memset(stats, 0, sizeof(*stats));
+	stats->min = LLONG_MAX;
+	stats->ewma_shift = ewma_shift;
+}
+
+void ping_stats_add(struct ping_stats *stats, long long ns)
+{
+	double delta = ns - stats->mean;
+
+	stats->count++;
+	stats->mean += delta / stats->count;
+	stats->m2 += delta * (ns - stats->mean);
+
+	if (ns < stats->min)
+		stats->min = ns;
+	if (ns > stats->max)
+		stats->max = ns;
+
+	if (stats->count == 1)
+		stats->ewma = ns << stats->ewma_shift;
+	else
+		stats->ewma += ns - (stats->ewma >> stats->ewma_shift);
+}
+
+/* Population standard deviation, what ping has always called mdev. */
+long long ping_stats_mdev(const struct ping_stats *stats)
+{
+	if (!stats->count)
+		return 0;
+	return llround(sqrt(stats->m2 / stats->count));
+}
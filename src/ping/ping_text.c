@@ -0,0 +1,119 @@
+/*
+ * Per-target text output.
+ *
+ * Replies, ICMP errors and other events are reported while receiving, which
+ * no longer happens while the screen is being drawn.  Their text is kept in
+ * a small ring of lines instead, together with the color of every character,
+ * and copied onto the screen by the next redraw.
+ */
+#include <stdarg.h>
+
+#include "iputils_common.h"
+#include "ping.h"
+#include "ncurses_color.h"
+#include <ncursesw/ncurses.h>
+
+static struct ping_text *ping_text_get(struct ping_rts *rts)
+{
+	if (!rts->text) {
+		rts->text = calloc(1, sizeof(*rts->text));
+		if (!rts->text)
+			error(2, errno, _("memory allocation failed"));
+		rts->text->color = NORMAL_COLOR_INDEX;
+	}
+	return rts->text;
+}
+
+static void ping_text_newline(struct ping_text *text)
+{
+	text->head = (text->head + 1) % PING_TEXT_LINES;
+	text->len[text->head] = 0;
+	if (text->unread < PING_TEXT_LINES - 1)
+		text->unread++;
+}
+
+void ping_vprintf(struct ping_rts *rts, const char *fmt, va_list ap)
+{
+	struct ping_text *text = ping_text_get(rts);
+	char buf[PING_TEXT_COLS];
+	int n, i;
+
+	rts->changes++;
+	n = vsnprintf(buf, sizeof(buf), fmt, ap);
+	if (n >= (int)sizeof(buf))
+		n = sizeof(buf) - 1;
+
+	for (i = 0; i < n; i++) {
+		unsigned int *len = &text->len[text->head];
+
+		switch (buf[i]) {
+		case '\n':
+			ping_text_newline(text);
+			break;
+		case '\r':
+			*len = 0;
+			break;
+		case '\b':
+			if (*len)
+				(*len)--;
+			break;
+		default:
+			if (*len < PING_TEXT_COLS - 1) {
+				text->chars[text->head][*len] = buf[i];
+				text->colors[text->head][*len] = text->color;
+				(*len)++;
+			}
+		}
+	}
+}
+
+void ping_printf(struct ping_rts *rts, const char *fmt, ...)
+{
+	va_list ap;
+
+	va_start(ap, fmt);
+	ping_vprintf(rts, fmt, ap);
+	va_end(ap);
+}
+
+void ping_set_color(struct ping_rts *rts, int index)
+{
+	ping_text_get(rts)->color = index;
+}
+
+/*
+ * ping_text_render --
+ *	Draw the lines completed since the previous redraw, or at least the
+ * most recent one, followed by a line still being written.
+ */
+void ping_text_render(struct ping_rts *rts)
+{
+	struct ping_text *text = rts->text;
+	unsigned int shown, k, i;
+
+	if (!text)
+		return;
+
+	shown = text->unread;
+	if (!shown && text->len[(text->head + PING_TEXT_LINES - 1) % PING_TEXT_LINES])
+		shown = 1;
+	for (k = shown; k > 0; k--) {
+		unsigned int line = (text->head + PING_TEXT_LINES - k) % PING_TEXT_LINES;
+
+		for (i = 0; i < text->len[line]; i++) {
+			set_color(text->colors[line][i]);
+			addch((unsigned char)text->chars[line][i]);
+		}
+		set_color(NORMAL_COLOR_INDEX);
+		printw("\n");
+	}
+	if (text->len[text->head]) {
+		for (i = 0; i < text->len[text->head]; i++) {
+			set_color(text->colors[text->head][i]);
+			addch((unsigned char)text->chars[text->head][i]);
+		}
+		set_color(NORMAL_COLOR_INDEX);
+		printw("\n");
+	}
+	text->unread = 0;
+}
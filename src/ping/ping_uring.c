@@ -0,0 +1,539 @@
+/*
+ * io_uring backend for the ICMP sockets.
+ *
+ * Each socket keeps one multishot IORING_OP_RECVMSG posted, which lands
+ * replies in a ring of provided buffers, and probes are queued as
+ * IORING_OP_SENDMSG and submitted once per probe round.  A busy monitor
+ * thus needs far less than one syscall per packet.  The ring fd is
+ * watched by the epoll loop like any other source, and replies are handed
+ * to the same parse_reply hooks as on the recvmmsg() path.
+ *
+ * The ICMP error queue cannot be read through the ring; the sockets stay
+ * in the epoll set for EPOLLERR only, see ping_register_events().
+ *
+ * The few ring operations needed are done directly on the mmap()ed
+ * queues, so liburing is not required.  Whenever the kernel lacks a
+ * feature we fall back to plain socket syscalls.
+ */
+
+#include "ping.h"
+
+#ifdef HAVE_LINUX_IO_URING_H
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+#define URING_ENTRIES		256
+#define URING_RECV_BUFS		256	/* provided receive buffers, power of 2 */
+#define URING_SEND_SLOTS	256
+#define URING_BGID		1
+
+/* user_data of a request: what it is and which socket or send slot */
+enum {
+	URING_RECV,
+	URING_SEND,
+};
+#define URING_DATA(type, index)	(((uint64_t)(type) << 32) | (index))
+
+struct uring_send_slot {
+	struct msghdr msg;
+	struct iovec iov;
+	struct ping_rts *rts;
+	unsigned char *packet;
+	int next_free;
+};
+
+struct ping_uring {
+	int fd;
+	ping_setup_data *setup_data;
+	event_source event;
+
+	/* submission queue */
+	unsigned *sq_head;
+	unsigned *sq_tail;
+	unsigned *sq_flags;
+	unsigned *sq_array;
+	unsigned sq_mask;
+	unsigned sq_entries;
+	unsigned sq_queued;		/* our copy of the tail */
+	unsigned sq_submitted;
+	struct io_uring_sqe *sqes;
+
+	/* completion queue */
+	unsigned *cq_head;
+	unsigned *cq_tail;
+	unsigned cq_mask;
+	struct io_uring_cqe *cqes;
+
+	void *sq_ring;
+	size_t sq_ring_size;
+	void *cq_ring;
+	size_t cq_ring_size;
+	size_t sqes_size;
+
+	/* provided buffers of the multishot receives */
+	struct io_uring_buf_ring *buf_ring;
+	size_t buf_ring_size;
+	unsigned short buf_tail;
+	unsigned char *bufs;
+	size_t buf_size;
+	struct msghdr recv_msg[2];	/* sock4, sock6 */
+
+	/* probes handed to the kernel */
+	struct uring_send_slot slots[URING_SEND_SLOTS];
+	unsigned char *packets;
+	int free_slot;
+};
+
+static int uring_setup(unsigned entries, struct io_uring_params *p)
+{
+	return syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags)
+{
+	return syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static int uring_register(int fd, unsigned opcode, void *arg, unsigned nr_args)
+{
+	return syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+static void uring_free(struct ping_uring *u)
+{
+	if (u->buf_ring && u->buf_ring != MAP_FAILED)
+		munmap(u->buf_ring, u->buf_ring_size);
+	if (u->sqes && u->sqes != MAP_FAILED)
+		munmap(u->sqes, u->sqes_size);
+	if (u->cq_ring && u->cq_ring != MAP_FAILED && u->cq_ring != u->sq_ring)
+		munmap(u->cq_ring, u->cq_ring_size);
+	if (u->sq_ring && u->sq_ring != MAP_FAILED)
+		munmap(u->sq_ring, u->sq_ring_size);
+	if (u->fd >= 0)
+		close(u->fd);
+	free(u->bufs);
+	free(u->packets);
+	free(u);
+}
+
+static int uring_map(struct ping_uring *u, struct io_uring_params *p)
+{
+	unsigned char *sq, *cq;
+
+	u->sq_ring_size = p->sq_off.array + p->sq_entries * sizeof(unsigned);
+	u->cq_ring_size = p->cq_off.cqes + p->cq_entries * sizeof(struct io_uring_cqe);
+	if (p->features & IORING_FEAT_SINGLE_MMAP) {
+		if (u->cq_ring_size > u->sq_ring_size)
+			u->sq_ring_size = u->cq_ring_size;
+		u->cq_ring_size = u->sq_ring_size;
+	}
+
+	u->sq_ring = mmap(NULL, u->sq_ring_size, PROT_READ | PROT_WRITE,
+			  MAP_SHARED | MAP_POPULATE, u->fd, IORING_OFF_SQ_RING);
+	if (u->sq_ring == MAP_FAILED)
+		return -1;
+	if (p->features & IORING_FEAT_SINGLE_MMAP)
+		u->cq_ring = u->sq_ring;
+	else
+		u->cq_ring = mmap(NULL, u->cq_ring_size, PROT_READ | PROT_WRITE,
+				  MAP_SHARED | MAP_POPULATE, u->fd, IORING_OFF_CQ_RING);
+	if (u->cq_ring == MAP_FAILED)
+		return -1;
+	u->sqes_size = p->sq_entries * sizeof(struct io_uring_sqe);
+	u->sqes = mmap(NULL, u->sqes_size, PROT_READ | PROT_WRITE,
+		       MAP_SHARED | MAP_POPULATE, u->fd, IORING_OFF_SQES);
+	if (u->sqes == MAP_FAILED)
+		return -1;
+
+	sq = u->sq_ring;
+	u->sq_head = (unsigned *)(sq + p->sq_off.head);
+	u->sq_tail = (unsigned *)(sq + p->sq_off.tail);
+	u->sq_flags = (unsigned *)(sq + p->sq_off.flags);
+	u->sq_array = (unsigned *)(sq + p->sq_off.array);
+	u->sq_mask = *(unsigned *)(sq + p->sq_off.ring_mask);
+	u->sq_entries = p->sq_entries;
+	u->sq_queued = u->sq_submitted = *u->sq_tail;
+
+	cq = u->cq_ring;
+	u->cq_head = (unsigned *)(cq + p->cq_off.head);
+	u->cq_tail = (unsigned *)(cq + p->cq_off.tail);
+	u->cq_mask = *(unsigned *)(cq + p->cq_off.ring_mask);
+	u->cqes = (struct io_uring_cqe *)(cq + p->cq_off.cqes);
+
+	return 0;
+}
+
+/* Give receive buffer "bid" back to the kernel. */
+static void uring_recycle(struct ping_uring *u, unsigned short bid)
+{
+	struct io_uring_buf *buf = &u->buf_ring->bufs[u->buf_tail & (URING_RECV_BUFS - 1)];
+
+	buf->addr = (unsigned long)(u->bufs + (size_t)bid * u->buf_size);
+	buf->len = u->buf_size;
+	buf->bid = bid;
+	u->buf_tail++;
+	__atomic_store_n(&u->buf_ring->tail, u->buf_tail, __ATOMIC_RELEASE);
+}
+
+static int uring_buffers(struct ping_uring *u, ping_setup_data *setup_data)
+{
+	struct io_uring_buf_reg reg;
+	size_t packet_size = setup_data->packlen;
+	int i;
+
+	/* recvmsg_out header, address, control data and payload; keep every
+	 * buffer aligned for the cmsg headers inside. */
+	u->buf_size = sizeof(struct io_uring_recvmsg_out) + sizeof(struct sockaddr_storage) +
+		      PING_CMSG_SPACE + setup_data->packlen;
+	u->buf_size = (u->buf_size + 63) & ~(size_t)63;
+	u->bufs = malloc(u->buf_size * URING_RECV_BUFS);
+	u->packets = malloc(packet_size * URING_SEND_SLOTS);
+	if (!u->bufs || !u->packets)
+		return -1;
+
+	u->buf_ring_size = URING_RECV_BUFS * sizeof(struct io_uring_buf);
+	u->buf_ring = mmap(NULL, u->buf_ring_size, PROT_READ | PROT_WRITE,
+			   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (u->buf_ring == MAP_FAILED)
+		return -1;
+
+	memset(&reg, 0, sizeof(reg));
+	reg.ring_addr = (unsigned long)u->buf_ring;
+	reg.ring_entries = URING_RECV_BUFS;
+	reg.bgid = URING_BGID;
+	if (uring_register(u->fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0)
+		return -1;
+	for (i = 0; i < URING_RECV_BUFS; i++)
+		uring_recycle(u, i);
+
+	for (i = 0; i < 2; i++) {
+		u->recv_msg[i].msg_namelen = sizeof(struct sockaddr_storage);
+		u->recv_msg[i].msg_controllen = PING_CMSG_SPACE;
+	}
+
+	for (i = 0; i < URING_SEND_SLOTS; i++) {
+		u->slots[i].packet = u->packets + (size_t)i * packet_size;
+		u->slots[i].next_free = i + 1 < URING_SEND_SLOTS ? i + 1 : -1;
+	}
+	u->free_slot = 0;
+
+	return 0;
+}
+
+/*
+ * ping_uring_init --
+ *	Set up a ring for the sockets in use once the packet size is known.
+ * Returns -1, leaving the plain socket path in place, if the kernel does
+ * not support what we need.
+ */
+int ping_uring_init(ping_setup_data *setup_data)
+{
+	struct io_uring_params p;
+	struct ping_uring *u;
+
+	u = calloc(1, sizeof(*u));
+	if (!u)
+		return -1;
+
+	memset(&p, 0, sizeof(p));
+	u->fd = uring_setup(URING_ENTRIES, &p);
+	if (u->fd < 0 || uring_map(u, &p) || uring_buffers(u, setup_data)) {
+		uring_free(u);
+		return -1;
+	}
+
+	u->setup_data = setup_data;
+	setup_data->uring = u;
+	if (setup_data->sock4->ntargets)
+		setup_data->sock4->uring = u;
+	if (setup_data->sock6->ntargets)
+		setup_data->sock6->uring = u;
+
+	return 0;
+}
+
+/*
+ * ping_uring_submit --
+ *	Hand everything queued so far to the kernel with one io_uring_enter().
+ */
+void ping_uring_submit(struct ping_uring *u)
+{
+	unsigned pending = u->sq_queued - u->sq_submitted;
+	int ret;
+
+	if (!pending)
+		return;
+	__atomic_store_n(u->sq_tail, u->sq_queued, __ATOMIC_RELEASE);
+	ret = uring_enter(u->fd, pending, 0, 0);
+	/* Whatever was not taken now goes with the next submission. */
+	if (ret > 0)
+		u->sq_submitted += ret;
+}
+
+static struct io_uring_sqe *uring_get_sqe(struct ping_uring *u)
+{
+	struct io_uring_sqe *sqe;
+	unsigned index;
+
+	if (u->sq_queued - __atomic_load_n(u->sq_head, __ATOMIC_ACQUIRE) >= u->sq_entries) {
+		ping_uring_submit(u);
+		if (u->sq_queued - __atomic_load_n(u->sq_head, __ATOMIC_ACQUIRE) >= u->sq_entries)
+			return NULL;
+	}
+
+	index = u->sq_queued & u->sq_mask;
+	sqe = &u->sqes[index];
+	memset(sqe, 0, sizeof(*sqe));
+	u->sq_array[index] = index;
+	u->sq_queued++;
+
+	return sqe;
+}
+
+static socket_st *uring_socket(struct ping_uring *u, int index)
+{
+	return index ? u->setup_data->sock6 : u->setup_data->sock4;
+}
+
+/* Go back to reading socket "index" with recvmmsg(). */
+static void uring_fallback(struct ping_uring *u, int index)
+{
+	ping_setup_data *setup_data = u->setup_data;
+	event_source *source = index ? &setup_data->sock6_event : &setup_data->sock4_event;
+
+	uring_socket(u, index)->uring = NULL;
+	event_del(setup_data->epfd, source);
+	event_add(setup_data->epfd, source, EPOLLIN);
+}
+
+static void uring_arm_recv(struct ping_uring *u, int index)
+{
+	struct io_uring_sqe *sqe = uring_get_sqe(u);
+
+	if (!sqe) {
+		uring_fallback(u, index);
+		return;
+	}
+	sqe->opcode = IORING_OP_RECVMSG;
+	sqe->fd = uring_socket(u, index)->fd;
+	sqe->addr = (unsigned long)&u->recv_msg[index];
+	sqe->len = 1;
+	sqe->ioprio = IORING_RECV_MULTISHOT;
+	sqe->flags = IOSQE_BUFFER_SELECT;
+	sqe->buf_group = URING_BGID;
+	sqe->user_data = URING_DATA(URING_RECV, index);
+}
+
+/*
+ * ping_uring_send --
+ *	Queue "count" probes of "rts", numbered from ntransmitted + 1 on.
+ * They go out with the next ping_uring_submit().  Returns the number of
+ * probes queued, or -1 if no send slot is free right now.
+ */
+int ping_uring_send(struct ping_rts *rts, ping_func_set_st *fset, socket_st *sock, int count)
+{
+	struct ping_uring *u = sock->uring;
+	int i;
+
+	for (i = 0; i < count; i++) {
+		struct uring_send_slot *slot;
+		struct io_uring_sqe *sqe;
+		int n = u->free_slot;
+
+		if (n < 0 || !(sqe = uring_get_sqe(u)))
+			break;
+		slot = &u->slots[n];
+		u->free_slot = slot->next_free;
+
+		/* The payload is left from the slot's last probe if that was
+		 * one of this target's; only the header is built anew. */
+		if (slot->rts != rts)
+			memcpy(slot->packet, rts->outpack, rts->datalen + 28);
+		memset(&slot->msg, 0, sizeof(slot->msg));
+		slot->iov.iov_base = slot->packet;
+		slot->iov.iov_len = fset->build_probe(rts, sock, slot->packet,
+						      rts->ntransmitted + 1 + i, &slot->msg);
+		slot->msg.msg_iov = &slot->iov;
+		slot->msg.msg_iovlen = 1;
+		slot->rts = rts;
+
+		sqe->opcode = IORING_OP_SENDMSG;
+		sqe->fd = sock->fd;
+		sqe->addr = (unsigned long)&slot->msg;
+		sqe->len = 1;
+		sqe->msg_flags = rts->confirm;
+		sqe->user_data = URING_DATA(URING_SEND, n);
+		rts->confirm = 0;
+	}
+
+	if (!i) {
+		errno = EBUSY;
+		return -1;
+	}
+	return i;
+}
+
+static void uring_parse(struct ping_uring *u, int index, unsigned char *buf, int len)
+{
+	ping_setup_data *setup_data = u->setup_data;
+	ping_func_set_st *fset = index ? &ping6_func_set : &ping4_func_set;
+	struct ping_rts *rts = setup_data->targets.list[0];
+	socket_st *sock = uring_socket(u, index);
+	struct io_uring_recvmsg_out *out = (struct io_uring_recvmsg_out *)buf;
+	unsigned char *name = buf + sizeof(*out);
+	unsigned char *control = name + u->recv_msg[index].msg_namelen;
+	unsigned char *payload = control + u->recv_msg[index].msg_controllen;
+	struct timespec recv_time;
+	struct msghdr msg;
+	struct iovec iov;
+	int cc;
+
+	cc = len - (payload - buf);
+	if (cc < 0)
+		return;
+
+	iov.iov_base = payload;
+	iov.iov_len = cc;
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_name = name;
+	msg.msg_namelen = out->namelen;
+	msg.msg_control = control;
+	msg.msg_controllen = out->controllen;
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_flags = out->flags;
+
+	if (rts->opt_latency || !ping_recv_timestamp(&msg, ping_clock_skew(), &recv_time))
+		clock_gettime(CLOCK_MONOTONIC, &recv_time);
+
+	/* See? ... someone runs another ping on this host. */
+	if (fset->parse_reply(rts, sock, &msg, cc, name, &recv_time) &&
+	    sock->socktype == SOCK_RAW)
+		fset->install_filter(rts, sock);
+}
+
+static void uring_recv_done(struct ping_uring *u, int index, struct io_uring_cqe *cqe)
+{
+	if (cqe->flags & IORING_CQE_F_BUFFER) {
+		unsigned short bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+
+		if (cqe->res > 0)
+			uring_parse(u, index, u->bufs + (size_t)bid * u->buf_size, cqe->res);
+		uring_recycle(u, bid);
+	}
+	if (cqe->flags & IORING_CQE_F_MORE)
+		return;
+
+	/* The multishot receive ended because buffers or completion
+	 * entries ran out: post it again.  Anything else means the kernel
+	 * cannot do it for us. */
+	if (cqe->res >= 0 || cqe->res == -ENOBUFS)
+		uring_arm_recv(u, index);
+	else
+		uring_fallback(u, index);
+}
+
+static void uring_send_done(struct ping_uring *u, int n, struct io_uring_cqe *cqe)
+{
+	struct uring_send_slot *slot = &u->slots[n];
+	struct ping_rts *rts = slot->rts;
+
+	/* As a hard local error in pinger(): the probe stays counted. */
+	if (cqe->res < 0 && !rts->opt_quiet) {
+		if (rts->opt_flood)
+			write_stdout("E", 1);
+		else
+			error(0, -cqe->res, "sendmsg");
+	}
+	slot->next_free = u->free_slot;
+	u->free_slot = n;
+}
+
+static void uring_event(event_source *source, uint32_t events __attribute__((__unused__)))
+{
+	struct ping_uring *u = source->data;
+	unsigned head = *u->cq_head;
+	unsigned tail;
+
+	while (head != (tail = __atomic_load_n(u->cq_tail, __ATOMIC_ACQUIRE))) {
+		for (; head != tail; head++) {
+			struct io_uring_cqe *cqe = &u->cqes[head & u->cq_mask];
+			int index = cqe->user_data & 0xffffffff;
+
+			if (cqe->user_data >> 32 == URING_RECV)
+				uring_recv_done(u, index, cqe);
+			else
+				uring_send_done(u, index, cqe);
+		}
+		__atomic_store_n(u->cq_head, head, __ATOMIC_RELEASE);
+	}
+
+	/* Completions that did not fit are held by the kernel until asked. */
+	if (__atomic_load_n(u->sq_flags, __ATOMIC_RELAXED) & IORING_SQ_CQ_OVERFLOW)
+		uring_enter(u->fd, 0, 0, IORING_ENTER_GETEVENTS);
+
+	/* Replies may let the next probes go out; this submits the
+	 * re-armed receives as well. */
+	ping_reschedule(u->setup_data);
+	ping_uring_submit(u);
+}
+
+/*
+ * ping_uring_register --
+ *	Watch the ring from the event loop "epfd" and post the receives.
+ */
+void ping_uring_register(ping_setup_data *setup_data, int epfd)
+{
+	struct ping_uring *u = setup_data->uring;
+
+	u->event.fd = u->fd;
+	u->event.handler = uring_event;
+	u->event.data = u;
+	event_add(epfd, &u->event, EPOLLIN);
+
+	if (setup_data->sock4->uring)
+		uring_arm_recv(u, 0);
+	if (setup_data->sock6->uring)
+		uring_arm_recv(u, 1);
+	ping_uring_submit(u);
+}
+
+void ping_uring_cleanup(ping_setup_data *setup_data)
+{
+	if (setup_data->uring)
+		uring_free(setup_data->uring);
+	setup_data->uring = NULL;
+}
+
+#else /* HAVE_LINUX_IO_URING_H */
+
+int ping_uring_init(ping_setup_data *setup_data __attribute__((__unused__)))
+{
+	return -1;
+}
+
+void ping_uring_register(ping_setup_data *setup_data __attribute__((__unused__)),
+			 int epfd __attribute__((__unused__)))
+{
+}
+
+int ping_uring_send(struct ping_rts *rts __attribute__((__unused__)),
+		    ping_func_set_st *fset __attribute__((__unused__)),
+		    socket_st *sock __attribute__((__unused__)),
+		    int count __attribute__((__unused__)))
+{
+	errno = ENOSYS;
+	return -1;
+}
+
+void ping_uring_submit(struct ping_uring *u __attribute__((__unused__)))
+{
+}
+
+void ping_uring_cleanup(ping_setup_data *setup_data __attribute__((__unused__)))
+{
+}
+
+#endif /* HAVE_LINUX_IO_URING_H */
@@ -0,0 +1,182 @@
+/*
+ * Sliding window statistics.
+ *
+ * Every window is a ring of time slots, each counting the replies and
+ * losses settled within it, and a running total of the slots in the ring.
+ * A slot leaving the ring is subtracted from the total, so recording a
+ * probe is O(1) and the total is always at hand; only min/max are found by
+ * looking over the (at most PING_WIN_SLOTS) slots when shown.  Windows
+ * advance in whole slots: the "last 5m" are between 290 and 300 seconds.
+ */
+#include "iputils_common.h"
+#include "ping.h"
+
+static const struct {
+	int span;			/* seconds per slot */
+	int nslots;
+	const char *name;
+} window_defs[PING_WINDOWS] = {
+	{ 1, 10, "10s" },
+	{ 2, 30, "1m" },
+	{ 10, 30, "5m" },
+};
+
+struct ping_windows *ping_windows_alloc(void)
+{
+	struct ping_windows *windows = calloc(1, sizeof(*windows));
+	int i;
+
+	if (!windows)
+		error(2, errno, _("memory allocation failed"));
+	for (i = 0; i < PING_WINDOWS; i++) {
+		windows->w[i].span = window_defs[i].span;
+		windows->w[i].nslots = window_defs[i].nslots;
+		windows->w[i].name = window_defs[i].name;
+	}
+	return windows;
+}
+
+static void slot_clear(struct ping_win_slot *slot, long long start)
+{
+	memset(slot, 0, sizeof(*slot));
+	slot->start = start;
+	slot->min = LLONG_MAX;
+}
+
+/* Rotate the ring of "win" until its head slot covers second "now". */
+static struct ping_win_slot *window_advance(struct ping_window *win, long long now)
+{
+	long long start = now - now % win->span;
+	struct ping_win_slot *head = &win->slots[win->head];
+	long long steps;
+	int i;
+
+	/* Replies are stamped with the time of the last timer run, which
+	 * may be a hair behind the clock the window was last shown at. */
+	if (win->started && start <= head->start)
+		return head;
+
+	steps = (start - head->start) / win->span;
+	if (!win->started || steps >= win->nslots) {
+		/* Everything in the ring is out of the window. */
+		for (i = 0; i < win->nslots; i++)
+			slot_clear(&win->slots[i], start - (long long)(win->nslots - 1 - i) * win->span);
+		slot_clear(&win->total, 0);
+		win->head = win->nslots - 1;
+		win->started = 1;
+		return &win->slots[win->head];
+	}
+
+	while (steps--) {
+		struct ping_win_slot *old;
+		unsigned int b;
+
+		win->head = (win->head + 1) % win->nslots;
+		old = &win->slots[win->head];
+		win->total.received -= old->received;
+		win->total.lost -= old->lost;
+		win->total.timed -= old->timed;
+		win->total.sum -= old->sum;
+		if (old->timed)
+			for (b = 0; b < PING_WIN_BUCKETS; b++)
+				win->total.buckets[b] -= old->buckets[b];
+		slot_clear(old, start - steps * win->span);
+	}
+	return &win->slots[win->head];
+}
+
+/*
+ * ping_windows_reply --
+ *	A reply with round trip time "ns", or -1 if it was not timed, arrived
+ * at monotonic second "now".
+ */
+void ping_windows_reply(struct ping_windows *windows, long long now, long long ns)
+{
+	unsigned int bucket = ping_hist_bucket(ns, PING_WIN_SUB_BITS);
+	int i;
+
+	for (i = 0; i < PING_WINDOWS; i++) {
+		struct ping_window *win = &windows->w[i];
+		struct ping_win_slot *slot = window_advance(win, now);
+
+		slot->received++;
+		win->total.received++;
+		if (ns < 0)
+			continue;
+		slot->timed++;
+		slot->sum += ns;
+		if (ns < slot->min)
+			slot->min = ns;
+		if (ns > slot->max)
+			slot->max = ns;
+		slot->buckets[bucket]++;
+		win->total.timed++;
+		win->total.sum += ns;
+		win->total.buckets[bucket]++;
+	}
+}
+
+/* A probe timed out at monotonic second "now". */
+void ping_windows_loss(struct ping_windows *windows, long long now)
+{
+	int i;
+
+	for (i = 0; i < PING_WINDOWS; i++) {
+		struct ping_window *win = &windows->w[i];
+
+		window_advance(win, now)->lost++;
+		win->total.lost++;
+	}
+}
+
+/*
+ * ping_window_stats --
+ *	Sum up window "index" as of monotonic second "now".  Returns 0 if
+ * nothing was settled within it.
+ */
+int ping_window_stats(struct ping_windows *windows, int index, long long now,
+		      struct ping_window_stats *stats)
+{
+	struct ping_window *win = &windows->w[index];
+	unsigned long long rank, seen = 0;
+	unsigned int b;
+	int i;
+
+	window_advance(win, now);
+	memset(stats, 0, sizeof(*stats));
+	stats->name = win->name;
+	stats->received = win->total.received;
+	stats->lost = win->total.lost;
+	if (!stats->received && !stats->lost)
+		return 0;
+	stats->loss = stats->lost * 100.0 / (stats->received + stats->lost);
+	if (!win->total.timed)
+		return 1;
+
+	stats->timed = 1;
+	stats->avg = win->total.sum / win->total.timed;
+	stats->min = LLONG_MAX;
+	for (i = 0; i < win->nslots; i++) {
+		struct ping_win_slot *slot = &win->slots[i];
+
+		if (!slot->timed)
+			continue;
+		if (slot->min < stats->min)
+			stats->min = slot->min;
+		if (slot->max > stats->max)
+			stats->max = slot->max;
+	}
+
+	rank = (unsigned long long)(0.99 * win->total.timed + 0.5);
+	if (rank < 1)
+		rank = 1;
+	for (b = 0; b < PING_WIN_BUCKETS; b++) {
+		seen += win->total.buckets[b];
+		if (seen >= rank)
+			break;
+	}
+	stats->p99 = ping_hist_value(b < PING_WIN_BUCKETS ? b : PING_WIN_BUCKETS - 1, PING_WIN_SUB_BITS);
+	if (stats->p99 > stats->max)
+		stats->p99 = stats->max;
+	return 1;
+}
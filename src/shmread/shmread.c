@@ -0,0 +1,168 @@
+/*
+ * watchping-stat -- read the live statistics of watchping -z
+ *
+ * Prints one line per target from the shared memory object of a running
+ * watchping, or with -i the same again every <interval> seconds.  Each
+ * target is copied out under its seqlock, see ping_shm.h, so reading never
+ * holds up the pinger.
+ */
+#include <errno.h>
+#include <error.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "ping_shm.h"
+
+#define READ_SPINS	1000	/* tries before backing off */
+#define READ_SLEEP_MAX	10000000	/* nsec */
+#define READ_TIMEOUT	1000000000	/* nsec a target may stay odd */
+
+static void __attribute__((__noreturn__)) usage(void)
+{
+	fprintf(stderr,
+		"\nUsage\n"
+		"  watchping-stat [options] <name>\n"
+		"\nOptions:\n"
+		"  -h                 print help and exit\n"
+		"  -i <interval>      print again every <interval> seconds\n"
+	);
+	exit(2);
+}
+
+/*
+ * read_target --
+ *	Copy target "t" out once no write is under way.  An update takes
+ * well under a microsecond, so a reader first just tries again, then
+ * backs off; a target that stays odd for READ_TIMEOUT belongs to a writer
+ * that died or stopped in the middle of an update.  Returns 0, or -1 with
+ * errno ESRCH if the writer is gone, EAGAIN if it is stuck.
+ */
+static int read_target(const struct ping_shm_header *h, const struct ping_shm_target *t,
+		       struct ping_shm_target *copy)
+{
+	struct timespec delay = { 0, 1000 };
+	long long waited = 0;
+	uint32_t seq;
+	int tries;
+
+	for (tries = 0;; tries++) {
+		seq = __atomic_load_n(&t->seq, __ATOMIC_ACQUIRE);
+		if (!(seq & 1)) {
+			memcpy(copy, t, sizeof(*copy));
+			__atomic_thread_fence(__ATOMIC_ACQUIRE);
+			if (__atomic_load_n(&t->seq, __ATOMIC_RELAXED) == seq)
+				return 0;
+		}
+		if (tries < READ_SPINS)
+			continue;
+		if (kill(h->pid, 0) < 0 && errno == ESRCH)
+			return -1;
+		if (waited >= READ_TIMEOUT) {
+			errno = EAGAIN;
+			return -1;
+		}
+		nanosleep(&delay, NULL);
+		waited += delay.tv_nsec;
+		if (delay.tv_nsec < READ_SLEEP_MAX)
+			delay.tv_nsec *= 2;
+	}
+}
+
+static void print_msec(int64_t ns)
+{
+	if (ns < 0)
+		printf(" %9s", "-");
+	else
+		printf(" %9.3f", ns / 1e6);
+}
+
+static void print_targets(const struct ping_shm_header *h)
+{
+	const char *base = (const char *)h + h->header_size;
+	struct ping_shm_target t;
+	struct timespec now;
+	uint32_t i;
+
+	clock_gettime(CLOCK_REALTIME, &now);
+	printf("%-24s %8s %8s %7s %6s %9s %9s %9s %9s %9s %6s\n", "target", "sent", "received",
+	       "loss", "errors", "last", "min", "avg", "max", "mdev", "age");
+	for (i = 0; i < h->ntargets; i++) {
+		long long age;
+
+		if (read_target(h, (const struct ping_shm_target *)(base + i * h->target_size), &t) < 0) {
+			if (errno == ESRCH)
+				error(1, 0, "writer %d exited in the middle of an update", h->pid);
+			printf("target %u: writer %d stuck in the middle of an update\n", i, h->pid);
+			continue;
+		}
+		t.name[sizeof(t.name) - 1] = '\0';
+		age = now.tv_sec * 1000000000LL + now.tv_nsec - (long long)t.updated_ns;
+		printf("%-24s %8lld %8lld %6.2f%% %6lld", t.name, (long long)t.transmitted,
+		       (long long)t.received, t.loss, (long long)t.errors);
+		print_msec(t.rtt_last);
+		print_msec(t.rtt_min);
+		print_msec(t.rtt_avg);
+		print_msec(t.rtt_max);
+		print_msec(t.rtt_mdev);
+		printf(" %5.1fs\n", age < 0 ? 0 : age / 1e9);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	const struct ping_shm_header *h;
+	double interval = 0;
+	char name[256], *end;
+	struct stat st;
+	int ch, fd;
+
+	while ((ch = getopt(argc, argv, "hi:")) != EOF) {
+		switch (ch) {
+		case 'i':
+			interval = strtod(optarg, &end);
+			if (*end || !(interval > 0))
+				error(2, 0, "invalid interval: %s", optarg);
+			break;
+		default:
+			usage();
+		}
+	}
+	if (optind != argc - 1)
+		usage();
+
+	snprintf(name, sizeof(name), "%s%s", argv[optind][0] == '/' ? "" : "/", argv[optind]);
+	fd = shm_open(name, O_RDONLY, 0);
+	if (fd < 0 || fstat(fd, &st) < 0)
+		error(2, errno, "%s", name);
+	if ((size_t)st.st_size < sizeof(*h))
+		error(2, 0, "%s: not a watchping statistics object", name);
+	h = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	if (h == MAP_FAILED)
+		error(2, errno, "%s", name);
+	close(fd);
+
+	if (memcmp(h->magic, PING_SHM_MAGIC, sizeof(h->magic)))
+		error(2, 0, "%s: not a watchping statistics object", name);
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	if (h->version != PING_SHM_VERSION || h->header_size < sizeof(*h) ||
+	    h->target_size < sizeof(struct ping_shm_target) ||
+	    h->header_size + (uint64_t)h->ntargets * h->target_size > (uint64_t)st.st_size)
+		error(2, 0, "%s: unsupported version %u", name, h->version);
+
+	for (;;) {
+		print_targets(h);
+		if (!interval)
+			break;
+		fflush(stdout);
+		usleep(interval * 1e6);
+		putchar('\n');
+	}
+	return 0;
+}
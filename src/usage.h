@@ -3,37 +3,47 @@
 void print_usage(void) {
 	fprintf(stderr,
 		"\nUsage\n"
-		"  watchping [options] <destination>\n"
+		"  watchping [options] <destination> [<destination>...]\n"
 		"\nOptions:\n"
-		"  <destination>      dns name or ip address\n"
+		"  <destination>      dns name or ip address, several may be given\n"
 		"  -a                 use audible ping\n"
 		"  -A                 use adaptive ping\n"
 		"  -B                 sticky source address\n"
 		"  -D                 print timestamps\n"
 		"  -d                 use SO_DEBUG socket option\n"
+		"  -e                 print round-trip times to the nanosecond\n"
+		"  -E [<addr>:]<port> serve Prometheus metrics on <port>, of 127.0.0.1 by default\n"
 		"  -f                 flood ping\n"
+		"  -g <file>          log every probe to binary files <file>.NNNN\n"
+		"  -G <mb>[,<secs>]   start a new -g file after <mb> MiB or <secs> seconds\n"
 		"  -h                 print help and exit\n"
 		"  -H                 turn off header\n"
 		"  -I <interface>     either interface name or address\n"
 		"  -i <interval>      seconds between sending each packet\n"
+		"  -k                 time probes from when the kernel sent them\n"
 		"  -L                 suppress loopback of multicast packets\n"
 		"  -l <preload>       send <preload> number of packages while waiting replies\n"
 		"  -m <mark>          tag the packets going out\n"
 		"  -M <pmtud opt>     define mtu discovery, can be one of <do|dont|want>\n"
 		"  -n                 no dns name resolution\n"
+		"  -o <format>        no screen, records as <json|csv> on stdout, summaries every -i\n"
 		"  -O                 report outstanding replies\n"
-		"  -p <pattern>       contents of padding byte\n"
+		"  -p <pattern>       contents of padding byte, or random\n"
 		"  -P                 attempt run command in precise intervals\n"
 		"  -q                 quiet output\n"
 		"  -Q <tclass>        use quality of service <tclass> bits\n"
 		"  -s <size>          use <size> as number of data bytes to be sent\n"
 		"  -S <size>          use <size> as SO_SNDBUF socket option value\n"
 		"  -t <ttl>           define time to live\n"
+		"  -u                 use io_uring for socket I/O if the kernel supports it\n"
 		"  -U                 print user-to-user latency\n"
 		"  -v                 verbose output\n"
 		"  -V                 print version and exit\n"
 		"  -w <deadline>      reply wait <deadline> in seconds\n"
 		"  -W <timeout>       time to wait for response\n"
+		"  -x <fps>           show changes as they happen, up to <fps> redraws a second\n"
+		"  -y <shift>         weigh each rtt 1/2^<shift> in the ewma, 3 by default\n"
+		"  -z <name>          keep live statistics in shared memory object <name>\n"
 		"\nIPv4 options:\n"
 		"  -4                 use IPv4\n"
 		"  -b                 allow pinging broadcast\n"
@@ -39,6 +39,7 @@
 #include <getopt.h>
 #include <locale.h>
 #include <limits.h>
+#include <pthread.h>
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -79,15 +80,24 @@ static void __attribute__ ((__noreturn__)) do_exit(int status)
 	exit(status);
 }
 
-/* signal handler */
-static void die(int notused __attribute__ ((__unused__)))
+static void __attribute__ ((__noreturn__)) quit(void)
 {
 	if(pingSetupData) {
+		/* The measurement thread stops for good at its next event. */
+		pthread_mutex_lock(&pingSetupData->lock);
 		cleanup(pingSetupData);
 	}
 	do_exit(EXIT_SUCCESS);
 }
 
+/* signal handler, the main loop quits once epoll_wait() is interrupted */
+static volatile sig_atomic_t exit_signalled;
+
+static void die(int notused __attribute__ ((__unused__)))
+{
+	exit_signalled = 1;
+}
+
 static void winch_handler(int notused __attribute__ ((__unused__)))
 {
 	screen_size_changed = 1;
@@ -151,16 +161,6 @@ static void get_terminal_size(void)
 	}
 }
 
-/* get current time in usec */
-typedef unsigned long long watch_usec_t;
-#define USECS_PER_SEC (1000000ull)
-static watch_usec_t get_time_usec()
-{
-	struct timeval now;
-	gettimeofday(&now, NULL);
-	return USECS_PER_SEC * now.tv_sec + now.tv_usec;
-}
-
 #ifdef WITH_WATCH8BIT
 /* read a wide character from a popen'd stream */
 #define MAX_ENC_BYTES 16
@@ -199,28 +199,54 @@ wint_t my_getwc(FILE * s)
 }
 #endif	/* WITH_WATCH8BIT */
 
+/*
+ * Everything on the header but the clock is known once started, and
+ * everything below it changes only with the targets: each target counts
+ * its changes, and only what changed since the frame before is drawn
+ * again, along with targets whose windows the clock moved on.  Only the
+ * first frame and a resize draw everything.  curses then sends the
+ * terminal just the cells that differ.
+ */
+static struct {
+	char left[64];			/* "Every ...: " */
+	char host[HOST_NAME_MAX + 1];
+	time_t shown;			/* second on the clock */
+	unsigned long *seen;		/* targets' changes as drawn */
+	unsigned long bells;		/* sum of the targets' bells as rung */
+	time_t *drawn;			/* second each target was drawn */
+	int *rows;			/* screen row of each target's summary */
+	int name_width;
+} frame;
+
+/* Draw the header if the clock moved on or "full"; returns 1 if it did. */
 #ifdef WITH_WATCH8BIT
-static void output_header(wchar_t *restrict wcommand, int wcommand_characters, double interval)
+static int output_header(wchar_t *restrict wcommand, int wcommand_characters, double interval,
+			 int full)
 #else
-static void output_header(char *restrict command, double interval)
+static int output_header(char *restrict command, double interval, int full)
 #endif	/* WITH_WATCH8BIT */
 {
 	time_t t = time(NULL);
-	char *ts = ctime(&t);
-	char *header;
-	char *right_header;
-    int max_host_name_len = (int) sysconf(_SC_HOST_NAME_MAX);
-	char hostname[max_host_name_len + 1];
+	char ts[32];
+	char right_header[sizeof(frame.host) + sizeof(ts) + 2];
 	int command_columns = 0;	/* not including final \0 */
 
-	gethostname(hostname, sizeof(hostname));
+	if (!full && t == frame.shown)
+		return 0;
+	frame.shown = t;
+	ctime_r(&t, ts);
+
+	if (!frame.left[0]) {
+		gethostname(frame.host, sizeof(frame.host) - 1);
+		snprintf(frame.left, sizeof(frame.left), _("Every %.1fs: "), interval);
+	}
 
 	/*
 	 * left justify interval and command, right justify hostname and time,
 	 * clipping all to fit window width
 	 */
-	int hlen = asprintf(&header, _("Every %.1fs: "), interval);
-	int rhlen = asprintf(&right_header, _("%s: %s"), hostname, ts);
+	int hlen = strlen(frame.left);
+	int rhlen = snprintf(right_header, sizeof(right_header), _("%s: %s"), frame.host, ts);
 
 	/*
 	 * the rules:
@@ -233,13 +259,10 @@ static void output_header(char *restrict command, double interval)
 	 *   width > "": print header, wcomand, hostname, ts
 	 * this is slightly different from how it used to be
 	 */
-	if (width < rhlen) {
-		free(header);
-		free(right_header);
-		return;
-	}
+	if (width < rhlen)
+		return 1;
 	if (rhlen + hlen + 1 <= width) {
-		mvaddstr(0, 0, header);
+		mvaddstr(0, 0, frame.left);
 		if (rhlen + hlen + 2 <= width) {
 			if (width < rhlen + hlen + 4) {
 				mvaddstr(0, width - rhlen - 4, "... ");
@@ -273,24 +296,172 @@ static void output_header(char *restrict command, double interval)
 			}
 		}
 	}
-	mvaddstr(0, width - rhlen + 1, right_header);
-	free(header);
-	free(right_header);
-	return;
+	/* Not ctime()'s newline, which would clear the line below. */
+	mvaddnstr(0, width - rhlen + 1, right_header, rhlen - 1);
+	return 1;
+}
+
+/* Whether target "i" has to be drawn again as of second "now". */
+static int target_stale(int i, time_t now)
+{
+	struct ping_rts *rts = pingSetupData->targets.list[i];
+
+	/* The last-10s window moves on every second, changes or not. */
+	return rts->changes != frame.seen[i] || (rts->windows && now != frame.drawn[i]);
+}
+
+/*
+ * draw_targets --
+ *	Draw the summary line of every target that changed, or of all of them
+ * if "full".  Returns -1 if a line now takes up a different number of rows,
+ * which moves the ones below it: then all of them have to be drawn.
+ */
+static int draw_targets(int top, int full, time_t now)
+{
+	struct ping_targets *targets = &pingSetupData->targets;
+	int i, drawn = 0;
+
+	if (full)
+		frame.rows[0] = top;
+	for (i = 0; i < targets->count; i++) {
+		struct ping_rts *rts = targets->list[i];
+
+		if (!full && !target_stale(i, now))
+			continue;
+		move(frame.rows[i], 0);
+		summary(rts, frame.name_width);
+		frame.seen[i] = rts->changes;
+		frame.drawn[i] = now;
+		drawn = 1;
+		if (full)
+			frame.rows[i + 1] = getcury(stdscr);
+		else if (getcury(stdscr) != frame.rows[i + 1])
+			return -1;
+	}
+	if (full)
+		clrtobot();
+	return drawn;
+}
+
+/*
+ * draw_screen --
+ *	Bring the screen up to date, all of it if "full", otherwise only the
+ * clock and the targets that changed since it was last drawn.
+ */
+static void draw_screen(watch_options *watch_args, int full)
+{
+	int i, top = watch_args->show_title ? 1 : 0;
+	int drawn = 0;
+	time_t now = time(NULL);
+	unsigned long bells = 0;
+
+	if (screen_size_changed) {
+		get_terminal_size();
+		resizeterm(height, width);
+		clear();
+		/* redrawwin(stdscr); */
+		screen_size_changed = 0;
+		full = 1;
+	}
+
+	/* The targets are copied into curses' window, not yet to the terminal. */
+	pthread_mutex_lock(&pingSetupData->lock);
+	if (!frame.seen) {
+		int count = pingSetupData->targets.count;
+
+		frame.seen = calloc(count, sizeof(*frame.seen));
+		frame.rows = calloc(count + 1, sizeof(*frame.rows));
+		frame.drawn = calloc(count, sizeof(*frame.drawn));
+		if (!frame.seen || !frame.rows || !frame.drawn)
+			error(2, errno, _("memory allocation failed"));
+		for (i = 0; i < count; i++) {
+			int len = strlen(pingSetupData->targets.list[i]->hostname);
+
+			if (len > frame.name_width)
+				frame.name_width = len;
+		}
+		full = 1;
+	}
+
+	if (watch_args->show_title)
+#ifdef WITH_WATCH8BIT
+		drawn = output_header(wcommand, wcommand_characters, interval, full);
+#else
+		drawn = output_header(watch_args->command, watch_args->interval, full);
+#endif	/* WITH_WATCH8BIT */
+
+	if (pingSetupData->targets.count == 1) {
+		struct ping_rts *rts = pingSetupData->targets.list[0];
+
+		if (full || target_stale(0, now)) {
+			move(top, 0);
+			print_ping_header(rts->ipv4, rts);
+			ping_text_render(rts);
+			finish(rts);
+			clrtobot();
+			frame.seen[0] = rts->changes;
+			frame.drawn[0] = now;
+			drawn = 1;
+		}
+	} else {
+		int ret = draw_targets(top, full, now);
+
+		if (ret < 0)
+			ret = draw_targets(top, 1, now);
+		drawn |= ret;
+	}
+	for (i = 0; i < pingSetupData->targets.count; i++)
+		bells += pingSetupData->targets.list[i]->bells;
+	pthread_mutex_unlock(&pingSetupData->lock);
+
+	/* One beep for however many -a replies came since the last frame */
+	if (bells != frame.bells) {
+		frame.bells = bells;
+		beep();
+	}
+	if (drawn) {
+		wnoutrefresh(stdscr);
+		doupdate();
+	}
+}
+
+static void refresh_event(event_source *source, uint32_t events __attribute__ ((__unused__)))
+{
+	watch_options *watch_args = source->data;
+
+	event_timer_read(source);
+	draw_screen(watch_args, 0);
+
+	/* Without precise timekeeping the interval starts after drawing. */
+	if (!watch_args->precise_timekeeping)
+		event_timer_arm(source, watch_args->interval * 1000, 0);
+}
+
+/* -x: between -i ticks, show what changed at up to max_fps frames a second. */
+static void frame_event(event_source *source, uint32_t events __attribute__ ((__unused__)))
+{
+	event_timer_read(source);
+	draw_screen(source->data, 0);
+}
+
+static void stdin_event(event_source *source __attribute__ ((__unused__)),
+			uint32_t events __attribute__ ((__unused__)))
+{
+	int ch;
+
+	while ((ch = getch()) != ERR) {
+		if (ch == 'q' || ch == 'Q')
+			quit();
+	}
 }
 
 int start_watch(struct ping_setup_data *pingSetupDataPtr, watch_options *watch_args) {
 	pingSetupData = pingSetupDataPtr;
-	int optc;
 	char *interval_string;
-	char **command_argv;
-	int command_length = 0;	/* not including final \0 */
-	watch_usec_t next_loop;	/* next loop time in us, used for precise time
-				 * keeping only */
-#ifdef WITH_WATCH8BIT
-	wchar_t *wcommand = NULL;
-	int wcommand_characters = 0;	/* not including final \0 */
-#endif	/* WITH_WATCH8BIT */
+	int epfd;
+	event_source refresh_timer;
+	event_source frame_timer;
+	event_source stdin_source;
 
 #ifdef HAVE_PROGRAM_INVOCATION_NAME
 	program_invocation_name = program_invocation_short_name;
@@ -324,53 +495,51 @@ int start_watch(struct ping_setup_data *pingSetupDataPtr, watch_options *watch_a
 	nonl();
 	noecho();
 	cbreak();
+	nodelay(stdscr, TRUE);
 	initialize_colors();
 	set_color(NORMAL_COLOR_INDEX);
 
-	if (watch_args->precise_timekeeping)
-		next_loop = get_time_usec();
-
-	int count = 0;
-	
-	while (1) {
-		if (screen_size_changed) {
-			printf("Screen changed size\n");
-			get_terminal_size();
-			resizeterm(height, width);
-			clear();
-			/* redrawwin(stdscr); */
-			screen_size_changed = 0;
-		}
+	/*
+	 * Probes and replies are handled by the measurement thread, redraws
+	 * here on their own schedule: a timer for the screen, and stdin for
+	 * keys.
+	 */
+	ping_io_start(pingSetupData);
+	epfd = event_loop_create();
 
-		mvaddstr(0, 0, "");
+	event_timer_init(&refresh_timer, refresh_event, watch_args);
+	event_add(epfd, &refresh_timer, EPOLLIN);
+	if (watch_args->precise_timekeeping)
+		event_timer_arm(&refresh_timer, watch_args->interval * 1000, watch_args->interval * 1000);
+	else
+		event_timer_arm(&refresh_timer, watch_args->interval * 1000, 0);
+
+	if (watch_args->max_fps > 0) {
+		long period = 1000 / watch_args->max_fps;
+
+		if (period < 1)
+			period = 1;
+		event_timer_init(&frame_timer, frame_event, watch_args);
+		event_add(epfd, &frame_timer, EPOLLIN);
+		event_timer_arm(&frame_timer, period, period);
+	}
 
-		if (watch_args->show_title)
-#ifdef WITH_WATCH8BIT
-			output_header(wcommand, wcommand_characters, interval);
-#else
-			output_header(watch_args->command, watch_args->interval);
-#endif	/* WITH_WATCH8BIT */
+	stdin_source.fd = STDIN_FILENO;
+	stdin_source.handler = stdin_event;
+	stdin_source.data = NULL;
+	event_add(epfd, &stdin_source, EPOLLIN);
 
-		print_ping_header(pingSetupData->ipv4, pingSetupData->rts);
+	draw_screen(watch_args, 1);
 
-		if(pingSetupData->ipv4) {
-			main_ping(pingSetupData->rts, pingSetupData->fset, pingSetupData->sock4, pingSetupData->packet, pingSetupData->packlen);
-		} else {
-			main_ping(pingSetupData->rts, pingSetupData->fset, pingSetupData->sock6, pingSetupData->packet, pingSetupData->packlen);
+	while (1) {
+		if (event_dispatch(epfd, -1) < 0) {
+			if (errno != EINTR)
+				error(2, errno, "epoll_wait");
+			if (exit_signalled)
+				quit();
+			if (screen_size_changed)
+				draw_screen(watch_args, 1);
 		}
-
-		refresh();
-
-		if (watch_args->precise_timekeeping) {
-			watch_usec_t cur_time = get_time_usec();
-			next_loop += USECS_PER_SEC * watch_args->interval;
-			if (cur_time < next_loop)
-				usleep(next_loop - cur_time);
-		} else
-			if (watch_args->interval < UINT_MAX / USECS_PER_SEC)
-				usleep(watch_args->interval * USECS_PER_SEC);
-			else
-				sleep(watch_args->interval);
 	}
 
 	endwin();
@@ -10,6 +10,7 @@ typedef struct watch_options {
     double interval;
     int show_title;
     int precise_timekeeping;
+    double max_fps;
 } watch_options;
 
 int start_watch(struct ping_setup_data *pingSetupData, watch_options *watch_args);
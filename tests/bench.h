@@ -0,0 +1,26 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <time.h>
+
+/* CLOCK_MONOTONIC in seconds, for timing benchmark loops */
+static inline double bench_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* xorshift64, so that every run sees the same "random" data */
+static unsigned long long bench_rng = 88172645463325252ULL;
+
+static inline unsigned long long xorshift(void)
+{
+	bench_rng ^= bench_rng << 13;
+	bench_rng ^= bench_rng >> 7;
+	bench_rng ^= bench_rng << 17;
+	return bench_rng;
+}
+
+#endif /* BENCH_H */
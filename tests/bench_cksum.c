@@ -0,0 +1,67 @@
+/*
+ * Cost of in_cksum() with each kernel of ping_cksum.c, against the old 16
+ * bit loop, for a bare ICMP header, the default packet, an ethernet MTU,
+ * a jumbo frame and the largest IP packet.
+ *
+ *	bench_cksum [bytes to sum per size]
+ */
+#include "../src/ping/ping_cksum.c"
+#include "cksum_ref.h"
+#include "bench.h"
+
+static const int sizes[] = { 8, 64, 1472, 8972, 65507 };
+
+static double run(uint64_t (*kernel)(const unsigned char *, size_t, uint64_t),
+		  const unsigned char *buf, int len, long rounds)
+{
+	unsigned short sink = 0;
+	double t;
+	long i;
+
+	if (kernel)
+		cksum_kernel = kernel;
+	t = bench_now();
+	for (i = 0; i < rounds; i++) {
+		if (kernel)
+			sink += in_cksum((const unsigned short *)buf, len, sink);
+		else
+			sink += in_cksum_ref((const unsigned short *)buf, len, sink);
+		__asm__ volatile("" : : "r"(sink) : "memory");
+	}
+	return (bench_now() - t) * 1e9 / rounds;
+}
+
+int main(int argc, char **argv)
+{
+	long total = argc > 1 ? atol(argv[1]) : 1L << 30;
+	unsigned char *buf = malloc(65536);
+	size_t i;
+	int avx2 = 0;
+
+	if (!buf)
+		error(2, errno, "malloc");
+	for (i = 0; i < 65536; i++)
+		buf[i] = i * 2654435761U >> 24;
+#ifdef PING_CKSUM_X86
+	__builtin_cpu_init();
+	avx2 = __builtin_cpu_supports("avx2");
+#endif
+
+	printf("%8s %10s %10s %10s %10s\n", "bytes", "old", "scalar", "sse2", "avx2");
+	for (i = 0; i < ARRAY_SIZE(sizes); i++) {
+		long rounds = total / sizes[i];
+
+		printf("%8d %8.1fns", sizes[i], run(NULL, buf, sizes[i], rounds));
+		printf(" %8.1fns", run(cksum_words, buf, sizes[i], rounds));
+#ifdef PING_CKSUM_X86
+		printf(" %8.1fns", run(cksum_sse2, buf, sizes[i], rounds));
+		if (avx2)
+			printf(" %8.1fns", run(cksum_avx2, buf, sizes[i], rounds));
+		else
+			printf(" %10s", "-");
+#endif
+		putchar('\n');
+	}
+	free(buf);
+	return 0;
+}
@@ -0,0 +1,148 @@
+/*
+ * Cost of the -z seqlock on the writer: ping_shm_update() timed alone,
+ * with a reader thread polling the same target every millisecond, as
+ * watchping-stat -i would at its fastest, and with one copying it out as
+ * fast as it can.  Both readers retry and back off as watchping-stat
+ * does.  A reader bounces the target's cache lines away from the writer
+ * but never makes it wait.  Updates are timed back to back, and paced by
+ * a stretch of other work, about what a flood reply costs, which is when
+ * a reader gets in between them.  Writer and reader are pinned to CPUs 0
+ * and 1; on a single CPU they only take turns.
+ *
+ *	bench_shm [updates]
+ */
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+
+#include "iputils_common.h"
+#include "ping.h"
+#include "bench.h"
+
+static volatile int stop;
+static long reads, retries;
+
+struct reader {
+	const struct ping_shm_target *t;
+	long poll_ns;			/* 0: spin */
+};
+
+/* Pin the calling thread to "cpu", if there is such a CPU. */
+static void pin(int cpu)
+{
+	cpu_set_t set;
+
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+static void *reader_run(void *arg)
+{
+	const struct reader *r = arg;
+	struct timespec delay = { 0, r->poll_ns }, backoff = { 0, 1000 };
+	struct ping_shm_target copy;
+	uint32_t seq;
+	int tries;
+
+	pin(1);
+	while (!stop) {
+		/* As watchping-stat does: back off after a thousand tries, so as
+		 * not to spin away the slice of a writer preempted mid-update. */
+		for (tries = 0;; tries++) {
+			seq = __atomic_load_n(&r->t->seq, __ATOMIC_ACQUIRE);
+			if (!(seq & 1)) {
+				memcpy(&copy, r->t, sizeof(copy));
+				__atomic_thread_fence(__ATOMIC_ACQUIRE);
+				if (__atomic_load_n(&r->t->seq, __ATOMIC_RELAXED) == seq)
+					break;
+			}
+			retries++;
+			if (tries >= 1000)
+				nanosleep(&backoff, NULL);
+		}
+		reads++;
+		if (r->poll_ns)
+			nanosleep(&delay, NULL);
+	}
+	return NULL;
+}
+
+static double run(struct ping_rts *rts, long n, int gap, const struct reader *r)
+{
+	pthread_t thread;
+	double t;
+	long i;
+	int j;
+
+	stop = 0;
+	reads = retries = 0;
+	if (r && pthread_create(&thread, NULL, reader_run, (void *)r))
+		error(2, 0, "pthread_create");
+	t = bench_now();
+	for (i = 0; i < n; i++) {
+		rts->ntransmitted++;
+		ping_shm_update(rts, 20000 + i % 1000);
+		for (j = 0; j < gap; j++)
+			__asm__ volatile("");
+	}
+	t = bench_now() - t;
+	stop = 1;
+	if (r)
+		pthread_join(thread, NULL);
+	return t * 1e9 / n;
+}
+
+int main(int argc, char **argv)
+{
+	long n = argc > 1 ? atol(argv[1]) : 10000000;
+	ping_setup_data setup_data = { 0 };
+	struct ping_rts *rts = calloc(1, sizeof(*rts));
+	struct ping_shm_header *h;
+	struct reader r;
+	char name[64];
+	double ns;
+	int fd, gap;
+
+	if (!rts)
+		error(2, errno, "calloc");
+	rts->target = "bench";
+	rts->timing = 1;
+	ping_stats_init(&rts->stats, PING_EWMA_SHIFT);
+	ping_stats_add(&rts->stats, 20000);
+	rts->nreceived = 1;
+	setup_data.targets.list = &rts;
+	setup_data.targets.count = 1;
+
+	snprintf(name, sizeof(name), "/watchping-bench-%d", getpid());
+	ping_shm_config(name);
+	ping_shm_start(&setup_data);
+	fd = shm_open(name, O_RDONLY, 0);
+	if (fd < 0)
+		error(2, errno, "%s", name);
+	h = mmap(NULL, sizeof(*h) + sizeof(struct ping_shm_target), PROT_READ, MAP_SHARED, fd, 0);
+	if (h == MAP_FAILED)
+		error(2, errno, "%s", name);
+	close(fd);
+	r.t = (const struct ping_shm_target *)(h + 1);
+
+	pin(0);
+	if (sysconf(_SC_NPROCESSORS_ONLN) < 2)
+		printf("one CPU: the reader only runs when the writer is preempted\n");
+
+	for (gap = 0; gap <= 2000; gap += 2000) {
+		printf("%s, ns per update and other work\n", gap ? "paced" : "back to back");
+		printf("  no reader         %8.1f\n", run(rts, n, gap, NULL));
+		r.poll_ns = 1000000;
+		ns = run(rts, n, gap, &r);
+		printf("  reader every 1ms  %8.1f  %ld reads, %ld retries\n", ns, reads, retries);
+		r.poll_ns = 0;
+		ns = run(rts, n, gap, &r);
+		printf("  reader spinning   %8.1f  %ld reads, %ld retries\n", ns, reads, retries);
+	}
+
+	munmap(h, sizeof(*h) + sizeof(struct ping_shm_target));
+	ping_shm_close();
+	free(rts);
+	return 0;
+}
@@ -0,0 +1,45 @@
+/*
+ * Cost of the round trip time accumulator: adding a sample, as
+ * gather_statistics() does per reply, and reading the summary back, as
+ * every redraw does.
+ *
+ *	bench_stats [samples]
+ */
+#include "iputils_common.h"
+#include "ping.h"
+#include "bench.h"
+
+int main(int argc, char **argv)
+{
+	long n = argc > 1 ? atol(argv[1]) : 100000000;
+	long long *samples, sink = 0;
+	struct ping_stats stats;
+	long i, nsamples = 4096;
+	double t;
+
+	samples = malloc(nsamples * sizeof(*samples));
+	if (!samples)
+		error(2, errno, "malloc");
+	for (i = 0; i < nsamples; i++)
+		samples[i] = 20000 + xorshift() % 1000000;
+
+	ping_stats_init(&stats, PING_EWMA_SHIFT);
+	t = bench_now();
+	for (i = 0; i < n; i++)
+		ping_stats_add(&stats, samples[i & (nsamples - 1)]);
+	t = bench_now() - t;
+	printf("ping_stats_add     %8.2f ns/sample\n", t * 1e9 / n);
+
+	n /= 10;
+	t = bench_now();
+	for (i = 0; i < n; i++) {
+		sink += ping_stats_mean(&stats) + ping_stats_mdev(&stats) + ping_stats_ewma(&stats);
+		/* Keep the compiler from hoisting the reads out of the loop. */
+		__asm__ volatile("" : : : "memory");
+	}
+	t = bench_now() - t;
+	printf("mean + mdev + ewma %8.2f ns/read\n", t * 1e9 / n);
+
+	free(samples);
+	return sink == 42;
+}
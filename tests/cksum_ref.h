@@ -0,0 +1,45 @@
+#ifndef CKSUM_REF_H
+#define CKSUM_REF_H
+
+/*
+ * The in_cksum() ping.c had before ping_cksum.c: 16 bit words added into an
+ * int one at a time.  Kept as the reference the kernels are checked and
+ * timed against; the words are loaded with memcpy so that odd addresses
+ * can be tried too.  The int overflows past about 64 KiB of 0xffff words.
+ */
+#include <endian.h>
+#include <string.h>
+
+#if BYTE_ORDER == LITTLE_ENDIAN
+# define ODDBYTE(v)	(v)
+#elif BYTE_ORDER == BIG_ENDIAN
+# define ODDBYTE(v)	((unsigned short)(v) << 8)
+#else
+# define ODDBYTE(v)	htons((unsigned short)(v) << 8)
+#endif
+
+static unsigned short
+in_cksum_ref(const unsigned short *addr, int len, unsigned short csum)
+{
+	int nleft = len;
+	const unsigned short *w = addr;
+	unsigned short answer, word;
+	int sum = csum;
+
+	while (nleft > 1) {
+		memcpy(&word, w++, 2);
+		sum += word;
+		nleft -= 2;
+	}
+
+	/* mop up an odd byte, if necessary */
+	if (nleft == 1)
+		sum += ODDBYTE(*(unsigned char *)w);
+
+	sum = (sum >> 16) + (sum & 0xffff);	/* add hi 16 to low 16 */
+	sum += (sum >> 16);			/* add carry */
+	answer = ~sum;				/* truncate to 16 bits */
+	return (answer);
+}
+
+#endif /* CKSUM_REF_H */
@@ -0,0 +1,95 @@
+/*
+ * Checks of every checksum kernel in ping_cksum.c against the old 16 bit
+ * loop, at every length up to a few AVX2 rounds and every alignment
+ * within one, plus full size packets.  ping_cksum.c is built in here so
+ * that its kernels can be picked directly.
+ */
+#include "../src/ping/ping_cksum.c"
+#include "cksum_ref.h"
+#include "bench.h"
+
+#define MAXLEN		65535
+#define SHORTLEN	1024
+#define ALIGN		64
+
+static int failures;
+
+struct kernel {
+	const char *name;
+	uint64_t (*sum)(const unsigned char *p, size_t len, uint64_t sum);
+};
+
+static void check(const struct kernel *k, const unsigned char *buf, int len,
+		  int align, unsigned short csum)
+{
+	unsigned short want = in_cksum_ref((const unsigned short *)buf, len, csum);
+	unsigned short got;
+
+	cksum_kernel = k->sum;
+	got = in_cksum((const unsigned short *)buf, len, csum);
+	if (got != want) {
+		if (failures++ < 20)
+			fprintf(stderr, "%s: len %d align %d csum %#x: %#x, not %#x\n",
+				k->name, len, align, csum, got, want);
+	}
+}
+
+static void check_kernel(const struct kernel *k, unsigned char *mem)
+{
+	int len, align, i;
+
+	/* Random bytes, every length and alignment */
+	for (i = 0; i < SHORTLEN + ALIGN; i++)
+		mem[i] = xorshift();
+	for (len = 0; len <= SHORTLEN; len++)
+		for (align = 0; align < ALIGN; align++)
+			check(k, mem + align, len, align, 0);
+
+	/* All ones, which carries out of every word; and a csum to extend */
+	memset(mem, 0xff, SHORTLEN + ALIGN);
+	for (len = 0; len <= SHORTLEN; len++)
+		for (align = 0; align < ALIGN; align++)
+			check(k, mem + align, len, align, xorshift());
+
+	/* Up to the largest IP packet; random data keeps the old int in range */
+	for (i = 0; i < MAXLEN + ALIGN; i++)
+		mem[i] = xorshift();
+	for (i = 0; i < 200; i++) {
+		len = MAXLEN - xorshift() % 4096;
+		align = xorshift() % ALIGN;
+		check(k, mem + align, len, align, xorshift());
+	}
+}
+
+int main(void)
+{
+	const struct kernel kernels[] = {
+		{ "scalar", cksum_words },
+#ifdef PING_CKSUM_X86
+		{ "sse2", cksum_sse2 },
+		{ "avx2", cksum_avx2 },
+#endif
+	};
+	unsigned char *mem = malloc(MAXLEN + ALIGN);
+	size_t i;
+
+	if (!mem)
+		error(2, errno, "malloc");
+#ifdef PING_CKSUM_X86
+	__builtin_cpu_init();
+#endif
+	for (i = 0; i < ARRAY_SIZE(kernels); i++) {
+#ifdef PING_CKSUM_X86
+		if (kernels[i].sum == cksum_avx2 && !__builtin_cpu_supports("avx2")) {
+			printf("%s: not supported here, skipped\n", kernels[i].name);
+			continue;
+		}
+#endif
+		check_kernel(&kernels[i], mem);
+	}
+
+	free(mem);
+	if (failures)
+		fprintf(stderr, "%d checks failed\n", failures);
+	return failures ? 1 : 0;
+}
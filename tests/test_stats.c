@@ -0,0 +1,89 @@
+/*
+ * Checks of the round trip time accumulator, ping_stats.c, against plain
+ * two-pass computations over the same samples.
+ */
+#include "iputils_common.h"
+#include "ping.h"
+#include "bench.h"
+
+static int failures;
+
+#define CHECK(cond, ...) do {						\
+	if (!(cond)) {							\
+		fprintf(stderr, "%s:%d: ", __FILE__, __LINE__);		\
+		fprintf(stderr, __VA_ARGS__);				\
+		fputc('\n', stderr);					\
+		failures++;						\
+	}								\
+} while (0)
+
+/* Feed "n" samples of "base" plus up to "spread" nsec, checking everything
+ * ping_stats reports against a two-pass reference in long double. */
+static void check_samples(const char *name, long n, long long base, long long spread, int shift)
+{
+	long long *samples = malloc(n * sizeof(*samples));
+	long double sum = 0, sq = 0, mean, mdev;
+	long long min = LLONG_MAX, max = 0;
+	struct ping_stats stats;
+	double ewma = 0;
+	long i;
+
+	if (!samples)
+		error(2, errno, "malloc");
+	ping_stats_init(&stats, shift);
+	for (i = 0; i < n; i++) {
+		samples[i] = base + (spread ? (long long)(xorshift() % spread) : 0);
+		ping_stats_add(&stats, samples[i]);
+		if (samples[i] < min)
+			min = samples[i];
+		if (samples[i] > max)
+			max = samples[i];
+		sum += samples[i];
+		ewma = i ? ewma + (samples[i] - ewma) / (1 << shift) : samples[i];
+	}
+	mean = sum / n;
+	for (i = 0; i < n; i++)
+		sq += (samples[i] - mean) * (samples[i] - mean);
+	mdev = sqrtl(sq / n);
+
+	CHECK(stats.count == (unsigned long long)n, "%s: count %llu, not %ld", name, stats.count, n);
+	CHECK(stats.min == min, "%s: min %lld, not %lld", name, stats.min, min);
+	CHECK(stats.max == max, "%s: max %lld, not %lld", name, stats.max, max);
+	CHECK(llabs(ping_stats_mean(&stats) - llroundl(mean)) <= 1,
+	      "%s: mean %lld, not %.1Lf", name, ping_stats_mean(&stats), mean);
+	CHECK(fabsl(ping_stats_mdev(&stats) - mdev) <= 1 + mdev * 1e-9,
+	      "%s: mdev %lld, not %.1Lf", name, ping_stats_mdev(&stats), mdev);
+	/* The fixed point EWMA truncates by less than 1/2^shift nsec per
+	 * sample, which decays to less than a nsec in all, plus the read. */
+	CHECK(fabs(ping_stats_ewma(&stats) - ewma) <= 2,
+	      "%s: ewma %lld, not %.1f", name, ping_stats_ewma(&stats), ewma);
+	free(samples);
+}
+
+int main(void)
+{
+	struct ping_stats stats;
+	int shift;
+
+	ping_stats_init(&stats, PING_EWMA_SHIFT);
+	CHECK(ping_stats_mdev(&stats) == 0, "mdev of nothing");
+	CHECK(ping_stats_mean(&stats) == 0, "mean of nothing");
+
+	ping_stats_add(&stats, 1234567);
+	CHECK(stats.min == 1234567 && stats.max == 1234567, "min/max of one");
+	CHECK(ping_stats_mean(&stats) == 1234567, "mean of one");
+	CHECK(ping_stats_mdev(&stats) == 0, "mdev of one");
+	CHECK(ping_stats_ewma(&stats) == 1234567, "ewma of one");
+
+	check_samples("constant", 1000, 500000, 0, PING_EWMA_SHIFT);
+	check_samples("loopback", 100000, 20000, 10000, PING_EWMA_SHIFT);
+	check_samples("wan", 100000, 30000000, 5000000, PING_EWMA_SHIFT);
+	/* Tiny spread on top of a huge offset: what a sum of squares loses */
+	check_samples("offset", 1000000, 100000000000LL, 1000, PING_EWMA_SHIFT);
+	for (shift = 1; shift <= PING_EWMA_SHIFT_MAX; shift++)
+		check_samples("shift", 10000, 1000000, 1000000, shift);
+
+	if (failures)
+		fprintf(stderr, "%d checks failed\n", failures);
+	return failures ? 1 : 0;
+}